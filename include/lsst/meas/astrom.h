@@ -5,5 +5,7 @@
 #include "lsst/meas/astrom/matchOptimisticB.h"
 #include "lsst/meas/astrom/PolynomialTransform.h"
 #include "lsst/meas/astrom/SipTransform.h"
+#include "lsst/meas/astrom/ScaledChebyshevTransform.h"
 #include "lsst/meas/astrom/ScaledPolynomialTransformFitter.h"
+#include "lsst/meas/astrom/TanSipEvaluator.h"
 #endif
@@ -24,6 +24,8 @@
 #ifndef LSST_MEAS_ASTROM_PolynomialTransform_INCLUDED
 #define LSST_MEAS_ASTROM_PolynomialTransform_INCLUDED
 
+#include <iosfwd>
+
 #include "ndarray/eigen.h"
 #include "lsst/geom/Point.h"
 #include "lsst/geom/AffineTransform.h"
@@ -35,6 +37,11 @@ namespace astrom {
 class SipForwardTransform;
 class SipReverseTransform;
 class ScaledPolynomialTransform;
+class ScaledChebyshevTransform;
+
+namespace detail {
+class ComposedPolynomial;
+}  // namespace detail
 
 /**
  *  A 2-d coordinate transform represented by a pair of standard polynomials
@@ -82,9 +89,10 @@ public:
     /**
      *  Move constructor.
      *
-     *  Coefficient arrays are moved.
+     *  Coefficient arrays are moved.  other is left with empty arrays
+     *  (getOrder() == -1), and may only be assigned to or destroyed.
      */
-    PolynomialTransform(PolynomialTransform&& other);
+    PolynomialTransform(PolynomialTransform&& other) noexcept;
 
     /**
      *  Copy assignment.
@@ -94,14 +102,14 @@ public:
     PolynomialTransform& operator=(PolynomialTransform const& other);
 
     /**
-     *  Move constructor.
+     *  Move assignment.
      *
      *  Coefficient arrays are moved.
      */
-    PolynomialTransform& operator=(PolynomialTransform&& other);
+    PolynomialTransform& operator=(PolynomialTransform&& other) noexcept;
 
     /// Lightweight swap.
-    void swap(PolynomialTransform& other);
+    void swap(PolynomialTransform& other) noexcept;
 
     /// Return the order of the polynomials.
     int getOrder() const { return _xCoeffs.getSize<0>() - 1; }
@@ -127,17 +135,73 @@ public:
      */
     geom::AffineTransform linearize(geom::Point2D const& in) const;
 
+    /**
+     *  Apply the transform and compute its Jacobian at many points at once.
+     *
+     *  The powers of each input coordinate are computed once per point and
+     *  shared between the value and both partial derivatives.
+     *
+     *  @param[in]  x         Input x coordinates.
+     *  @param[in]  y         Input y coordinates; must have the same size as x.
+     *  @param[out] out       Array of shape (N, 2) filled with the transformed points.
+     *  @param[out] jacobian  Array of shape (N, 2, 2); jacobian[i][j][k] is the
+     *                        derivative of output coordinate j with respect to
+     *                        input coordinate k at point i.
+     *
+     *  @throw pex::exceptions::LengthError if the array shapes are inconsistent.
+     */
+    void linearize(ndarray::Array<double const, 1, 0> const& x, ndarray::Array<double const, 1, 0> const& y,
+                   ndarray::Array<double, 2, 2> const& out,
+                   ndarray::Array<double, 3, 3> const& jacobian) const;
+
     /**
      * Apply the transform to a point.
      */
     geom::Point2D operator()(geom::Point2D const& in) const;
 
+    /**
+     *  Apply the transform to many points at once.
+     *
+     *  @param[in]  x     Input x coordinates.
+     *  @param[in]  y     Input y coordinates; must have the same size as x.
+     *  @param[out] out   Array of shape (N, 2) filled with the transformed points.
+     *
+     *  @throw pex::exceptions::LengthError if the array shapes are inconsistent.
+     */
+    void apply(ndarray::Array<double const, 1, 0> const& x, ndarray::Array<double const, 1, 0> const& y,
+               ndarray::Array<double, 2, 2> const& out) const;
+
+    /**
+     *  Write the transform to a stream in a compact, versioned binary format.
+     *
+     *  The format is portable between platforms, and any number of
+     *  transforms may be written to the same stream.
+     */
+    void writeBinary(std::ostream& os) const;
+
+    /**
+     *  Read a PolynomialTransform written by writeBinary from a stream.
+     *
+     *  @throw pex::exceptions::IoError if the next object in the stream is
+     *         not a PolynomialTransform, or the stream ends early.
+     */
+    static PolynomialTransform readBinary(std::istream& is);
+
 private:
     PolynomialTransform(int order);
 
+    // Reallocate the coefficient arrays and workspace only if they do not
+    // already have the given order; coefficients are left unspecified.
+    void _resize(int order);
+
     friend PolynomialTransform compose(geom::AffineTransform const& t1, PolynomialTransform const& t2);
     friend PolynomialTransform compose(PolynomialTransform const& t1, geom::AffineTransform const& t2);
+    friend void compose(geom::AffineTransform const& t1, PolynomialTransform const& t2,
+                        PolynomialTransform& result);
+    friend void compose(PolynomialTransform const& t1, geom::AffineTransform const& t2,
+                        PolynomialTransform& result);
     friend class ScaledPolynomialTransformFitter;
+    friend class detail::ComposedPolynomial;
     friend class SipForwardTransform;
     friend class SipReverseTransform;
     friend class ScaledPolynomialTransform;
@@ -182,6 +246,14 @@ public:
      */
     static ScaledPolynomialTransform convert(SipReverseTransform const& sipReverse);
 
+    /**
+     *  Convert a ScaledChebyshevTransform to an equivalent ScaledPolynomialTransform.
+     *
+     *  The input and output scalings are unchanged; only the polynomial
+     *  basis is converted from Chebyshev to monomial.
+     */
+    static ScaledPolynomialTransform convert(ScaledChebyshevTransform const& chebyshev);
+
     /**
      *  Construct a new ScaledPolynomialTransform from its constituents.
      *
@@ -195,6 +267,13 @@ public:
     ScaledPolynomialTransform(PolynomialTransform const& poly, geom::AffineTransform const& inputScaling,
                               geom::AffineTransform const& outputScalingInverse);
 
+    /**
+     *  Construct a new ScaledPolynomialTransform, taking ownership of the
+     *  coefficient arrays of the given PolynomialTransform instead of copying them.
+     */
+    ScaledPolynomialTransform(PolynomialTransform&& poly, geom::AffineTransform const& inputScaling,
+                              geom::AffineTransform const& outputScalingInverse);
+
     ScaledPolynomialTransform(ScaledPolynomialTransform const& other) = default;
 
     ScaledPolynomialTransform(ScaledPolynomialTransform&& other) = default;
@@ -203,7 +282,7 @@ public:
 
     ScaledPolynomialTransform& operator=(ScaledPolynomialTransform&& other) = default;
 
-    void swap(ScaledPolynomialTransform& other);
+    void swap(ScaledPolynomialTransform& other) noexcept;
 
     /// Return the polynomial transform applied after the input scaling.
     PolynomialTransform const& getPoly() const { return _poly; }
@@ -219,11 +298,47 @@ public:
      */
     geom::AffineTransform linearize(geom::Point2D const& in) const;
 
+    /**
+     *  Apply the transform and compute its Jacobian at many points at once.
+     *
+     *  See PolynomialTransform::linearize for a description of the arguments.
+     */
+    void linearize(ndarray::Array<double const, 1, 0> const& x, ndarray::Array<double const, 1, 0> const& y,
+                   ndarray::Array<double, 2, 2> const& out,
+                   ndarray::Array<double, 3, 3> const& jacobian) const;
+
     /**
      * Apply the transform to a point.
      */
     geom::Point2D operator()(geom::Point2D const& in) const;
 
+    /**
+     *  Apply the transform to many points at once.
+     *
+     *  The scalings are applied to whole arrays of points on either side of
+     *  the polynomial evaluation; they are never folded into the polynomial
+     *  coefficients.  See PolynomialTransform::apply for a description of the
+     *  arguments.
+     */
+    void apply(ndarray::Array<double const, 1, 0> const& x, ndarray::Array<double const, 1, 0> const& y,
+               ndarray::Array<double, 2, 2> const& out) const;
+
+    /**
+     *  Write the transform to a stream in a compact, versioned binary format.
+     *
+     *  The format is portable between platforms, and any number of
+     *  transforms may be written to the same stream.
+     */
+    void writeBinary(std::ostream& os) const;
+
+    /**
+     *  Read a ScaledPolynomialTransform written by writeBinary from a stream.
+     *
+     *  @throw pex::exceptions::IoError if the next object in the stream is
+     *         not a ScaledPolynomialTransform, or the stream ends early.
+     */
+    static ScaledPolynomialTransform readBinary(std::istream& is);
+
 private:
     friend class ScaledPolynomialTransformFitter;
     PolynomialTransform _poly;
@@ -231,6 +346,23 @@ private:
     geom::AffineTransform _outputScalingInverse;
 };
 
+/**
+ *  Return a ScaledPolynomialTransform that is equivalent to the composition t1(t2()).
+ *
+ *  Only the affine transforms are multiplied; the polynomial coefficients are
+ *  unchanged, so this is exact and much cheaper than composing into a
+ *  PolynomialTransform.
+ */
+ScaledPolynomialTransform compose(geom::AffineTransform const& t1, ScaledPolynomialTransform const& t2);
+
+/**
+ *  Return a ScaledPolynomialTransform that is equivalent to the composition t1(t2()).
+ *
+ *  Only the affine transforms are multiplied; the polynomial coefficients are
+ *  unchanged.
+ */
+ScaledPolynomialTransform compose(ScaledPolynomialTransform const& t1, geom::AffineTransform const& t2);
+
 /**
  *  Return a PolynomialTransform that is equivalent to the composition t1(t2())
  *
@@ -239,6 +371,22 @@ private:
  */
 PolynomialTransform compose(geom::AffineTransform const& t1, PolynomialTransform const& t2);
 
+/**
+ *  Return a PolynomialTransform that is equivalent to the composition t1(t2()),
+ *  reusing the coefficient arrays of t2 instead of allocating new ones.
+ */
+PolynomialTransform compose(geom::AffineTransform const& t1, PolynomialTransform&& t2);
+
+/**
+ *  Compute a PolynomialTransform that is equivalent to the composition t1(t2()),
+ *  writing it to an existing object.
+ *
+ *  The coefficient arrays of result are reused if it already has the same
+ *  order as t2, so repeated compositions need not allocate.  result may be
+ *  the same object as t2.
+ */
+void compose(geom::AffineTransform const& t1, PolynomialTransform const& t2, PolynomialTransform& result);
+
 /**
  *  Return a PolynomialTransform that is equivalent to the composition t1(t2())
  *
@@ -247,6 +395,16 @@ PolynomialTransform compose(geom::AffineTransform const& t1, PolynomialTransform
  */
 PolynomialTransform compose(PolynomialTransform const& t1, geom::AffineTransform const& t2);
 
+/**
+ *  Compute a PolynomialTransform that is equivalent to the composition t1(t2()),
+ *  writing it to an existing object.
+ *
+ *  The result has the same order as t1 (or order one, if t1 is constant), and
+ *  its coefficient arrays are reused if they already have that order.  If
+ *  result is the same object as t1, a temporary copy of t1 is made first.
+ */
+void compose(PolynomialTransform const& t1, geom::AffineTransform const& t2, PolynomialTransform& result);
+
 }  // namespace astrom
 }  // namespace meas
 }  // namespace lsst
@@ -0,0 +1,124 @@
+// -*- LSST-C++ -*-
+
+/*
+ * This file is part of meas_astrom.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef LSST_MEAS_ASTROM_ScaledChebyshevTransform_INCLUDED
+#define LSST_MEAS_ASTROM_ScaledChebyshevTransform_INCLUDED
+
+#include "ndarray/eigen.h"
+#include "lsst/geom/Point.h"
+#include "lsst/geom/AffineTransform.h"
+
+namespace lsst {
+namespace meas {
+namespace astrom {
+
+/**
+ *  A 2-d coordinate transform represented by a lazy composition of an
+ *  AffineTransform, a pair of 2-d Chebyshev series, and another AffineTransform.
+ *
+ *  This is the Chebyshev-basis analog of ScaledPolynomialTransform: the
+ *  input scaling is expected to map the region of interest onto
+ *  [-1, 1]x[-1, 1], where products of Chebyshev polynomials of the first kind
+ *  are far better conditioned than monomials, especially at high order.
+ *  Series are evaluated with Clenshaw's recurrence.
+ *
+ *  Convert to ScaledPolynomialTransform, SipForwardTransform or
+ *  SipReverseTransform (via their convert methods) to obtain monomial
+ *  coefficients.
+ */
+class ScaledChebyshevTransform {
+public:
+    /**
+     *  Construct a new transform from Chebyshev coefficients and scalings.
+     *
+     *  @param[in]  xCoeffs   Coefficients for the output x coordinate; the
+     *                        element at [p, q] multiplies @f$T_p(x)T_q(y)@f$.
+     *                        Must be square and triangular, as for
+     *                        PolynomialTransform.
+     *  @param[in]  yCoeffs   Coefficients for the output y coordinate, with
+     *                        the same shape as xCoeffs.
+     *  @param[in]  inputScaling          An AffineTransform to be applied
+     *                                    immediately to input points.
+     *  @param[in]  outputScalingInverse  An AffineTransform to be applied to
+     *                                    points after the Chebyshev series.
+     *
+     *  @throw pex::exceptions::LengthError if the coefficient arrays are not
+     *         square or have different shapes.
+     */
+    ScaledChebyshevTransform(ndarray::Array<double const, 2, 0> const& xCoeffs,
+                             ndarray::Array<double const, 2, 0> const& yCoeffs,
+                             geom::AffineTransform const& inputScaling,
+                             geom::AffineTransform const& outputScalingInverse);
+
+    ScaledChebyshevTransform(ScaledChebyshevTransform const& other) = default;
+
+    ScaledChebyshevTransform(ScaledChebyshevTransform&& other) = default;
+
+    ScaledChebyshevTransform& operator=(ScaledChebyshevTransform const& other) = default;
+
+    ScaledChebyshevTransform& operator=(ScaledChebyshevTransform&& other) = default;
+
+    /// Return the order of the Chebyshev series.
+    int getOrder() const { return _xCoeffs.rows() - 1; }
+
+    /// Chebyshev coefficients that compute the output x coordinate, indexed [p, q].
+    Eigen::MatrixXd const& getXCoeffs() const { return _xCoeffs; }
+
+    /// Chebyshev coefficients that compute the output y coordinate, indexed [p, q].
+    Eigen::MatrixXd const& getYCoeffs() const { return _yCoeffs; }
+
+    /// Return the first affine transform applied to input points.
+    geom::AffineTransform const& getInputScaling() const { return _inputScaling; }
+
+    /// Return the affine transform applied to points after the Chebyshev series.
+    geom::AffineTransform const& getOutputScalingInverse() const { return _outputScalingInverse; }
+
+    /**
+     * Return an approximate affine transform at the given point.
+     */
+    geom::AffineTransform linearize(geom::Point2D const& in) const;
+
+    /**
+     * Apply the transform to a point.
+     */
+    geom::Point2D operator()(geom::Point2D const& in) const;
+
+private:
+    friend class ScaledPolynomialTransformFitter;
+
+    // Construct with all-zero coefficients of the given order.
+    ScaledChebyshevTransform(int order, geom::AffineTransform const& inputScaling,
+                             geom::AffineTransform const& outputScalingInverse);
+
+    Eigen::MatrixXd _xCoeffs;
+    Eigen::MatrixXd _yCoeffs;
+    geom::AffineTransform _inputScaling;
+    geom::AffineTransform _outputScalingInverse;
+};
+
+}  // namespace astrom
+}  // namespace meas
+}  // namespace lsst
+
+#endif  // !LSST_MEAS_ASTROM_ScaledChebyshevTransform_INCLUDED
@@ -32,6 +32,7 @@
 #include "lsst/afw/table/BaseRecord.h"
 #include "lsst/meas/astrom/PolynomialTransform.h"
 #include "lsst/meas/astrom/SipTransform.h"
+#include "lsst/meas/astrom/ScaledChebyshevTransform.h"
 
 namespace lsst {
 namespace meas {
@@ -96,6 +97,13 @@ public:
  *  model-transformed points and output data points, and finally rejects
  *  outliers by sigma-clipping those differences before repeating.
  *
+ *  Both construction methods can optionally fit in a basis of products of
+ *  Chebyshev polynomials instead of monomials.  Because the data points are
+ *  scaled onto [-1, 1], this basis yields much better conditioned normal
+ *  equations at high order.  The Chebyshev series is available via
+ *  getChebyshevTransform(); getTransform() and getPoly() then return its
+ *  monomial equivalent.
+ *
  *  ScaledPolynomialTransformFitter instances should be confined to a single thread.
  */
 class ScaledPolynomialTransformFitter {
@@ -119,6 +127,9 @@ public:
      *                              quadrature with source measurement errors in
      *                              setting the uncertainty on each match.
      *
+     *  @param[in] chebyshev        If true, fit in a basis of Chebyshev
+     *                              polynomials instead of monomials.
+     *
      *  This initializes the data catalog with the following fields:
      *   - ref_id:             reference object ID
      *   - src_id:             source ID from the match
@@ -137,7 +148,8 @@ public:
     static ScaledPolynomialTransformFitter fromMatches(int maxOrder,
                                                        afw::table::ReferenceMatchVector const& matches,
                                                        afw::geom::SkyWcs const& initialWcs,
-                                                       double intrinsicScatter);
+                                                       double intrinsicScatter,
+                                                       bool chebyshev = false);
 
     /**
      *  Initialize a fit that inverts an existing transform by evaluating and
@@ -156,6 +168,9 @@ public:
      *
      *  @param[in] toInvert   Transform to invert
      *
+     *  @param[in] chebyshev  If true, fit in a basis of Chebyshev polynomials
+     *                        instead of monomials.
+     *
      *  This initializes the data catalog with the following fields:
      *   - output:  grid positions passed as input to the toInvert transform,
      *              treated as output data points when fitting its inverse.
@@ -168,7 +183,8 @@ public:
      *  on fitters initialized using this method.
      */
     static ScaledPolynomialTransformFitter fromGrid(int maxOrder, geom::Box2D const& bbox, int nGridX,
-                                                    int nGridY, ScaledPolynomialTransform const& toInvert);
+                                                    int nGridY, ScaledPolynomialTransform const& toInvert,
+                                                    bool chebyshev = false);
 
     /**
      *  Perform a linear least-squares fit of the polynomial coefficients.
@@ -274,12 +290,23 @@ public:
      */
     geom::AffineTransform const& getOutputScaling() const { return _outputScaling; }
 
+    /// Return true if the fitter uses a Chebyshev basis.
+    bool isChebyshev() const { return _isChebyshev; }
+
+    /**
+     *  Return the best-fit transform in the Chebyshev basis.
+     *
+     *  @throw pex::exceptions::LogicError if the fitter was not constructed
+     *         with chebyshev=true.
+     */
+    ScaledChebyshevTransform const& getChebyshevTransform() const;
+
 private:
     class Keys;
 
     ScaledPolynomialTransformFitter(afw::table::BaseCatalog const& data, Keys const& keys, int maxOrder,
                                     double intrinsicScatter, geom::AffineTransform const& inputScaling,
-                                    geom::AffineTransform const& outputScaling);
+                                    geom::AffineTransform const& outputScaling, bool chebyshev);
 
     double computeIntrinsicScatter() const;
 
@@ -292,9 +319,11 @@ private:
     afw::table::BaseCatalog _data;
     geom::AffineTransform _outputScaling;
     ScaledPolynomialTransform _transform;
+    bool _isChebyshev;
+    ScaledChebyshevTransform _chebyshev;
     // 2-d generalization of the Vandermonde matrix: evaluates polynomial at
     // all data points when multiplied by a vector of packed polynomial
-    // coefficients.
+    // coefficients (of monomials or Chebyshev polynomials).
     Eigen::MatrixXd _vandermonde;
 };
 
@@ -24,6 +24,8 @@
 #ifndef LSST_MEAS_ASTROM_SipTransform_INCLUDED
 #define LSST_MEAS_ASTROM_SipTransform_INCLUDED
 
+#include <utility>
+
 #include "lsst/geom/Extent.h"
 #include "lsst/geom/Point.h"
 #include "lsst/geom/SpherePoint.h"
@@ -31,11 +33,14 @@
 #include "lsst/geom/LinearTransform.h"
 #include "lsst/afw/geom/SkyWcs.h"
 #include "lsst/meas/astrom/PolynomialTransform.h"
+#include "lsst/meas/astrom/ScaledChebyshevTransform.h"
 
 namespace lsst {
 namespace meas {
 namespace astrom {
 
+class SipReverseTransform;
+
 /**
  *  Base class for SIP transform objects.
  *
@@ -77,12 +82,17 @@ protected:
                      PolynomialTransform const& poly)
             : _pixelOrigin(pixelOrigin), _cdMatrix(cdMatrix), _poly(poly) {}
 
+    /// As above, but taking ownership of the polynomial's coefficient arrays.
+    SipTransformBase(geom::Point2D const& pixelOrigin, geom::LinearTransform const& cdMatrix,
+                     PolynomialTransform&& poly)
+            : _pixelOrigin(pixelOrigin), _cdMatrix(cdMatrix), _poly(std::move(poly)) {}
+
     SipTransformBase(SipTransformBase const& other) = default;
     SipTransformBase(SipTransformBase&& other) = default;
     SipTransformBase& operator=(SipTransformBase const& other) = default;
     SipTransformBase& operator=(SipTransformBase&& other) = default;
 
-    void swap(SipTransformBase& other) {
+    void swap(SipTransformBase& other) noexcept {
         std::swap(_pixelOrigin, other._pixelOrigin);
         std::swap(_cdMatrix, other._cdMatrix);
         _poly.swap(other._poly);
@@ -165,6 +175,20 @@ public:
      */
     static SipForwardTransform convert(ScaledPolynomialTransform const& scaled);
 
+    /**
+     *  Convert a ScaledChebyshevTransform to an equivalent SipForwardTransform.
+     *
+     *  This is where the Chebyshev basis is converted to SIP monomials;
+     *  see ScaledPolynomialTransform::convert.
+     *
+     *  @param[in]   chebyshev      ScaledChebyshevTransform to convert.
+     *  @param[in]   pixelOrigin    CRPIX @f$(u_0,v_0)@f$ (zero-indexed)
+     *  @param[in]   cdMatrix       CD matrix @f$Z@f$
+     */
+    static SipForwardTransform convert(ScaledChebyshevTransform const& chebyshev,
+                                       geom::Point2D const& pixelOrigin,
+                                       geom::LinearTransform const& cdMatrix);
+
     /**
      *  Construct a SipForwardTransform from its components.
      *
@@ -176,6 +200,14 @@ public:
                         PolynomialTransform const& forwardSipPoly)
             : SipTransformBase(pixelOrigin, cdMatrix, forwardSipPoly) {}
 
+    /**
+     *  Construct a SipForwardTransform from its components, taking ownership
+     *  of the coefficient arrays of forwardSipPoly instead of copying them.
+     */
+    SipForwardTransform(geom::Point2D const& pixelOrigin, geom::LinearTransform const& cdMatrix,
+                        PolynomialTransform&& forwardSipPoly)
+            : SipTransformBase(pixelOrigin, cdMatrix, std::move(forwardSipPoly)) {}
+
     SipForwardTransform(SipForwardTransform const& other) = default;
 
     SipForwardTransform(SipForwardTransform&& other) = default;
@@ -191,16 +223,100 @@ public:
      */
     geom::AffineTransform linearize(geom::Point2D const& in) const;
 
+    /**
+     *  Apply the transform and compute its Jacobian at many points at once.
+     *
+     *  See PolynomialTransform::linearize for a description of the arguments.
+     */
+    void linearize(ndarray::Array<double const, 1, 0> const& x, ndarray::Array<double const, 1, 0> const& y,
+                   ndarray::Array<double, 2, 2> const& out,
+                   ndarray::Array<double, 3, 3> const& jacobian) const;
+
     /**
      * Apply the transform to a point.
      */
     geom::Point2D operator()(geom::Point2D const& uv) const;
 
+    /**
+     *  Apply the transform to many points at once.
+     *
+     *  The affine parts of the transform are applied to whole arrays of
+     *  points on either side of the polynomial evaluation.  See
+     *  PolynomialTransform::apply for a description of the arguments.
+     */
+    void apply(ndarray::Array<double const, 1, 0> const& x, ndarray::Array<double const, 1, 0> const& y,
+               ndarray::Array<double, 2, 2> const& out) const;
+
+    /**
+     *  Compute the exact inverse of the transform at many points, using
+     *  Newton-Raphson iteration seeded by the inverse of the linear part
+     *  (CRPIX and CD matrix) of the transform.
+     *
+     *  @param[in]  x          Intermediate world x coordinates.
+     *  @param[in]  y          Intermediate world y coordinates; must have the
+     *                         same size as x.
+     *  @param[out] out        Array of shape (N, 2) filled with pixel coordinates.
+     *  @param[in]  tolerance  Iteration stops for a point once the Newton step
+     *                         is smaller than this (in pixels).
+     *  @param[in]  maxIter    Maximum number of iterations; points that have
+     *                         not converged by then are set to NaN.
+     *
+     *  @throw pex::exceptions::LengthError if the array shapes are inconsistent.
+     */
+    void applyInverse(ndarray::Array<double const, 1, 0> const& x,
+                      ndarray::Array<double const, 1, 0> const& y, ndarray::Array<double, 2, 2> const& out,
+                      double tolerance = 1E-10, int maxIter = 20) const;
+
+    /**
+     *  Compute the exact inverse of the transform at many points, using
+     *  Newton-Raphson iteration seeded by an approximate reverse transform.
+     *
+     *  With a good seed (such as a fitted reverse SIP polynomial) this
+     *  typically converges in one or two iterations.
+     *
+     *  @param[in]  x          Intermediate world x coordinates.
+     *  @param[in]  y          Intermediate world y coordinates; must have the
+     *                         same size as x.
+     *  @param[out] out        Array of shape (N, 2) filled with pixel coordinates.
+     *  @param[in]  seed       Approximate inverse used to compute starting points.
+     *  @param[in]  tolerance  Iteration stops for a point once the Newton step
+     *                         is smaller than this (in pixels).
+     *  @param[in]  maxIter    Maximum number of iterations; points that have
+     *                         not converged by then are set to NaN.
+     *
+     *  @throw pex::exceptions::LengthError if the array shapes are inconsistent.
+     */
+    void applyInverse(ndarray::Array<double const, 1, 0> const& x,
+                      ndarray::Array<double const, 1, 0> const& y, ndarray::Array<double, 2, 2> const& out,
+                      SipReverseTransform const& seed, double tolerance = 1E-10, int maxIter = 20) const;
+
     /**
      * Return a new forward SIP transform that includes a transformation of
      * the pixel coordinate system by the given affine transform.
      */
     SipForwardTransform transformPixels(geom::AffineTransform const& s) const;
+
+    /**
+     *  Write the transform to a stream in a compact, versioned binary format.
+     *
+     *  The format is portable between platforms, and any number of
+     *  transforms may be written to the same stream.
+     */
+    void writeBinary(std::ostream& os) const;
+
+    /**
+     *  Read a SipForwardTransform written by writeBinary from a stream.
+     *
+     *  @throw pex::exceptions::IoError if the next object in the stream is
+     *         not a SipForwardTransform, or the stream ends early.
+     */
+    static SipForwardTransform readBinary(std::istream& is);
+
+private:
+    // Refine starting points in out with Newton-Raphson iteration.
+    void _refineInverse(ndarray::Array<double const, 1, 0> const& x,
+                        ndarray::Array<double const, 1, 0> const& y, ndarray::Array<double, 2, 2> const& out,
+                        double tolerance, int maxIter) const;
 };
 
 /**
@@ -275,6 +391,20 @@ public:
      */
     static SipReverseTransform convert(ScaledPolynomialTransform const& scaled);
 
+    /**
+     *  Convert a ScaledChebyshevTransform to an equivalent SipReverseTransform.
+     *
+     *  This is where the Chebyshev basis is converted to SIP monomials;
+     *  see ScaledPolynomialTransform::convert.
+     *
+     *  @param[in]   chebyshev      ScaledChebyshevTransform to convert.
+     *  @param[in]   pixelOrigin    CRPIX @f$(u_0,v_0)@f$ (zero-indexed)
+     *  @param[in]   cdMatrix       CD matrix @f$Z@f$
+     */
+    static SipReverseTransform convert(ScaledChebyshevTransform const& chebyshev,
+                                       geom::Point2D const& pixelOrigin,
+                                       geom::LinearTransform const& cdMatrix);
+
     /**
      *  Construct a SipReverseTransform from its components.
      *
@@ -286,6 +416,15 @@ public:
                         PolynomialTransform const& reverseSipPoly)
             : SipTransformBase(pixelOrigin, cdMatrix, reverseSipPoly), _cdInverse(cdMatrix.inverted()) {}
 
+    /**
+     *  Construct a SipReverseTransform from its components, taking ownership
+     *  of the coefficient arrays of reverseSipPoly instead of copying them.
+     */
+    SipReverseTransform(geom::Point2D const& pixelOrigin, geom::LinearTransform const& cdMatrix,
+                        PolynomialTransform&& reverseSipPoly)
+            : SipTransformBase(pixelOrigin, cdMatrix, std::move(reverseSipPoly)),
+              _cdInverse(cdMatrix.inverted()) {}
+
     SipReverseTransform(SipReverseTransform const& other) = default;
 
     SipReverseTransform(SipReverseTransform&& other) = default;
@@ -304,17 +443,52 @@ public:
      */
     geom::AffineTransform linearize(geom::Point2D const& in) const;
 
+    /**
+     *  Apply the transform and compute its Jacobian at many points at once.
+     *
+     *  See PolynomialTransform::linearize for a description of the arguments.
+     */
+    void linearize(ndarray::Array<double const, 1, 0> const& x, ndarray::Array<double const, 1, 0> const& y,
+                   ndarray::Array<double, 2, 2> const& out,
+                   ndarray::Array<double, 3, 3> const& jacobian) const;
+
     /**
      * Apply the transform to a point.
      */
     geom::Point2D operator()(geom::Point2D const& xy) const;
 
+    /**
+     *  Apply the transform to many points at once.
+     *
+     *  The affine parts of the transform are applied to whole arrays of
+     *  points on either side of the polynomial evaluation.  See
+     *  PolynomialTransform::apply for a description of the arguments.
+     */
+    void apply(ndarray::Array<double const, 1, 0> const& x, ndarray::Array<double const, 1, 0> const& y,
+               ndarray::Array<double, 2, 2> const& out) const;
+
     /**
      * Return a new reverse SIP transform that includes a transformation of
      * the pixel coordinate system by the given affine transform.
      */
     SipReverseTransform transformPixels(geom::AffineTransform const& s) const;
 
+    /**
+     *  Write the transform to a stream in a compact, versioned binary format.
+     *
+     *  The format is portable between platforms, and any number of
+     *  transforms may be written to the same stream.
+     */
+    void writeBinary(std::ostream& os) const;
+
+    /**
+     *  Read a SipReverseTransform written by writeBinary from a stream.
+     *
+     *  @throw pex::exceptions::IoError if the next object in the stream is
+     *         not a SipReverseTransform, or the stream ends early.
+     */
+    static SipReverseTransform readBinary(std::istream& is);
+
 private:
     friend class PolynomialTransform;
     friend class ScaledPolynomialTransform;
@@ -354,6 +528,15 @@ std::shared_ptr<afw::geom::SkyWcs> makeWcs(SipForwardTransform const& sipForward
  *  assert(newWcs.pixelToSky(pixel), wcs.pixelToSky(s.inverted()(pixel)));
  *  @endcode
  *  for all sky coordinates @c sky and pixel coordinates @c pixel.
+ *
+ *  If wcs is an ICRS TAN or TAN-SIP WCS that can be represented exactly in
+ *  FITS, the transform is folded analytically into CRPIX, the CD matrix and
+ *  the SIP coefficients, and the result is again such a WCS, so repeated
+ *  calls do not make it more expensive to evaluate.  Otherwise the result
+ *  appends @c s to the pixel frame of the original WCS.
+ *
+ *  @throw pex::exceptions::InvalidParameterError if wcs is a TAN WCS whose
+ *         axes are not RA---TAN and DEC--TAN.
  */
 std::shared_ptr<afw::geom::SkyWcs> transformWcsPixels(afw::geom::SkyWcs const& wcs,
                                                       geom::AffineTransform const& s);
@@ -365,6 +548,9 @@ std::shared_ptr<afw::geom::SkyWcs> transformWcsPixels(afw::geom::SkyWcs const& w
  *  @param[in]  wcs        Original SkyWcs to be rotated.
  *  @param[in]  nQuarter   Number of 90 degree rotations (positive is counterclockwise).
  *  @param[in]  dimensions Width and height of the image.
+ *
+ *  This is implemented with transformWcsPixels, and hence takes the same
+ *  analytic path for TAN-SIP WCSs.
  */
 std::shared_ptr<afw::geom::SkyWcs> rotateWcsPixelsBy90(afw::geom::SkyWcs const& wcs, int nQuarter,
                                                        geom::Extent2I const& dimensions);
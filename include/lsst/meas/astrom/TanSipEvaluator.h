@@ -0,0 +1,181 @@
+// -*- LSST-C++ -*-
+
+/*
+ * This file is part of meas_astrom.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef LSST_MEAS_ASTROM_TanSipEvaluator_INCLUDED
+#define LSST_MEAS_ASTROM_TanSipEvaluator_INCLUDED
+
+#include <vector>
+
+#include "ndarray.h"
+#include "lsst/geom/Point.h"
+#include "lsst/geom/SpherePoint.h"
+#include "lsst/afw/geom/SkyWcs.h"
+#include "lsst/meas/astrom/SipTransform.h"
+
+namespace lsst {
+namespace meas {
+namespace astrom {
+
+/**
+ *  A lightweight evaluator for TAN-SIP world coordinate systems.
+ *
+ *  TanSipEvaluator maps between pixel and sky coordinates by evaluating the
+ *  SIP polynomials and the gnomonic projection directly, operating on whole
+ *  arrays of points at once.  This avoids the per-call overhead of the AST
+ *  mappings behind afw::geom::SkyWcs, and is much faster when many points
+ *  need to be transformed.
+ *
+ *  The pixel-to-sky direction uses the forward SIP polynomial (A, B) and is
+ *  exact.  By default the sky-to-pixel direction uses the reverse polynomial
+ *  (AP, BP), and hence is only as accurate as that polynomial is as an
+ *  inverse of the forward polynomial.  When constructed with
+ *  exactInverse=true (or without a reverse polynomial), sky-to-pixel instead
+ *  inverts the forward polynomial with SipForwardTransform::applyInverse,
+ *  using the reverse polynomial (if any) only as the starting point.
+ *
+ *  Sky coordinates are ICRS, in radians for the array interfaces.
+ *
+ *  TanSipEvaluator instances should be confined to a single thread.
+ */
+class TanSipEvaluator {
+public:
+    /**
+     *  Construct from a pair of SIP transforms and the sky origin.
+     *
+     *  @param[in]   sipForward    Mapping from pixel coordinates to intermediate
+     *                             world coordinates.
+     *  @param[in]   sipReverse    Mapping from intermediate world coordinates to
+     *                             pixel coordinates.
+     *  @param[in]   skyOrigin     ICRS position of the gnomonic projection (CRVAL).
+     *  @param[in]   exactInverse  If true, invert sipForward iteratively in
+     *                             skyToPixel, using sipReverse only as a seed.
+     *
+     *  @throw pex::exceptions::InvalidParameterError if the forward and reverse
+     *         SIP transforms have different CRPIX values or CD matrices.
+     */
+    TanSipEvaluator(SipForwardTransform const& sipForward, SipReverseTransform const& sipReverse,
+                    geom::SpherePoint const& skyOrigin, bool exactInverse = false);
+
+    /**
+     *  Construct from a forward SIP transform and the sky origin only.
+     *
+     *  skyToPixel inverts the forward transform iteratively, starting from
+     *  the inverse of its linear part.
+     */
+    TanSipEvaluator(SipForwardTransform const& sipForward, geom::SpherePoint const& skyOrigin);
+
+    /**
+     *  Construct from a SkyWcs that can be represented exactly as a FITS
+     *  TAN or TAN-SIP WCS.
+     *
+     *  @param[in]  wcs           WCS to evaluate.
+     *  @param[in]  exactInverse  If true, invert the forward SIP polynomial
+     *                            iteratively in skyToPixel.  This is always
+     *                            done if the WCS has no reverse coefficients.
+     *
+     *  @throw pex::exceptions::InvalidParameterError if the WCS is not a TAN
+     *         or TAN-SIP WCS with RA---TAN and DEC--TAN axes.
+     */
+    explicit TanSipEvaluator(afw::geom::SkyWcs const& wcs, bool exactInverse = false);
+
+    TanSipEvaluator(TanSipEvaluator const&) = default;
+    TanSipEvaluator(TanSipEvaluator&&) = default;
+    TanSipEvaluator& operator=(TanSipEvaluator const&) = default;
+    TanSipEvaluator& operator=(TanSipEvaluator&&) = default;
+    ~TanSipEvaluator() = default;
+
+    /// Return the transform from pixel coordinates to intermediate world coordinates.
+    SipForwardTransform const& getSipForward() const { return _sipForward; }
+
+    /// Return the transform from intermediate world coordinates to pixel coordinates.
+    SipReverseTransform const& getSipReverse() const { return _sipReverse; }
+
+    /// Return the sky origin of the gnomonic projection (CRVAL).
+    geom::SpherePoint const& getSkyOrigin() const { return _skyOrigin; }
+
+    /// Return true if skyToPixel inverts the forward transform iteratively.
+    bool isExactInverse() const { return _exactInverse; }
+
+    /**
+     *  Transform arrays of pixel coordinates to sky coordinates.
+     *
+     *  @param[in]   x     Pixel x coordinates.
+     *  @param[in]   y     Pixel y coordinates; must have the same size as x.
+     *  @param[out]  ra    ICRS right ascension in radians, in [0, 2pi).
+     *  @param[out]  dec   ICRS declination in radians.
+     *
+     *  @throw pex::exceptions::LengthError if the array sizes are inconsistent.
+     */
+    void pixelToSky(ndarray::Array<double const, 1, 0> const& x, ndarray::Array<double const, 1, 0> const& y,
+                    ndarray::Array<double, 1, 0> const& ra, ndarray::Array<double, 1, 0> const& dec) const;
+
+    /**
+     *  Transform arrays of sky coordinates to pixel coordinates.
+     *
+     *  Points more than 90 degrees from the sky origin have no gnomonic
+     *  projection; their pixel coordinates are set to NaN.
+     *
+     *  @param[in]   ra    ICRS right ascension in radians.
+     *  @param[in]   dec   ICRS declination in radians; must have the same size as ra.
+     *  @param[out]  x     Pixel x coordinates.
+     *  @param[out]  y     Pixel y coordinates.
+     *
+     *  @throw pex::exceptions::LengthError if the array sizes are inconsistent.
+     */
+    void skyToPixel(ndarray::Array<double const, 1, 0> const& ra,
+                    ndarray::Array<double const, 1, 0> const& dec, ndarray::Array<double, 1, 0> const& x,
+                    ndarray::Array<double, 1, 0> const& y) const;
+
+    /// Transform a vector of pixel positions to sky positions.
+    std::vector<geom::SpherePoint> pixelToSky(std::vector<geom::Point2D> const& pixels) const;
+
+    /// Transform a vector of sky positions to pixel positions.
+    std::vector<geom::Point2D> skyToPixel(std::vector<geom::SpherePoint> const& coords) const;
+
+    /// Transform a single pixel position to a sky position.
+    geom::SpherePoint pixelToSky(geom::Point2D const& pixel) const;
+
+    /// Transform a single sky position to a pixel position.
+    geom::Point2D skyToPixel(geom::SpherePoint const& coord) const;
+
+private:
+    void _pixelToSky(Eigen::ArrayXd const& x, Eigen::ArrayXd const& y, Eigen::ArrayXd& ra,
+                     Eigen::ArrayXd& dec) const;
+
+    void _skyToPixel(Eigen::ArrayXd const& ra, Eigen::ArrayXd const& dec, Eigen::ArrayXd& x,
+                     Eigen::ArrayXd& y) const;
+
+    SipForwardTransform _sipForward;
+    SipReverseTransform _sipReverse;
+    geom::SpherePoint _skyOrigin;
+    double _sinDec0;
+    double _cosDec0;
+    bool _exactInverse;
+};
+
+}  // namespace astrom
+}  // namespace meas
+}  // namespace lsst
+
+#endif  // !LSST_MEAS_ASTROM_TanSipEvaluator_INCLUDED
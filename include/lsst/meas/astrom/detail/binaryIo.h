@@ -0,0 +1,151 @@
+// -*- LSST-C++ -*-
+
+/*
+ * This file is part of meas_astrom.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef LSST_MEAS_ASTROM_DETAIL_binaryIo_h_INCLUDED
+#define LSST_MEAS_ASTROM_DETAIL_binaryIo_h_INCLUDED
+
+#include <cstdint>
+#include <iosfwd>
+#include <sstream>
+#include <string>
+
+#include "ndarray.h"
+#include "lsst/geom/Point.h"
+#include "lsst/geom/LinearTransform.h"
+#include "lsst/geom/AffineTransform.h"
+
+namespace lsst {
+namespace meas {
+namespace astrom {
+namespace detail {
+
+/*
+ *  Helpers for the compact binary format used by the writeBinary/readBinary
+ *  methods of PolynomialTransform, ScaledPolynomialTransform,
+ *  SipForwardTransform and SipReverseTransform.
+ *
+ *  Each object starts with a 6-byte header: the magic bytes "MATR", a format
+ *  version, and a type tag.  All numbers are little-endian; doubles are
+ *  IEEE 754 binary64, so the format is portable between platforms.
+ *  Polynomials are stored as their order (int32) followed by the full x and
+ *  y coefficient matrices in row-major order.  Objects can be concatenated
+ *  in one stream and read back in the same order.
+ */
+
+/// Type tags that identify the object stored after a binary header.
+enum class BinaryTypeTag : std::uint8_t {
+    POLYNOMIAL = 1,
+    SCALED_POLYNOMIAL = 2,
+    SIP_FORWARD = 3,
+    SIP_REVERSE = 4
+};
+
+/// Write values to a stream in the binary transform format.
+class BinaryWriter {
+public:
+    /// The format version written by this class.
+    static constexpr std::uint8_t VERSION = 1;
+
+    explicit BinaryWriter(std::ostream& os) : _os(os) {}
+
+    void writeHeader(BinaryTypeTag tag);
+
+    void writeInt32(std::int32_t value);
+
+    void writeDouble(double value);
+
+    /// Write the order and both coefficient matrices of a polynomial.
+    void writePolynomial(ndarray::Array<double const, 2, 2> const& xCoeffs,
+                         ndarray::Array<double const, 2, 2> const& yCoeffs);
+
+    void writePoint(geom::Point2D const& point);
+
+    void writeLinear(geom::LinearTransform const& linear);
+
+    void writeAffine(geom::AffineTransform const& affine);
+
+private:
+    void writeDoubles(double const* values, std::size_t n);
+
+    std::ostream& _os;
+};
+
+/**
+ *  Read values from a stream in the binary transform format.
+ *
+ *  All methods throw pex::exceptions::IoError if the stream ends early or
+ *  does not contain the expected data.
+ */
+class BinaryReader {
+public:
+    explicit BinaryReader(std::istream& is) : _is(is) {}
+
+    /// Read a header and check that it has the expected type tag.
+    void readHeader(BinaryTypeTag expected);
+
+    std::int32_t readInt32();
+
+    double readDouble();
+
+    /**
+     *  Read a polynomial written by BinaryWriter::writePolynomial into newly
+     *  allocated coefficient arrays.
+     */
+    void readPolynomial(ndarray::Array<double, 2, 2>& xCoeffs, ndarray::Array<double, 2, 2>& yCoeffs);
+
+    geom::Point2D readPoint();
+
+    geom::LinearTransform readLinear();
+
+    geom::AffineTransform readAffine();
+
+private:
+    void readBytes(char* buffer, std::size_t n);
+
+    void readDoubles(double* values, std::size_t n);
+
+    std::istream& _is;
+};
+
+/// Serialize an object with a writeBinary method to a string of bytes.
+template <typename T>
+std::string writeBinaryToString(T const& object) {
+    std::ostringstream os(std::ios::out | std::ios::binary);
+    object.writeBinary(os);
+    return os.str();
+}
+
+/// Deserialize an object with a static readBinary method from a string of bytes.
+template <typename T>
+T readBinaryFromString(std::string const& bytes) {
+    std::istringstream is(bytes, std::ios::in | std::ios::binary);
+    return T::readBinary(is);
+}
+
+}  // namespace detail
+}  // namespace astrom
+}  // namespace meas
+}  // namespace lsst
+
+#endif  // !LSST_MEAS_ASTROM_DETAIL_binaryIo_h_INCLUDED
@@ -0,0 +1,94 @@
+// -*- LSST-C++ -*-
+
+/*
+ * This file is part of meas_astrom.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef LSST_MEAS_ASTROM_DETAIL_composedPolynomial_h_INCLUDED
+#define LSST_MEAS_ASTROM_DETAIL_composedPolynomial_h_INCLUDED
+
+#include "ndarray.h"
+#include "lsst/geom/Point.h"
+#include "lsst/geom/AffineTransform.h"
+#include "lsst/meas/astrom/PolynomialTransform.h"
+
+namespace lsst {
+namespace meas {
+namespace astrom {
+namespace detail {
+
+/**
+ *  A lightweight, unevaluated composition of a PolynomialTransform with
+ *  affine transforms on either side.
+ *
+ *  The expression represents @f$O(P(I(x)) + k I(x))@f$, where @f$I@f$ and
+ *  @f$O@f$ are the inner and outer affine transforms, @f$P@f$ is the
+ *  polynomial and @f$k@f$ is 1 if addIdentity is true and 0 otherwise (the
+ *  latter covers the terms outside the sum in the SIP definitions).
+ *
+ *  When evaluated on arrays of points, the affine steps are applied to
+ *  whole arrays on either side of the polynomial kernel instead of being
+ *  folded into the polynomial coefficients; explicit coefficients are only
+ *  computed by materialize().
+ *
+ *  The expression refers to, but does not own, the PolynomialTransform,
+ *  which must outlive it.
+ */
+class ComposedPolynomial {
+public:
+    ComposedPolynomial(geom::AffineTransform const& outer, PolynomialTransform const& poly,
+                       geom::AffineTransform const& inner, bool addIdentity = false)
+            : _outer(outer), _inner(inner), _poly(&poly), _addIdentity(addIdentity) {}
+
+    /**
+     *  Evaluate the expression at many points at once.
+     *
+     *  @param[in]  x     Input x coordinates.
+     *  @param[in]  y     Input y coordinates; must have the same size as x.
+     *  @param[out] out   Array of shape (N, 2) filled with the transformed points.
+     *
+     *  @throw pex::exceptions::LengthError if the array shapes are inconsistent.
+     */
+    void apply(ndarray::Array<double const, 1, 0> const& x, ndarray::Array<double const, 1, 0> const& y,
+               ndarray::Array<double, 2, 2> const& out) const;
+
+    /**
+     *  Compute a PolynomialTransform with explicit coefficients that is
+     *  equivalent to the expression.
+     *
+     *  This is the only operation that composes the affine transforms into
+     *  the polynomial coefficients.
+     */
+    PolynomialTransform materialize() const;
+
+private:
+    geom::AffineTransform _outer;
+    geom::AffineTransform _inner;
+    PolynomialTransform const* _poly;
+    bool _addIdentity;
+};
+
+}  // namespace detail
+}  // namespace astrom
+}  // namespace meas
+}  // namespace lsst
+
+#endif  // !LSST_MEAS_ASTROM_DETAIL_composedPolynomial_h_INCLUDED
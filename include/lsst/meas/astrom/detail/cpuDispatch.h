@@ -0,0 +1,99 @@
+// -*- LSST-C++ -*-
+
+/*
+ * This file is part of meas_astrom.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef LSST_MEAS_ASTROM_DETAIL_cpuDispatch_h_INCLUDED
+#define LSST_MEAS_ASTROM_DETAIL_cpuDispatch_h_INCLUDED
+
+/*
+ *  Support for compiling numeric kernels for several instruction sets and
+ *  choosing between them at runtime.
+ *
+ *  A dispatched kernel is written once as a force-inlined function, and then
+ *  wrapped in one function per instruction set, with the non-baseline
+ *  wrappers marked with the LSST_MEAS_ASTROM_TARGET_* attributes so the
+ *  compiler vectorizes the inlined body for that instruction set.  The
+ *  variant to call is selected (once) using getSimdLevel().
+ *
+ *  Only x86 with GCC-compatible compilers gets extra variants; elsewhere
+ *  LSST_MEAS_ASTROM_X86_DISPATCH is 0 and only the baseline variant exists.
+ */
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define LSST_MEAS_ASTROM_X86_DISPATCH 1
+#define LSST_MEAS_ASTROM_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define LSST_MEAS_ASTROM_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+#else
+#define LSST_MEAS_ASTROM_X86_DISPATCH 0
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LSST_MEAS_ASTROM_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define LSST_MEAS_ASTROM_ALWAYS_INLINE inline
+#endif
+
+namespace lsst {
+namespace meas {
+namespace astrom {
+namespace detail {
+
+/// Instruction sets that dispatched kernels may be compiled for, in increasing order.
+enum class SimdLevel { SCALAR = 0, AVX2 = 1, AVX512 = 2 };
+
+/**
+ *  Return the instruction set dispatched kernels should use.
+ *
+ *  This is determined on the first call from the CPU's reported features.
+ *  The MEAS_ASTROM_SIMD environment variable may be set to "scalar" to force
+ *  the baseline kernels (e.g. for bitwise reproducibility checks across
+ *  machines), or to "avx2" to disallow AVX-512; other values are ignored
+ *  with a warning.  The variable is read only once, so it must be set before
+ *  the first kernel is called.
+ */
+SimdLevel getSimdLevel();
+
+/// Return the most capable instruction set this CPU supports, ignoring MEAS_ASTROM_SIMD.
+SimdLevel detectSimdLevel();
+
+/**
+ *  Apply a MEAS_ASTROM_SIMD value to a detected instruction set, as
+ *  getSimdLevel() does.
+ *
+ *  @param[in]  detected   Level reported by detectSimdLevel().
+ *  @param[in]  requested  Value of MEAS_ASTROM_SIMD, or null if it is not set.
+ *
+ *  @return SCALAR for "scalar", at most AVX2 for "avx2", and detected for
+ *          "avx512", an empty string, null or (with a warning) anything else.
+ */
+SimdLevel applySimdOverride(SimdLevel detected, char const* requested);
+
+/// Return a lowercase name for a SimdLevel ("scalar", "avx2" or "avx512").
+char const* getSimdLevelName(SimdLevel level);
+
+}  // namespace detail
+}  // namespace astrom
+}  // namespace meas
+}  // namespace lsst
+
+#endif  // !LSST_MEAS_ASTROM_DETAIL_cpuDispatch_h_INCLUDED
@@ -0,0 +1,141 @@
+// -*- LSST-C++ -*-
+
+/*
+ * This file is part of meas_astrom.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef LSST_MEAS_ASTROM_DETAIL_functionBasis_h_INCLUDED
+#define LSST_MEAS_ASTROM_DETAIL_functionBasis_h_INCLUDED
+
+#include <memory>
+#include <vector>
+
+#include "Eigen/Core"
+
+#include "lsst/afw/math/FunctionLibrary.h"
+
+namespace lsst {
+namespace meas {
+namespace astrom {
+namespace detail {
+
+/// Recurrences that generate the basis functions of some afw::math::Function1 types
+enum class BasisRecurrence {
+    NONE,      ///< No known recurrence; evaluate each basis function through Function1
+    POWER,     ///< b_0 = 1, b_{k+1} = x b_k
+    CHEBYSHEV  ///< b_0 = 1, b_1 = x, b_{k+1} = 2 x b_k - b_{k-1}
+};
+
+/// The recurrence for the basis functions of FittingFunc, if any
+template <class FittingFunc>
+struct BasisRecurrenceOf {
+    static constexpr BasisRecurrence value = BasisRecurrence::NONE;
+};
+
+template <>
+struct BasisRecurrenceOf<afw::math::PolynomialFunction1<double>> {
+    static constexpr BasisRecurrence value = BasisRecurrence::POWER;
+};
+
+// Chebyshev1Function1 objects constructed from a parameter vector alone have
+// the range [-1, 1], so they need no rescaling of x.
+template <>
+struct BasisRecurrenceOf<afw::math::Chebyshev1Function1<double>> {
+    static constexpr BasisRecurrence value = BasisRecurrence::CHEBYSHEV;
+};
+
+/**
+ *  The basis functions of a one-dimensional function with a given number of
+ *  parameters.
+ *
+ *  Basis function k is the FittingFunc constructed from the k+1 parameters
+ *  [0, ..., 0, 1].
+ *  For polynomials and Chebyshev polynomials the basis is evaluated for a
+ *  whole array of points at once from the recurrence; otherwise each basis
+ *  function is evaluated through the virtual afw::math::Function1 interface.
+ */
+template <class FittingFunc>
+class FunctionBasis {
+public:
+    static constexpr BasisRecurrence recurrence = BasisRecurrenceOf<FittingFunc>::value;
+
+    explicit FunctionBasis(int nTerms) : _nTerms(nTerms) {
+        if (recurrence == BasisRecurrence::NONE) {
+            _funcs.reserve(nTerms);
+            std::vector<double> coeff;
+            coeff.reserve(nTerms);
+            coeff.push_back(1.0);
+            for (int k = 0; k < nTerms; ++k) {
+                _funcs.push_back(std::make_shared<FittingFunc>(coeff));
+                coeff[k] = 0.0;
+                coeff.push_back(1.0);  // coeff now looks like [0,0,...,0,1]
+            }
+        }
+    }
+
+    /// Return the number of basis functions
+    int getNTerms() const { return _nTerms; }
+
+    /// Return an array whose element (i, k) is basis function k evaluated at values[i]
+    Eigen::ArrayXXd evaluate(Eigen::ArrayXd const& values) const {
+        Eigen::ArrayXXd out(values.size(), _nTerms);
+        if (_nTerms == 0) {
+            return out;
+        }
+        switch (recurrence) {
+            case BasisRecurrence::POWER:
+                out.col(0).setOnes();
+                for (int k = 1; k < _nTerms; ++k) {
+                    out.col(k) = out.col(k - 1) * values;
+                }
+                break;
+            case BasisRecurrence::CHEBYSHEV:
+                out.col(0).setOnes();
+                if (_nTerms > 1) {
+                    out.col(1) = values;
+                }
+                for (int k = 2; k < _nTerms; ++k) {
+                    out.col(k) = 2.0 * values * out.col(k - 1) - out.col(k - 2);
+                }
+                break;
+            case BasisRecurrence::NONE:
+                for (int k = 0; k < _nTerms; ++k) {
+                    FittingFunc const& func = *_funcs[k];
+                    for (Eigen::Index i = 0; i < values.size(); ++i) {
+                        out(i, k) = func(values[i]);
+                    }
+                }
+                break;
+        }
+        return out;
+    }
+
+private:
+    int _nTerms;
+    std::vector<std::shared_ptr<FittingFunc>> _funcs;  // basis functions; only used without a recurrence
+};
+
+}  // namespace detail
+}  // namespace astrom
+}  // namespace meas
+}  // namespace lsst
+
+#endif  // !LSST_MEAS_ASTROM_DETAIL_functionBasis_h_INCLUDED
@@ -0,0 +1,96 @@
+// -*- LSST-C++ -*-
+
+/*
+ * This file is part of meas_astrom.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef LSST_MEAS_ASTROM_DETAIL_leastSqFactorization_h_INCLUDED
+#define LSST_MEAS_ASTROM_DETAIL_leastSqFactorization_h_INCLUDED
+
+#include <variant>
+
+#include "Eigen/Core"
+#include "Eigen/Cholesky"
+#include "Eigen/QR"
+#include "Eigen/SVD"
+
+#include "lsst/meas/astrom/sip/LeastSqSolver.h"
+
+namespace lsst {
+namespace meas {
+namespace astrom {
+namespace detail {
+
+/**
+ *  A factorization of a (weighted) least-squares design matrix A, which can
+ *  solve @f$\min |A x - b|@f$ for any number of right-hand sides b.
+ */
+class LeastSqFactorization {
+public:
+    /// Construct an empty factorization; it must be assigned to before use.
+    LeastSqFactorization() : _solver(sip::LeastSqSolver::AUTO) {}
+
+    /**
+     *  Factor the design matrix with the given algorithm.
+     *
+     *  With sip::LeastSqSolver::AUTO, the normal equations are used if
+     *  their condition number is at most 1e8 (so at most half the available
+     *  precision is lost), a QR decomposition if not, and an SVD if the
+     *  design matrix turns out to be rank-deficient.
+     */
+    LeastSqFactorization(Eigen::MatrixXd const& design, sip::LeastSqSolver solver);
+
+    /// Return the algorithm requested at construction.
+    sip::LeastSqSolver getSolver() const { return _solver; }
+
+    /**
+     *  Return the least-squares solution for each column of rhs, which must have one row per data point.
+     *
+     *  @throw pex::exceptions::LogicError if the factorization is empty.
+     */
+    Eigen::MatrixXd solve(Eigen::MatrixXd const& rhs) const;
+
+    /**
+     *  Return the diagonal of @f$(A^T A)^{-1}@f$, the variances of the parameters.
+     *
+     *  @throw pex::exceptions::LogicError if the factorization is empty.
+     */
+    Eigen::VectorXd computeVariance() const;
+
+private:
+    // The normal equations need the design matrix again to form A^T b.
+    struct NormalEquations {
+        Eigen::LDLT<Eigen::MatrixXd> ldlt;
+        Eigen::MatrixXd design;
+    };
+
+    sip::LeastSqSolver _solver;
+    std::variant<std::monostate, Eigen::ColPivHouseholderQR<Eigen::MatrixXd>, NormalEquations,
+                 Eigen::JacobiSVD<Eigen::MatrixXd>>
+            _factorization;
+};
+
+}  // namespace detail
+}  // namespace astrom
+}  // namespace meas
+}  // namespace lsst
+
+#endif  // !LSST_MEAS_ASTROM_DETAIL_leastSqFactorization_h_INCLUDED
@@ -0,0 +1,77 @@
+// -*- LSST-C++ -*-
+
+/*
+ * This file is part of meas_astrom.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef LSST_MEAS_ASTROM_DETAIL_matchStatistics_h_INCLUDED
+#define LSST_MEAS_ASTROM_DETAIL_matchStatistics_h_INCLUDED
+
+#include <vector>
+
+#include "lsst/geom/Point.h"
+#include "lsst/geom/SpherePoint.h"
+#include "lsst/afw/geom/SkyWcs.h"
+#include "lsst/afw/math/Statistics.h"
+
+namespace lsst {
+namespace meas {
+namespace astrom {
+namespace detail {
+
+/**
+ *  Compute statistics of the radial separation, in pixels, between reference
+ *  positions projected to pixels with a WCS and source centroids.
+ *
+ *  This is makeMatchStatisticsInPixels for positions that are not held in
+ *  a match list; refCoords[i] and srcPositions[i] are the two halves of
+ *  match i.
+ *
+ *  @throw pex::exceptions::LengthError if the two vectors differ in size.
+ *  @throw pex::exceptions::RuntimeError if they are empty.
+ */
+afw::math::Statistics makeMatchStatisticsInPixels(
+        afw::geom::SkyWcs const& wcs, std::vector<geom::SpherePoint> const& refCoords,
+        std::vector<geom::Point2D> const& srcPositions, int const flags,
+        afw::math::StatisticsControl const& sctrl = afw::math::StatisticsControl());
+
+/**
+ *  Compute statistics of the on-sky separation, in radians, between source
+ *  centroids projected to the sky with a WCS and reference positions.
+ *
+ *  This is makeMatchStatisticsInRadians for positions that are not held in
+ *  a match list; refCoords[i] and srcPositions[i] are the two halves of
+ *  match i.
+ *
+ *  @throw pex::exceptions::LengthError if the two vectors differ in size.
+ *  @throw pex::exceptions::RuntimeError if they are empty.
+ */
+afw::math::Statistics makeMatchStatisticsInRadians(
+        afw::geom::SkyWcs const& wcs, std::vector<geom::SpherePoint> const& refCoords,
+        std::vector<geom::Point2D> const& srcPositions, int const flags,
+        afw::math::StatisticsControl const& sctrl = afw::math::StatisticsControl());
+
+}  // namespace detail
+}  // namespace astrom
+}  // namespace meas
+}  // namespace lsst
+
+#endif  // !LSST_MEAS_ASTROM_DETAIL_matchStatistics_h_INCLUDED
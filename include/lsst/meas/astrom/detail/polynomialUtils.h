@@ -25,7 +25,11 @@
 #ifndef LSST_MEAS_ASTROM_DETAIL_polynomialUtils_h_INCLUDED
 #define LSST_MEAS_ASTROM_DETAIL_polynomialUtils_h_INCLUDED
 
+#include <array>
+
 #include "Eigen/Core"
+#include "ndarray.h"
+#include "lsst/meas/astrom/detail/cpuDispatch.h"
 
 namespace lsst {
 namespace meas {
@@ -65,6 +69,110 @@ void computePowers(Eigen::VectorXd& r, double x);
  */
 Eigen::VectorXd computePowers(double x, int n);
 
+/**
+ *  Fill an array with Chebyshev polynomials of the first kind evaluated at x,
+ *  so @f$r[n] == T_n(x)@f$.
+ *
+ *  This uses the standard three-term recurrence, and is the Chebyshev
+ *  analog of computePowers.
+ */
+void computeChebyshev(Eigen::VectorXd& r, double x);
+
+/**
+ *  Fill arrays with Chebyshev polynomials of the first kind and their first
+ *  derivatives evaluated at x, so @f$r[n] == T_n(x)@f$ and
+ *  @f$dr[n] == T_n^{\prime}(x)@f$.
+ */
+void computeChebyshev(Eigen::VectorXd& r, Eigen::VectorXd& dr, double x);
+
+/**
+ *  Return the matrix that converts Chebyshev coefficients to monomial
+ *  coefficients, so @f$T_n(x) = \sum_k M_{n,k} x^k@f$.
+ *
+ *  For a 2-d Chebyshev series with coefficient matrix @f$C@f$ (indexed as
+ *  [p, q] for @f$T_p(x) T_q(y)@f$), the equivalent monomial coefficients
+ *  are @f$M^T C M@f$.
+ */
+Eigen::MatrixXd makeChebyshevToMonomial(int order);
+
+/**
+ *  Evaluate a pair of 2-d polynomials at many points at once.
+ *
+ *  The coefficient matrices are indexed as in PolynomialTransform: element
+ *  [p, q] multiplies @f$u^p v^q@f$.  Powers of @f$v@f$ are computed
+ *  incrementally and the inner loops run over whole arrays of points, so
+ *  they can be vectorized by the compiler.  The kernel is compiled for
+ *  several instruction sets and selected at runtime; see getSimdLevel().
+ *
+ *  @param[in]  xCoeffs   Coefficients of the polynomial for the x output.
+ *  @param[in]  yCoeffs   Coefficients of the polynomial for the y output;
+ *                        must have the same shape as xCoeffs.
+ *  @param[in]  u         Input x coordinates.
+ *  @param[in]  v         Input y coordinates; must have the same size as u.
+ *  @param[out] x         Resized and filled with the x outputs.
+ *  @param[out] y         Resized and filled with the y outputs.
+ *
+ *  The outputs must not alias the inputs.
+ */
+void evaluatePolynomials(Eigen::Ref<Eigen::MatrixXd const> const& xCoeffs,
+                         Eigen::Ref<Eigen::MatrixXd const> const& yCoeffs, Eigen::ArrayXd const& u,
+                         Eigen::ArrayXd const& v, Eigen::ArrayXd& x, Eigen::ArrayXd& y);
+
+/**
+ *  Evaluate a pair of 2-d polynomials with the kernel for a particular
+ *  instruction set, rather than the one chosen by getSimdLevel().
+ *
+ *  The level is capped at detectSimdLevel(), so this is safe to call with
+ *  any level on any CPU.  This is intended for testing the kernels against
+ *  each other.
+ */
+void evaluatePolynomials(Eigen::Ref<Eigen::MatrixXd const> const& xCoeffs,
+                         Eigen::Ref<Eigen::MatrixXd const> const& yCoeffs, Eigen::ArrayXd const& u,
+                         Eigen::ArrayXd const& v, Eigen::ArrayXd& x, Eigen::ArrayXd& y, SimdLevel level);
+
+/**
+ *  Check that the arrays passed to a batch transform method have consistent
+ *  shapes, and return the number of points.
+ *
+ *  @param[in]  x         Input x coordinates.
+ *  @param[in]  y         Input y coordinates; must have the same size as x.
+ *  @param[in]  out       Output positions; must have shape (N, 2).
+ *
+ *  @throw pex::exceptions::LengthError if the shapes are inconsistent.
+ */
+std::size_t checkBatchShapes(ndarray::Array<double const, 1, 0> const& x,
+                             ndarray::Array<double const, 1, 0> const& y,
+                             ndarray::Array<double, 2, 2> const& out);
+
+/**
+ *  Check that the arrays passed to a batch linearize method have consistent
+ *  shapes, and return the number of points.
+ *
+ *  As above, but also checks that jacobian has shape (N, 2, 2).
+ */
+std::size_t checkBatchShapes(ndarray::Array<double const, 1, 0> const& x,
+                             ndarray::Array<double const, 1, 0> const& y,
+                             ndarray::Array<double, 2, 2> const& out,
+                             ndarray::Array<double, 3, 3> const& jacobian);
+
+/**
+ *  Compute a table of binomial coefficients at compile time.
+ *
+ *  Uses the same recurrence as BinomialMatrix; see that class for details.
+ */
+template <int N>
+constexpr std::array<std::array<double, N + 1>, N + 1> makeBinomialTable() {
+    std::array<std::array<double, N + 1>, N + 1> table = {};
+    for (int i = 0; i <= N; ++i) {
+        table[i][0] = 1.0;
+        table[i][i] = 1.0;
+        for (int j = 1; j < i; ++j) {
+            table[i][j] = table[i - 1][j - 1] * (static_cast<double>(i) / static_cast<double>(j));
+        }
+    }
+    return table;
+}
+
 /**
  *  A class that computes binomial coefficients up to a certain power.
  *
@@ -79,15 +187,22 @@ Eigen::VectorXd computePowers(double x, int n);
  *  with both @f$n@f$ and @f$k@f$ nonnegative integers and @f$k \le n@f$
  *
  *  This class uses recurrence relations to avoid computing factorials directly,
- *  making it both more efficient and numerically stable.
+ *  making it both more efficient and numerically stable.  All coefficients
+ *  with @f$n \le@f$ MAX_N are computed at compile time, so instances are
+ *  trivially cheap to construct and safe to use from multiple threads.
  */
 class BinomialMatrix {
 public:
+    /// The largest value of @f$n@f$ supported.
+    static constexpr int MAX_N = 20;
+
     /**
      *  Construct an object that can compute binomial coefficients with @f$n@f$
      *  up to and including the given value.
+     *
+     *  @throw pex::exceptions::LengthError if nMax > MAX_N.
      */
-    explicit BinomialMatrix(int const nMax) { extend(nMax); }
+    explicit BinomialMatrix(int const nMax);
 
     /**
      *  Return the binomial coefficient.
@@ -98,12 +213,11 @@ public:
      *  n <= nMax && k <= n && n >=0 && k >= 0
      *  @endcode
      */
-    double operator()(int n, int k) const { return getMatrix()(n, k); }
+    double operator()(int n, int k) const { return _table[n][k]; }
 
 private:
-    static void extend(int const n);
-
-    static Eigen::MatrixXd& getMatrix();
+    static constexpr std::array<std::array<double, MAX_N + 1>, MAX_N + 1> _table =
+            makeBinomialTable<MAX_N>();
 };
 
 }  // namespace detail
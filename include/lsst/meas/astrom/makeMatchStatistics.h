@@ -82,6 +82,49 @@ afw::math::Statistics makeMatchStatisticsInRadians(
         afw::geom::SkyWcs const& wcs, std::vector<MatchT> const& matchList, int const flags,
         afw::math::StatisticsControl const& sctrl = afw::math::StatisticsControl());
 
+/**
+ * Statistics of the radial separations between the reference objects and sources of a match list
+ */
+struct SeparationStatistics {
+    double median;                  ///< median separation
+    double meanClip;                ///< clipped mean separation, as for afw::math::MEANCLIP
+    double stdevClip;               ///< clipped standard deviation, as for afw::math::STDEVCLIP
+    std::vector<double> quantiles;  ///< separation at each requested quantile
+};
+
+/**
+ * Statistics of the on-detector and on-sky separations of a match list; see makeMatchSeparationStatistics
+ */
+struct MatchSeparationStatistics {
+    SeparationStatistics pixels;   ///< on-detector radial separation, in pixels
+    SeparationStatistics radians;  ///< on-sky radial separation, in radians
+};
+
+/**
+ * Compute statistics of both the on-detector and on-sky radial separations for a match list
+ *
+ * This is equivalent to calling makeMatchStatisticsInPixels and makeMatchStatisticsInRadians with
+ * MEDIAN | MEANCLIP | STDEVCLIP, but transforms the matches with one WCS call in each direction and
+ * also computes arbitrary quantiles. Quantiles interpolate linearly between the nearest separations,
+ * as the median does, and are found by selection rather than by sorting. Non-finite separations are
+ * ignored.
+ *
+ * @param[in] wcs  WCS describing pixel to sky transformation
+ * @param[in] matchList  list of matchList between reference objects and sources; fields read:
+ *                  - first: reference object; only the coord is read
+ *                  - second: source; only the centroid is read
+ * @param[in] quantiles  fractions in [0, 1] at which to compute quantiles of the separations
+ * @param[in] sctrl  statistics configuration, used for the median and clipped statistics
+ *
+ * @throws lsst::pex::exceptions::RuntimeError if matchList is empty
+ * @throws lsst::pex::exceptions::InvalidParameterError if a quantile is not in [0, 1]
+ */
+template <typename MatchT>
+MatchSeparationStatistics makeMatchSeparationStatistics(
+        afw::geom::SkyWcs const& wcs, std::vector<MatchT> const& matchList,
+        std::vector<double> const& quantiles = std::vector<double>(),
+        afw::math::StatisticsControl const& sctrl = afw::math::StatisticsControl());
+
 }  // namespace astrom
 }  // namespace meas
 }  // namespace lsst
@@ -30,10 +30,13 @@
 
 #include "lsst/base.h"
 #include "Eigen/Core"
+#include "ndarray.h"
 
 #include "lsst/afw/table/Match.h"
 #include "lsst/geom/Angle.h"
 #include "lsst/geom/Box.h"
+#include "lsst/geom/SpherePoint.h"
+#include "lsst/meas/astrom/sip/LeastSqSolver.h"
 
 namespace lsst {
 namespace meas {
@@ -71,6 +74,10 @@ namespace sip {
  \endcode
 
  Note that the matches must be one-to-one; this is ensured by passing closest=true to matchRaDec.
+
+ The positions may also be given as plain arrays of reference ICRS coordinates and source
+ centroids, which avoids creating table records for synthetic or numpy-driven inputs; the
+ match type MatchT is then irrelevant.
  */
 template <class MatchT>
 class CreateWcsWithSip {
@@ -91,9 +98,45 @@ public:
                          Specifially the box is grown by dimensions/sqrt(number of matches).
      \param[in] ngrid  number of points along x or y for the grid of points on which
                          the reverse SIP transform is computed
+     \param[in] solver  algorithm for the least-squares fits of the forward and reverse
+                         SIP polynomials
+     \param[in] reverseTolerance  if positive, sample the reverse SIP transform adaptively:
+                         starting from the ngrid x ngrid grid (by default, the coarsest grid
+                         that constrains the reverse polynomial), grid cells where the round
+                         trip through the forward and reverse transforms misses the cell
+                         centre by more than this many pixels are repeatedly split into
+                         four, adding samples.  After each refit every cell is checked
+                         again; refinement stops when all cells meet the tolerance, after
+                         4 levels of splitting, or when the refit does not reduce the worst
+                         error over the cells (in which case the previous, better fit is
+                         kept).
      */
     CreateWcsWithSip(std::vector<MatchT> const& matches, afw::geom::SkyWcs const& linearWcs, int const order,
-                     geom::Box2I const& bbox = geom::Box2I(), int const ngrid = 0);
+                     geom::Box2I const& bbox = geom::Box2I(), int const ngrid = 0,
+                     LeastSqSolver const solver = LeastSqSolver::AUTO, double const reverseTolerance = 0.0);
+
+    /**
+     Construct a CreateWcsWithSip from arrays of matched positions
+
+     \param[in] ra  ICRS right ascension of the reference objects, in radians
+     \param[in] dec  ICRS declination of the reference objects, in radians
+     \param[in] x  x centroids of the matched sources, in pixels
+     \param[in] y  y centroids of the matched sources, in pixels
+     \param[in] linearWcs, order, bbox, ngrid, solver, reverseTolerance  as for the
+                         constructor from matches
+     \param[in] errors  centroid uncertainties, in pixels, with which to weight the
+                         forward fit; if empty, all points have equal weight
+
+     \throw lsst::pex::exceptions::LengthError if the arrays have different sizes
+     \throw lsst::pex::exceptions::InvalidParameterError if an error is not positive and finite
+     */
+    CreateWcsWithSip(ndarray::Array<double const, 1, 0> const& ra,
+                     ndarray::Array<double const, 1, 0> const& dec,
+                     ndarray::Array<double const, 1, 0> const& x, ndarray::Array<double const, 1, 0> const& y,
+                     afw::geom::SkyWcs const& linearWcs, int const order,
+                     geom::Box2I const& bbox = geom::Box2I(), int const ngrid = 0,
+                     LeastSqSolver const solver = LeastSqSolver::AUTO, double const reverseTolerance = 0.0,
+                     ndarray::Array<double const, 1, 0> const& errors = ndarray::Array<double const, 1, 0>());
 
     std::shared_ptr<afw::geom::SkyWcs> getNewWcs() { return _newWcs; }
 
@@ -132,9 +175,15 @@ public:
     /// Return the number of terms in the SIP matrix
     int getOrder() const { return _sipA.rows(); }
     /// Return the number of points in the catalogue
-    int getNPoints() const { return _matches.size(); }
+    int getNPoints() const { return _srcX.size(); }
     /// Return the number of grid points (on each axis) used in inverse SIP transform
     int getNGrid() const { return _ngrid; }
+    /// Return the algorithm used for the least-squares fits
+    LeastSqSolver getSolver() const { return _solver; }
+    /// Return the round-trip tolerance (pixels) for adaptive sampling; 0 if not adaptive
+    double getReverseTolerance() const { return _reverseTolerance; }
+    /// Return the number of points used to fit the reverse SIP transform
+    int getNReverseSamples() const { return _nReverseSamples; }
 
     // Return the SIP A matrix
     Eigen::MatrixXd const getSipA() { return _sipA; }
@@ -146,13 +195,24 @@ public:
     Eigen::MatrixXd const getSipBp() { return _sipBp; }
 
 private:
-    std::vector<MatchT> const _matches;
+    CreateWcsWithSip(std::vector<geom::SpherePoint>&& refCoords, Eigen::ArrayXd&& srcX, Eigen::ArrayXd&& srcY,
+                     Eigen::ArrayXd&& weights, afw::geom::SkyWcs const& linearWcs, int const order,
+                     geom::Box2I const& bbox, int const ngrid, LeastSqSolver const solver,
+                     double const reverseTolerance);
+
+    // Reference positions and source centroids of the matches
+    std::vector<geom::SpherePoint> const _refCoords;
+    Eigen::ArrayXd const _srcX, _srcY;
+    Eigen::ArrayXd const _weights;  // weights of the forward fit; empty if unweighted
     geom::Box2I mutable _bbox;
     int _ngrid;  // grid size to calculate inverse SIP coefficients (1-D)
     std::shared_ptr<const afw::geom::SkyWcs> _linearWcs;
     // _sipOrder is polynomial order for forward transform.
     // _reverseSipOrder is order for reverse transform, not necessarily the same.
     int const _sipOrder, _reverseSipOrder;
+    LeastSqSolver const _solver;
+    double const _reverseTolerance;
+    int _nReverseSamples;  // number of points used to fit the reverse SIP transform
 
     Eigen::MatrixXd _sipA, _sipB;
     Eigen::MatrixXd _sipAp, _sipBp;
@@ -161,16 +221,134 @@ private:
 
     void _calculateForwardMatrices();
     void _calculateReverseMatrices();
+    // Compute U, V = u + A(u, v), v + B(u, v) for SIP coefficient matrices A and B
+    void _applySip(Eigen::MatrixXd const& sipA, Eigen::MatrixXd const& sipB, Eigen::ArrayXd const& u,
+                   Eigen::ArrayXd const& v, Eigen::ArrayXd& U, Eigen::ArrayXd& V) const;
+    // Fit _sipAp and _sipBp to map U, V back to u, v
+    void _fitReverseMatrices(Eigen::ArrayXd const& u, Eigen::ArrayXd const& v, Eigen::ArrayXd const& U,
+                             Eigen::ArrayXd const& V);
 };
 
 /// Factory function for CreateWcsWithSip
 template <class MatchT>
 CreateWcsWithSip<MatchT> makeCreateWcsWithSip(std::vector<MatchT> const& matches,
                                               afw::geom::SkyWcs const& linearWcs, int const order,
-                                              geom::Box2I const& bbox = geom::Box2I(), int const ngrid = 0) {
-    return CreateWcsWithSip<MatchT>(matches, linearWcs, order, bbox, ngrid);
+                                              geom::Box2I const& bbox = geom::Box2I(), int const ngrid = 0,
+                                              LeastSqSolver const solver = LeastSqSolver::AUTO,
+                                              double const reverseTolerance = 0.0) {
+    return CreateWcsWithSip<MatchT>(matches, linearWcs, order, bbox, ngrid, solver, reverseTolerance);
+}
+
+/// Factory function for CreateWcsWithSip from arrays of matched positions
+inline CreateWcsWithSip<afw::table::ReferenceMatch> makeCreateWcsWithSip(
+        ndarray::Array<double const, 1, 0> const& ra, ndarray::Array<double const, 1, 0> const& dec,
+        ndarray::Array<double const, 1, 0> const& x, ndarray::Array<double const, 1, 0> const& y,
+        afw::geom::SkyWcs const& linearWcs, int const order, geom::Box2I const& bbox = geom::Box2I(),
+        int const ngrid = 0, LeastSqSolver const solver = LeastSqSolver::AUTO,
+        double const reverseTolerance = 0.0,
+        ndarray::Array<double const, 1, 0> const& errors = ndarray::Array<double const, 1, 0>()) {
+    return CreateWcsWithSip<afw::table::ReferenceMatch>(ra, dec, x, y, linearWcs, order, bbox, ngrid, solver,
+                                                        reverseTolerance, errors);
 }
 
+/// Result of fitTanSipWcsWithRejection
+struct FitTanSipWcsResult {
+    /// Final fit WCS
+    std::shared_ptr<afw::geom::SkyWcs> wcs;
+    /// Flags for the matches that were rejected from the final fit, in input order
+    ndarray::Array<bool, 1, 1> rejected;
+    /// Median on-sky scatter of the unrejected matches after each fit, the last being the final fit
+    std::vector<geom::Angle> scatterOnSky;
+    /// Number of matches rejected after each rejection iteration
+    std::vector<int> nRejected;
+};
+
+/**
+ Fit a TAN-SIP WCS with iterative outlier rejection
+
+ This runs the fit and rejection loop of FitTanSipWcsTask: each of numRejIter rejection
+ iterations fits the unrejected matches (numIter successive CreateWcsWithSip fits, each starting
+ from the previous WCS), then flags matches whose pixel residuals exceed rejSigma times their
+ standard deviation over the unrejected matches; a final fit then uses the matches that survive.
+ The reference positions and source centroids are read only once, and rejection is applied by
+ masking rather than by rebuilding the match list.
+
+ \param[in] matches  list of matches; they are not modified
+ \param[in] initWcs  initial WCS
+ \param[in] order  SIP order for fit WCS
+ \param[in] numIter  number of successive fits for each set of unrejected matches
+ \param[in] numRejIter  number of rejection iterations
+ \param[in] rejSigma  number of standard deviations for clipping
+ \param[in] bbox  bounding box for CreateWcsWithSip
+ \param[in] solver  algorithm for the least-squares fits
+
+ \throw lsst::pex::exceptions::RuntimeError if all matches are rejected
+ */
+template <class MatchT>
+FitTanSipWcsResult fitTanSipWcsWithRejection(std::vector<MatchT> const& matches,
+                                             afw::geom::SkyWcs const& initWcs, int const order,
+                                             int const numIter, int const numRejIter, double const rejSigma,
+                                             geom::Box2I const& bbox = geom::Box2I(),
+                                             LeastSqSolver const solver = LeastSqSolver::AUTO);
+
+/**
+ Fit a TAN-SIP WCS with iterative outlier rejection to arrays of matched positions
+
+ \param[in] ra, dec  ICRS coordinates of the reference objects, in radians
+ \param[in] x, y  centroids of the matched sources, in pixels
+ \param[in] initWcs, order, numIter, numRejIter, rejSigma, bbox, solver  as for the
+                   overload that takes matches
+ \param[in] errors  centroid uncertainties, in pixels, with which to weight the fits;
+                   if empty, all points have equal weight
+
+ \throw lsst::pex::exceptions::LengthError if the arrays have different sizes
+ \throw lsst::pex::exceptions::RuntimeError if all matches are rejected
+ */
+FitTanSipWcsResult fitTanSipWcsWithRejection(
+        ndarray::Array<double const, 1, 0> const& ra, ndarray::Array<double const, 1, 0> const& dec,
+        ndarray::Array<double const, 1, 0> const& x, ndarray::Array<double const, 1, 0> const& y,
+        afw::geom::SkyWcs const& initWcs, int const order, int const numIter, int const numRejIter,
+        double const rejSigma, geom::Box2I const& bbox = geom::Box2I(),
+        LeastSqSolver const solver = LeastSqSolver::AUTO,
+        ndarray::Array<double const, 1, 0> const& errors = ndarray::Array<double const, 1, 0>());
+
+/// Result of approximateWcsWithSip
+struct ApproximateWcsResult {
+    /// Fit TAN-SIP WCS
+    std::shared_ptr<afw::geom::SkyWcs> wcs;
+    /// Maximum on-sky separation between the input and fit WCS over the verification grid
+    geom::Angle maxSkyDiff;
+    /// Maximum pixel separation between the input and fit WCS over the verification grid
+    double maxPixelDiff;
+};
+
+/**
+ Approximate a WCS as a TAN-SIP WCS
+
+ The input WCS is evaluated on a uniform nx x ny grid of pixel positions covering bbox, and
+ a TAN-SIP WCS is fit to those positions iterations times, each fit starting from the previous
+ WCS. The fit is then compared with the input WCS on an nxVerify x nyVerify grid covering bbox,
+ in the same way as lsst.afw.geom.utils.assertWcsAlmostEqualOverBBox: maxSkyDiff is the largest
+ separation between the sky positions of a grid point according to the two WCS, and maxPixelDiff
+ the largest separation between the pixel positions of those sky positions (computed with the
+ input WCS) according to the two WCS. Either is NaN if the comparison fails at any grid point.
+
+ \param[in] wcs  WCS to approximate
+ \param[in] bbox  region over which the WCS is fit and verified
+ \param[in] order  SIP order of the fit
+ \param[in] nx, ny  number of grid points along x and y for the fit
+ \param[in] iterations  number of successive fits
+ \param[in] useTanWcs  if true, start from the TAN WCS with the same CRPIX, CRVAL and
+                        local CD matrix at CRPIX as wcs, rather than from wcs itself
+ \param[in] nxVerify, nyVerify  number of grid points along x and y for the verification
+
+ \throw lsst::pex::exceptions::InvalidParameterError if a grid size or iterations is less than 1
+ */
+ApproximateWcsResult approximateWcsWithSip(afw::geom::SkyWcs const& wcs, geom::Box2I const& bbox,
+                                           int const order = 3, int const nx = 20, int const ny = 20,
+                                           int const iterations = 3, bool const useTanWcs = false,
+                                           int const nxVerify = 5, int const nyVerify = 5);
+
 }  // namespace sip
 }  // namespace astrom
 }  // namespace meas
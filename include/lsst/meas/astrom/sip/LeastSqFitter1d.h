@@ -25,15 +25,20 @@
 #ifndef LEAST_SQ_FITTER_1D
 #define LEAST_SQ_FITTER_1D
 
+#include <algorithm>
 #include <cstdio>
-#include <memory>
 #include <vector>
 
 #include "Eigen/Core"
 #include "Eigen/SVD"
+#include "ndarray.h"
+#include "ndarray/eigen.h"
 
 #include "lsst/pex/exceptions/Runtime.h"
 #include "lsst/afw/math/FunctionLibrary.h"
+#include "lsst/meas/astrom/detail/functionBasis.h"
+#include "lsst/meas/astrom/detail/leastSqFactorization.h"
+#include "lsst/meas/astrom/sip/LeastSqSolver.h"
 
 namespace lsst {
 namespace meas {
@@ -50,12 +55,18 @@ order is order of the polynomial to fit (e.g if the templated function is
 lsst::afw::math::PolynomialFunction1, then order=3 => fit a function of the form \f$ax^2+bx+c\f$
 
 \tparam FittingFunc The 1d function to fit in both dimensions. Must inherit from
-lsst::afw::math::Function1
+lsst::afw::math::Function1. The design matrix is filled from the polynomial or
+Chebyshev recurrence for lsst::afw::math::PolynomialFunction1 and
+lsst::afw::math::Chebyshev1Function1, and through Function1 otherwise.
 
 \param x Ordinate of points to fit
 \param y Co-ordinate of pionts to fit
 \param s 1\f$\sigma\f$ uncertainties in z
 \param order Polynomial order to fit
+\param solver Factorization of the design matrix to use
+
+The factorization is kept, so getParamsFor() can fit further sets of y values at the
+same x and s without refactoring.
 
 \sa LeastSqFitter1d
 */
@@ -64,30 +75,34 @@ template <class FittingFunc>
 class LeastSqFitter1d {
 public:
     LeastSqFitter1d(const std::vector<double> &x, const std::vector<double> &y, const std::vector<double> &s,
-                    int order);
+                    int order, LeastSqSolver solver = LeastSqSolver::SVD);
 
     Eigen::VectorXd getParams();
+    Eigen::MatrixXd getParamsFor(Eigen::MatrixXd const &y) const;
     Eigen::VectorXd getErrors();
+    LeastSqSolver getSolver() const { return _factorization.getSolver(); }
     FittingFunc getBestFitFunction();
     double valueAt(double x);
+    ndarray::Array<double, 1, 1> valueAt(ndarray::Array<double const, 1, 0> const &x) const;
     std::vector<double> residuals();
 
     double getChiSq();
     double getReducedChiSq();
 
 private:
-    void initFunctions();
-
-    double func1d(double value, int exponent);
+    Eigen::VectorXd valuesAt(Eigen::ArrayXd const &x) const;
 
     std::vector<double> _x, _y, _s;
     int _order;  // Degree of polynomial to fit, e.g 4=> cubic
     int _nData;  // Number of data points, == _x.size()
 
-    Eigen::JacobiSVD<Eigen::MatrixXd> _svd;
+    detail::LeastSqFactorization _factorization;
     Eigen::VectorXd _par;
+    Eigen::ArrayXd _residuals;  // y - f(x) at the data points
+    double _chiSq;
+    Eigen::VectorXd _errors;    // computed on first use
 
-    std::vector<std::shared_ptr<FittingFunc> > _funcArray;
+    detail::FunctionBasis<FittingFunc> _basis;
 };
 
 // The .cc part
@@ -100,10 +115,11 @@ private:
 ///\param y vector of y positions of data
 ///\param s Vector of measured uncertainties in the values of z
 ///\param order Order of 2d function to fit
+///\param solver Factorization of the design matrix to use
 template <class FittingFunc>
 LeastSqFitter1d<FittingFunc>::LeastSqFitter1d(const std::vector<double> &x, const std::vector<double> &y,
-                                              const std::vector<double> &s, int order)
-        : _x(x), _y(y), _s(s), _order(order) {
+                                              const std::vector<double> &s, int order, LeastSqSolver solver)
+        : _x(x), _y(y), _s(s), _order(order), _basis(std::max(order, 0)) {
     if (order == 0) {
         throw LSST_EXCEPT(pex::exceptions::RuntimeError, "Fit order must be >= 1");
     }
@@ -120,18 +136,18 @@ LeastSqFitter1d<FittingFunc>::LeastSqFitter1d(const std::vector<double> &x, cons
         throw LSST_EXCEPT(pex::exceptions::RuntimeError, "Fewer data points than parameters");
     }
 
-    initFunctions();
-
-    Eigen::MatrixXd design(_nData, _order);
-    Eigen::VectorXd rhs(_nData);
-    for (int i = 0; i < _nData; ++i) {
-        rhs[i] = y[i] / _s[i];
-        for (int j = 0; j < _order; ++j) {
-            design(i, j) = func1d(_x[i], j) / _s[i];
-        }
-    }
-    _svd.compute(design, Eigen::ComputeThinU | Eigen::ComputeThinV);
-    _par = _svd.solve(rhs);
+    Eigen::Map<Eigen::ArrayXd const> const xArr(_x.data(), _nData);
+    Eigen::Map<Eigen::ArrayXd const> const yArr(_y.data(), _nData);
+    Eigen::Map<Eigen::ArrayXd const> const sArr(_s.data(), _nData);
+    Eigen::MatrixXd const design = (_basis.evaluate(xArr).colwise() / sArr).matrix();
+    Eigen::VectorXd const rhs = (yArr / sArr).matrix();
+    _factorization = detail::LeastSqFactorization(design, solver);
+    _par = _factorization.solve(rhs);
+
+    // The design matrix is weighted by 1/s, so this gives the weighted residuals
+    Eigen::ArrayXd const weightedResiduals = (rhs - design * _par).array();
+    _residuals = weightedResiduals * sArr;
+    _chiSq = weightedResiduals.square().sum();
 }
 
 /// Return the best fit parameters as an Eigen::Matrix
@@ -144,15 +160,25 @@ Eigen::VectorXd LeastSqFitter1d<FittingFunc>::getParams() {
     return vec;
 }
 
+/// Return the best fit parameters for each column of y, a matrix with one row per data
+/// point, fit at the same x and with the same uncertainties s as the constructor's y.
+/// Column j of the result holds the parameters for column j of y.
+template <class FittingFunc>
+Eigen::MatrixXd LeastSqFitter1d<FittingFunc>::getParamsFor(Eigen::MatrixXd const &y) const {
+    if (y.rows() != _nData) {
+        throw LSST_EXCEPT(pex::exceptions::RuntimeError, "y matrix and x vector of different lengths");
+    }
+    Eigen::Map<Eigen::ArrayXd const> const sArr(_s.data(), _nData);
+    return _factorization.solve((y.array().colwise() / sArr).matrix());
+}
+
 /// Return the 1 sigma uncertainties in the best fit parameters as an Eigen::Matrix
 template <class FittingFunc>
 Eigen::VectorXd LeastSqFitter1d<FittingFunc>::getErrors() {
-    Eigen::ArrayXd variance(_order);
-    for (int i = 0; i < _order; ++i) {
-        variance[i] = _svd.matrixV().row(i).dot(
-                (_svd.singularValues().array().inverse().square() * _svd.matrixV().col(i).array()).matrix());
+    if (_errors.size() == 0) {
+        _errors = _factorization.computeVariance().cwiseSqrt();
     }
-    return variance.sqrt().matrix();
+    return _errors;
 }
 
 /// Return the best fit polynomial as a lsst::afw::math::Function1 object
@@ -171,25 +197,23 @@ FittingFunc LeastSqFitter1d<FittingFunc>::getBestFitFunction() {
 /// Calculate the value of the function at a given point
 template <class FittingFunc>
 double LeastSqFitter1d<FittingFunc>::valueAt(double x) {
-    FittingFunc f = getBestFitFunction();
+    return valuesAt(Eigen::ArrayXd::Constant(1, x))[0];
+}
 
-    return f(x);
+/// Calculate the value of the function at each element of an array
+template <class FittingFunc>
+ndarray::Array<double, 1, 1> LeastSqFitter1d<FittingFunc>::valueAt(
+        ndarray::Array<double const, 1, 0> const &x) const {
+    ndarray::Array<double, 1, 1> out = ndarray::allocate(x.getSize<0>());
+    ndarray::asEigenMatrix(out) = valuesAt(ndarray::asEigenArray(x));
+    return out;
 }
 
 /// Return a vector of residuals of the fit (i.e the difference between the input y values, and
 /// the value of the fitting function at that point.
 template <class FittingFunc>
 std::vector<double> LeastSqFitter1d<FittingFunc>::residuals() {
-    std::vector<double> out;
-    out.reserve(_nData);
-
-    FittingFunc f = getBestFitFunction();
-
-    for (int i = 0; i < _nData; ++i) {
-        out.push_back(_y[i] - f(_x[i]));
-    }
-
-    return out;
+    return std::vector<double>(_residuals.data(), _residuals.data() + _residuals.size());
 }
 
 /// \brief Return a measure of the goodness of fit.
@@ -197,16 +221,7 @@ std::vector<double> LeastSqFitter1d<FittingFunc>::residuals() {
 ///
 template <class FittingFunc>
 double LeastSqFitter1d<FittingFunc>::getChiSq() {
-    FittingFunc f = getBestFitFunction();
-
-    double chisq = 0;
-    for (int i = 0; i < _nData; ++i) {
-        double val = _y[i] - f(_x[i]);
-        val /= _s[i];
-        chisq += pow(val, 2);
-    }
-
-    return chisq;
+    return _chiSq;
 }
 
 /// \brief Return a measure of the goodness of fit.
@@ -219,27 +234,10 @@ double LeastSqFitter1d<FittingFunc>::getReducedChiSq() {
     return getChiSq() / (double)(_nData - _order);
 }
 
-/// Initialise the array of functions. _funcArray[i] is a object of type math::Function1 of order
-///_norder
-template <class FittingFunc>
-void LeastSqFitter1d<FittingFunc>::initFunctions() {
-    _funcArray.reserve(_order);
-
-    std::vector<double> coeff;
-    coeff.reserve(_order);
-
-    coeff.push_back(1.0);
-    for (int i = 0; i < _order; ++i) {
-        std::shared_ptr<FittingFunc> p(new FittingFunc(coeff));
-        _funcArray.push_back(p);
-        coeff[i] = 0.0;
-        coeff.push_back(1.0);  // coeff now looks like [0,0,...,0,1]
-    }
-}
-
+/// Calculate the value of the function at each of a set of points
 template <class FittingFunc>
-double LeastSqFitter1d<FittingFunc>::func1d(double value, int exponent) {
-    return (*_funcArray[exponent])(value);
+Eigen::VectorXd LeastSqFitter1d<FittingFunc>::valuesAt(Eigen::ArrayXd const &x) const {
+    return _basis.evaluate(x).matrix() * _par;
 }
 
 }  // namespace sip
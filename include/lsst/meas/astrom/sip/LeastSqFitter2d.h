@@ -25,15 +25,21 @@
 #ifndef LEAST_SQ_FITTER_2D
 #define LEAST_SQ_FITTER_2D
 
+#include <algorithm>
 #include <cstdio>
-#include <memory>
+#include <utility>
 #include <vector>
 
 #include "Eigen/Core"
 #include "Eigen/SVD"
+#include "ndarray.h"
+#include "ndarray/eigen.h"
 
 #include "lsst/pex/exceptions/Runtime.h"
 #include "lsst/afw/math/FunctionLibrary.h"
+#include "lsst/meas/astrom/detail/functionBasis.h"
+#include "lsst/meas/astrom/detail/leastSqFactorization.h"
+#include "lsst/meas/astrom/sip/LeastSqSolver.h"
 
 namespace lsst {
 namespace meas {
@@ -51,13 +57,19 @@ order is order of the polynomial to fit (e.g if the templated function is
 lsst::afw::math::PolynomialFunction1, then order=3 => fit a function of the form \f$ax^2+bx+c\f$
 
 \tparam FittingFunc The 1d function to fit in both dimensions. Must inherit from
-lsst::afw::math::Function1
+lsst::afw::math::Function1. The design matrix is filled from the polynomial or
+Chebyshev recurrence for lsst::afw::math::PolynomialFunction1 and
+lsst::afw::math::Chebyshev1Function1, and through Function1 otherwise.
 
 \param x Ordinate of points to fit
 \param y Ordinate of points to fit
 \param z Co-ordinate of pionts to fit
 \param s 1\f$\sigma\f$ uncertainties in z
 \param order Polynomial order to fit
+\param solver Factorization of the design matrix to use
+
+The factorization is kept, so getParamsFor() can fit further sets of z values at the
+same x, y and s without refactoring.
 
 \sa LeastSqFitter1d
 */
@@ -65,33 +77,39 @@ template <class FittingFunc>
 class LeastSqFitter2d {
 public:
     LeastSqFitter2d(const std::vector<double> &x, const std::vector<double> &y, const std::vector<double> &z,
-                    const std::vector<double> &s, int order);
+                    const std::vector<double> &s, int order, LeastSqSolver solver = LeastSqSolver::SVD);
 
     Eigen::MatrixXd getParams();
+    std::vector<Eigen::MatrixXd> getParamsFor(Eigen::MatrixXd const &z) const;
     Eigen::MatrixXd getErrors();
+    LeastSqSolver getSolver() const { return _factorization.getSolver(); }
     double valueAt(double x, double y);
+    ndarray::Array<double, 1, 1> valueAt(ndarray::Array<double const, 1, 0> const &x,
+                                         ndarray::Array<double const, 1, 0> const &y) const;
     std::vector<double> residuals();
 
     double getChiSq();
     double getReducedChiSq();
 
 private:
-    void initFunctions();
-
     Eigen::MatrixXd expandParams(Eigen::VectorXd const &input) const;
 
-    double func2d(double x, double y, int term);
-    double func1d(double value, int exponent);
+    Eigen::MatrixXd designMatrix(Eigen::ArrayXd const &x, Eigen::ArrayXd const &y) const;
+    Eigen::VectorXd valuesAt(Eigen::ArrayXd const &x, Eigen::ArrayXd const &y) const;
 
     std::vector<double> _x, _y, _z, _s;
     int _order;  // Degree of polynomial to fit, e.g 4=> cubic
     int _nPar;   // Number of parameters in fitting eqn, e.g x^2, xy, y^2, x^3,
     int _nData;  // Number of data points, == _x.size()
 
-    Eigen::JacobiSVD<Eigen::MatrixXd> _svd;
+    detail::LeastSqFactorization _factorization;
     Eigen::VectorXd _par;
+    Eigen::ArrayXd _residuals;  // z - f(x, y) at the data points
+    double _chiSq;
+    Eigen::VectorXd _errors;    // computed on first use
 
-    std::vector<std::shared_ptr<FittingFunc> > _funcArray;
+    detail::FunctionBasis<FittingFunc> _basis;
+    std::vector<std::pair<int, int> > _exponents;  // x and y exponents of each term
 };
 
 // The .cc part
@@ -105,17 +123,27 @@ private:
 ///\param z Value of data for a given x,y. \f$z = z_i = z_i(x_i, y_i)\f$
 ///\param s Vector of measured uncertainties in the values of z
 ///\param order Order of 2d function to fit
+///\param solver Factorization of the design matrix to use
 template <class FittingFunc>
 LeastSqFitter2d<FittingFunc>::LeastSqFitter2d(const std::vector<double> &x, const std::vector<double> &y,
                                               const std::vector<double> &z, const std::vector<double> &s,
-                                              int order)
-        : _x(x), _y(y), _z(z), _s(s), _order(order), _nPar(0), _par(1) {
+                                              int order, LeastSqSolver solver)
+        : _x(x), _y(y), _z(z), _s(s), _order(order), _nPar(0), _par(1), _basis(std::max(order, 0)) {
     //_nPar, the number of terms to fix (x^2, xy, y^2 etc.) is \Sigma^(order+1) 1
     _nPar = 0;
     for (int i = 0; i < order; ++i) {
         _nPar += i + 1;
     }
 
+    // The ith term in the fitting polynomial is of the form x^a * y^b, in the order
+    // x^0 y^0, x^0 y^1, ..., x^0 y^(order-1), x^1 y^0, ..., x^(order-1) y^0 (see expandParams)
+    _exponents.reserve(_nPar);
+    for (int xexp = 0; xexp < order; ++xexp) {
+        for (int yexp = 0; yexp < order - xexp; ++yexp) {
+            _exponents.emplace_back(xexp, yexp);
+        }
+    }
+
     // Check input vectors are the same size
     _nData = _x.size();
     if (_nData != static_cast<int>(_y.size())) {
@@ -139,18 +167,19 @@ LeastSqFitter2d<FittingFunc>::LeastSqFitter2d(const std::vector<double> &x, cons
         throw LSST_EXCEPT(pex::exceptions::RuntimeError, "Fewer data points than parameters");
     }
 
-    initFunctions();
-
-    Eigen::MatrixXd design(_nData, _nPar);
-    Eigen::VectorXd rhs(_nData);
-    for (int i = 0; i < _nData; ++i) {
-        rhs[i] = z[i] / s[i];
-        for (int j = 0; j < _nPar; ++j) {
-            design(i, j) = func2d(_x[i], _y[i], j) / _s[i];
-        }
-    }
-    _svd.compute(design, Eigen::ComputeThinU | Eigen::ComputeThinV);
-    _par = _svd.solve(rhs);
+    Eigen::Map<Eigen::ArrayXd const> const zArr(_z.data(), _nData);
+    Eigen::Map<Eigen::ArrayXd const> const sArr(_s.data(), _nData);
+    Eigen::MatrixXd design = designMatrix(Eigen::Map<Eigen::ArrayXd const>(_x.data(), _nData),
+                                          Eigen::Map<Eigen::ArrayXd const>(_y.data(), _nData));
+    design.array().colwise() /= sArr;
+    Eigen::VectorXd const rhs = (zArr / sArr).matrix();
+    _factorization = detail::LeastSqFactorization(design, solver);
+    _par = _factorization.solve(rhs);
+
+    // The design matrix is weighted by 1/s, so this gives the weighted residuals
+    Eigen::ArrayXd const weightedResiduals = (rhs - design * _par).array();
+    _residuals = weightedResiduals * sArr;
+    _chiSq = weightedResiduals.square().sum();
 }
 
 /// Build up a triangular matrix of the parameters. The shape of the matrix is
@@ -167,6 +196,24 @@ Eigen::MatrixXd LeastSqFitter2d<FittingFunc>::getParams() {
     return expandParams(_par);
 }
 
+/// Return the best fit parameters for each column of z, a matrix with one row per data
+/// point, fit at the same x and y and with the same uncertainties s as the constructor's z.
+/// Element j of the result is the triangular parameter matrix (see getParams()) for column j.
+template <class FittingFunc>
+std::vector<Eigen::MatrixXd> LeastSqFitter2d<FittingFunc>::getParamsFor(Eigen::MatrixXd const &z) const {
+    if (z.rows() != _nData) {
+        throw LSST_EXCEPT(pex::exceptions::RuntimeError, "z matrix and x vector of different lengths");
+    }
+    Eigen::Map<Eigen::ArrayXd const> const sArr(_s.data(), _nData);
+    Eigen::MatrixXd const par = _factorization.solve((z.array().colwise() / sArr).matrix());
+    std::vector<Eigen::MatrixXd> out;
+    out.reserve(par.cols());
+    for (Eigen::Index j = 0; j < par.cols(); ++j) {
+        out.push_back(expandParams(par.col(j)));
+    }
+    return out;
+}
+
 /// Turn a flattened parameter-like vector into a triangular matrix.
 template <class FittingFunc>
 Eigen::MatrixXd LeastSqFitter2d<FittingFunc>::expandParams(Eigen::VectorXd const &input) const {
@@ -184,14 +231,7 @@ Eigen::MatrixXd LeastSqFitter2d<FittingFunc>::expandParams(Eigen::VectorXd const
 /// \f[ \chi^2 = \sum \left( \frac{z_i - f(x_i, y_i)}{s_i} \right)^2  \f]
 template <class FittingFunc>
 double LeastSqFitter2d<FittingFunc>::getChiSq() {
-    double chisq = 0;
-    for (int i = 0; i < _nData; ++i) {
-        double val = _z[i] - valueAt(_x[i], _y[i]);
-        val /= _s[i];
-        chisq += pow(val, 2);
-    }
-
-    return chisq;
+    return _chiSq;
 }
 
 /// \brief Return a measure of the goodness of fit.
@@ -207,85 +247,55 @@ double LeastSqFitter2d<FittingFunc>::getReducedChiSq() {
 /// Return the value of the best fit function at a given position (x,y)
 template <class FittingFunc>
 double LeastSqFitter2d<FittingFunc>::valueAt(double x, double y) {
-    double val = 0;
+    return valuesAt(Eigen::ArrayXd::Constant(1, x), Eigen::ArrayXd::Constant(1, y))[0];
+}
 
-    // Sum the values of the different orders to get the value of the fitted function
-    for (int i = 0; i < _nPar; ++i) {
-        val += _par[i] * func2d(x, y, i);
+/// Return the values of the best fit function at positions (x[i], y[i])
+template <class FittingFunc>
+ndarray::Array<double, 1, 1> LeastSqFitter2d<FittingFunc>::valueAt(
+        ndarray::Array<double const, 1, 0> const &x, ndarray::Array<double const, 1, 0> const &y) const {
+    if (x.getSize<0>() != y.getSize<0>()) {
+        throw LSST_EXCEPT(pex::exceptions::RuntimeError, "x and y arrays of different lengths");
     }
-    return val;
+    ndarray::Array<double, 1, 1> out = ndarray::allocate(x.getSize<0>());
+    ndarray::asEigenMatrix(out) = valuesAt(ndarray::asEigenArray(x), ndarray::asEigenArray(y));
+    return out;
 }
 
 /// Return a vector of residuals of the fit (i.e the difference between the input z values, and
 /// the value of the fitting function at that point.
 template <class FittingFunc>
 std::vector<double> LeastSqFitter2d<FittingFunc>::residuals() {
-    std::vector<double> out;
-    out.reserve(_nData);
-
-    for (int i = 0; i < _nData; ++i) {
-        out.push_back(_z[i] - valueAt(_x[i], _y[i]));
-    }
-
-    return out;
+    return std::vector<double>(_residuals.data(), _residuals.data() + _residuals.size());
 }
 
 /// Companion function to getParams(). Returns uncertainties in the parameters as a matrix
 template <class FittingFunc>
 Eigen::MatrixXd LeastSqFitter2d<FittingFunc>::getErrors() {
-    Eigen::ArrayXd variance(_nPar);
-    for (int i = 0; i < _nPar; ++i) {
-        variance[i] = _svd.matrixV().row(i).dot(
-                (_svd.singularValues().array().inverse().square() * _svd.matrixV().col(i).array()).matrix());
-    }
-    return expandParams(variance.sqrt().matrix());
-}
-
-template <class FittingFunc>
-void LeastSqFitter2d<FittingFunc>::initFunctions() {
-    // Initialise the array of functions. _funcArray[i] is a object of type math::Function1 of order i
-    _funcArray.reserve(_order);
-
-    std::vector<double> coeff;
-    coeff.reserve(_order);
-
-    coeff.push_back(1);
-    for (int i = 0; i < _order; ++i) {
-        std::shared_ptr<FittingFunc> p(new FittingFunc(coeff));
-        _funcArray.push_back(p);
-
-        coeff[i] = 0;
-        coeff.push_back(1);  // coeff now looks like [0,0,...,0,1]
+    if (_errors.size() == 0) {
+        _errors = _factorization.computeVariance().cwiseSqrt();
     }
+    return expandParams(_errors);
 }
 
-// The ith term in the fitting polynomial is of the form x^a * y^b. This function figures
-// out the value of a and b, then calculates the value of the ith term at the given x and y
+/// Return the matrix whose element (i, j) is the jth term of the fitting polynomial at (x[i], y[i])
 template <class FittingFunc>
-double LeastSqFitter2d<FittingFunc>::func2d(double x, double y, int term) {
-    int yexp = 0;  // y exponent
-    int xexp = 0;  // x exponent
-
-    for (int i = 0; i < term; ++i) {
-        yexp = (yexp + 1) % (_order - xexp);
-        if (yexp == 0) {
-            xexp++;
-        }
+Eigen::MatrixXd LeastSqFitter2d<FittingFunc>::designMatrix(Eigen::ArrayXd const &x,
+                                                           Eigen::ArrayXd const &y) const {
+    Eigen::ArrayXXd const xBasis = _basis.evaluate(x);
+    Eigen::ArrayXXd const yBasis = _basis.evaluate(y);
+    Eigen::MatrixXd out(x.size(), _nPar);
+    for (int j = 0; j < _nPar; ++j) {
+        out.col(j) = (xBasis.col(_exponents[j].first) * yBasis.col(_exponents[j].second)).matrix();
     }
-
-    double xcomp = func1d(x, xexp);  // x component of polynomial
-    double ycomp = func1d(y, yexp);  // y component
-
-#if 0  // A useful debugging printf statement
-        printf("The %i(th) function: x^%i * y^%i = %.1f * %.1f\n", term, xexp, yexp, xcomp, ycomp);
-#endif
-
-    return xcomp * ycomp;
+    return out;
 }
 
+/// Return the values of the best fit function at positions (x[i], y[i])
 template <class FittingFunc>
-double LeastSqFitter2d<FittingFunc>::func1d(double value, int exponent) {
-    return (*_funcArray[exponent])(value);
+Eigen::VectorXd LeastSqFitter2d<FittingFunc>::valuesAt(Eigen::ArrayXd const &x,
+                                                       Eigen::ArrayXd const &y) const {
+    return designMatrix(x, y) * _par;
 }
 
 }  // namespace sip
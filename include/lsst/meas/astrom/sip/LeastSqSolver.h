@@ -0,0 +1,53 @@
+// -*- LSST-C++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008, 2009, 2010 LSST Corporation.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <http://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#ifndef LEAST_SQ_SOLVER
+#define LEAST_SQ_SOLVER
+
+namespace lsst {
+namespace meas {
+namespace astrom {
+namespace sip {
+
+/**
+ \brief Algorithms for the linear least-squares fits in this package
+
+ Used by LeastSqFitter1d, LeastSqFitter2d and CreateWcsWithSip; each fit
+ factors its design matrix once and can then solve for several right-hand sides.
+ */
+enum class LeastSqSolver {
+    AUTO,         ///< Use NORMAL_LDLT if the normal equations are well-conditioned, otherwise COL_PIV_QR
+                  ///< (or SVD if the design matrix is rank-deficient)
+    COL_PIV_QR,   ///< Column-pivoting Householder QR decomposition of the design matrix
+    NORMAL_LDLT,  ///< LDLT decomposition of the normal equations; fastest, but squares the condition number
+    SVD           ///< Two-sided Jacobi SVD of the design matrix (Eigen::JacobiSVD); slowest, but the
+                  ///< most robust
+};
+
+}  // namespace sip
+}  // namespace astrom
+}  // namespace meas
+}  // namespace lsst
+
+#endif
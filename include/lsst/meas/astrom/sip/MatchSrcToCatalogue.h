@@ -27,6 +27,7 @@
 
 #include <iostream>
 #include <cmath>
+#include <vector>
 
 #include "lsst/base.h"
 #include "lsst/pex/exceptions/Runtime.h"
@@ -54,6 +55,11 @@ namespace sip {
 ///
 /// Using this class has the side effect of updating the coord field of the input SourceCatalog (which
 /// may be desirable).
+///
+/// The positions of the catalogue objects are indexed the first time matches are found, and the index
+/// is kept until setCatSrcSet() is called again, so call it if the catalogue positions change. Each image
+/// source also remembers the catalogue objects near its last queried position; after setWcs(), only
+/// sources that moved by more than half the match distance are looked up in the index again.
 class MatchSrcToCatalogue {
 public:
     typedef std::shared_ptr<MatchSrcToCatalogue> Ptr;
@@ -80,8 +86,29 @@ private:
     std::shared_ptr<afw::geom::SkyWcs const> _wcs;
     geom::Angle _dist;  ///< How close must two objects be to match
 
-    void _removeOneToMany();
-    void _removeManyToOne();
+    /// Position of a catalogue object in the index
+    struct RefPosition {
+        double dec;        ///< Declination in radians, the sort key of the index
+        double x, y, z;    ///< Unit vector
+        std::size_t index; ///< Index of the object in _catSet
+    };
+
+    /// Catalogue objects near the position of an image source when it was last looked up
+    struct SrcCandidates {
+        bool valid;                   ///< Have the candidates been found for the current index and _dist?
+        double x, y, z;               ///< Unit vector of the source position used for the lookup
+        std::vector<std::size_t> refs; ///< Positions in _refIndex of the candidates
+    };
+
+    std::vector<RefPosition> _refIndex;        ///< Catalogue positions, sorted by declination
+    bool _refIndexValid;                       ///< Is _refIndex up to date with _catSet?
+    std::vector<SrcCandidates> _srcCandidates; ///< Cached lookups, one per image source
+
+    void _buildRefIndex();
+    void _findCandidates(SrcCandidates& candidates, double dec, double x, double y, double z,
+                         double radius) const;
+    void _matchRaDec();
+    void _removeDuplicates();
 };
 
 }  // namespace sip
@@ -18,6 +18,7 @@ void wrapMatchSrcToCatalogue(WrapperCollection &wrappers);
 void wrapPolynomialTransform(WrapperCollection &wrappers);
 void wrapScaledPolynomialTransformFitter(WrapperCollection &wrappers);
 void wrapSipTransform(WrapperCollection &wrappers);
+void wrapTanSipEvaluator(WrapperCollection &wrappers);
 void wrapMatchOptimisticB(WrapperCollection &wrappers);
 void wrapMakeMatchStatistics(WrapperCollection &wrappers);
 void wrapPessimisticPatternMatcherUtils(WrapperCollection &wrappers);
@@ -35,6 +36,7 @@ PYBIND11_MODULE(_measAstromLib, mod) {
     wrapPolynomialTransform(wrappers);
     wrapScaledPolynomialTransformFitter(wrappers);
     wrapSipTransform(wrappers);
+    wrapTanSipEvaluator(wrappers);
     wrapMatchOptimisticB(wrappers);
     wrapMakeMatchStatistics(wrappers);
     wrapPessimisticPatternMatcherUtils(wrappers);
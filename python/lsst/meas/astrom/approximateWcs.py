@@ -22,22 +22,8 @@
 
 __all__ = ["approximateWcs"]
 
-import numpy as np
-
 import lsst.geom
-import lsst.afw.table as afwTable
-import lsst.afw.geom as afwGeom
-from lsst.meas.base import SingleFrameMeasurementTask
-from lsst.meas.astrom.sip import makeCreateWcsWithSip
-from lsst.afw.geom.utils import assertWcsAlmostEqualOverBBox
-
-
-class _MockTestCase:
-    """A fake unit test case class that will enable us to call
-    assertWcsAlmostEqualOverBBox from the method approximateWcs"""
-
-    def fail(self, msgStr):
-        raise UserWarning("WCS fitting failed " + msgStr)
+from lsst.meas.astrom.sip import approximateWcsWithSip
 
 
 def approximateWcs(wcs, bbox, order=3, nx=20, ny=20, iterations=3,
@@ -75,50 +61,29 @@ def approximateWcs(wcs, bbox, order=3, nx=20, ny=20, iterations=3,
     -------
     fitWcs : `lsst.afw.geom.SkyWcs`
         the fit TAN-SIP WCS
-    """
-    if useTanWcs:
-        crpix = wcs.getPixelOrigin()
-        crval = wcs.getSkyOrigin()
-        cdMatrix = wcs.getCdMatrix(crpix)
-        tanWcs = afwGeom.makeSkyWcs(crpix=crpix, crval=crval, cdMatrix=cdMatrix)
-    else:
-        tanWcs = wcs
-
-    # create a matchList consisting of a grid of points covering the bbox
-    refSchema = afwTable.SimpleTable.makeMinimalSchema()
-    refCoordKey = afwTable.CoordKey(refSchema["coord"])
-    refCat = afwTable.SimpleCatalog(refSchema)
-
-    sourceSchema = afwTable.SourceTable.makeMinimalSchema()
-    SingleFrameMeasurementTask(schema=sourceSchema)  # expand the schema
-    sourceCentroidKey = afwTable.Point2DKey(sourceSchema["slot_Centroid"])
-
-    sourceCat = afwTable.SourceCatalog(sourceSchema)
 
-    matchList = []
-
-    bboxd = lsst.geom.Box2D(bbox)
-    for x in np.linspace(bboxd.getMinX(), bboxd.getMaxX(), nx):
-        for y in np.linspace(bboxd.getMinY(), bboxd.getMaxY(), ny):
-            pixelPos = lsst.geom.Point2D(x, y)
-            skyCoord = wcs.pixelToSky(pixelPos)
-
-            refObj = refCat.addNew()
-            refObj.set(refCoordKey, skyCoord)
-
-            source = sourceCat.addNew()
-            source.set(sourceCentroidKey, pixelPos)
-
-            matchList.append(afwTable.ReferenceMatch(refObj, source, 0.0))
-
-    # The TAN-SIP fitter is fitting x and y separately, so we have to iterate to make it converge
-    for indx in range(iterations):
-        sipObject = makeCreateWcsWithSip(matchList, tanWcs, order, bbox)
-        tanWcs = sipObject.getNewWcs()
-    fitWcs = sipObject.getNewWcs()
-
-    mockTest = _MockTestCase()
-    assertWcsAlmostEqualOverBBox(mockTest, wcs, fitWcs, bbox, maxDiffSky=skyTolerance,
-                                 maxDiffPix=pixelTolerance)
-
-    return fitWcs
+    Raises
+    ------
+    UserWarning
+        Raised if the fit WCS differs from the input WCS by more than
+        skyTolerance or pixelTolerance over a 5x5 grid covering bbox.
+
+    Notes
+    -----
+    The fit and the verification are done by
+    `lsst.meas.astrom.sip.approximateWcsWithSip`; call that directly to get
+    the achieved errors instead of an exception.
+    """
+    result = approximateWcsWithSip(wcs, bbox, order=order, nx=nx, ny=ny, iterations=iterations,
+                                   useTanWcs=useTanWcs)
+    # The comparisons are written so that NaN differences fail
+    errors = []
+    if not result.maxSkyDiff <= skyTolerance:
+        errors.append("maxDiffSky = %0.4g arcsec > %0.4g" %
+                      (result.maxSkyDiff.asArcseconds(), skyTolerance.asArcseconds()))
+    if not result.maxPixelDiff <= pixelTolerance:
+        errors.append("maxDiffPix = %0.4g pix > %0.4g" % (result.maxPixelDiff, pixelTolerance))
+    if errors:
+        raise UserWarning("WCS fitting failed " + "; ".join(errors))
+
+    return result.wcs
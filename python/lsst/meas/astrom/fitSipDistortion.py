@@ -99,6 +99,13 @@ class FitSipDistortionConfig(lsst.pex.config.Config):
         dtype=float,
         default=50.0,
     )
+    useChebyshev = lsst.pex.config.Field(
+        doc="Fit the distortion in a basis of Chebyshev polynomials, converting "
+            "to SIP monomials only at the end.  This is better conditioned than "
+            "fitting monomials directly, especially for high polynomial orders.",
+        dtype=bool,
+        default=False,
+    )
 
 
 class FitSipDistortionTask(lsst.pipe.base.Task):
@@ -184,7 +191,8 @@ class FitSipDistortionTask(lsst.pipe.base.Task):
         # right now for purely bookeeeping reasons, and it may be the case we
         # have in the future when we us Gaia as the reference catalog.
         revFitter = ScaledPolynomialTransformFitter.fromMatches(self.config.order, matches, wcs,
-                                                                self.config.refUncertainty)
+                                                                self.config.refUncertainty,
+                                                                chebyshev=self.config.useChebyshev)
         revFitter.fit()
         for nIter in range(self.config.numRejIter):
             revFitter.updateModel()
@@ -203,7 +211,11 @@ class FitSipDistortionTask(lsst.pipe.base.Task):
         # Convert the generic ScaledPolynomialTransform result to SIP form
         # with given CRPIX and CD (this is an exact conversion, up to
         # floating-point round-off error)
-        sipReverse = SipReverseTransform.convert(revScaledPoly, wcs.getPixelOrigin(), cdMatrix)
+        if self.config.useChebyshev:
+            sipReverse = SipReverseTransform.convert(revFitter.getChebyshevTransform(),
+                                                     wcs.getPixelOrigin(), cdMatrix)
+        else:
+            sipReverse = SipReverseTransform.convert(revScaledPoly, wcs.getPixelOrigin(), cdMatrix)
 
         # Fit the forward mapping to a grid of points created from the reverse
         # transform.  Because that grid needs to be defined in intermediate
@@ -222,11 +234,16 @@ class FitSipDistortionTask(lsst.pipe.base.Task):
             gridBBoxIwc.include(cdMatrix(point))
         fwdFitter = ScaledPolynomialTransformFitter.fromGrid(self.config.order, gridBBoxIwc,
                                                              self.config.nGridX, self.config.nGridY,
-                                                             revScaledPoly)
+                                                             revScaledPoly,
+                                                             chebyshev=self.config.useChebyshev)
         fwdFitter.fit()
         # Convert to SIP forward form.
-        fwdScaledPoly = fwdFitter.getTransform()
-        sipForward = SipForwardTransform.convert(fwdScaledPoly, wcs.getPixelOrigin(), cdMatrix)
+        if self.config.useChebyshev:
+            sipForward = SipForwardTransform.convert(fwdFitter.getChebyshevTransform(),
+                                                     wcs.getPixelOrigin(), cdMatrix)
+        else:
+            fwdScaledPoly = fwdFitter.getTransform()
+            sipForward = SipForwardTransform.convert(fwdScaledPoly, wcs.getPixelOrigin(), cdMatrix)
 
         # Make a new WCS from the SIP transform objects and the CRVAL in the
         # initial WCS.
@@ -30,10 +30,11 @@ import lsst.afw.geom as afwGeom
 import lsst.afw.table as afwTable
 import lsst.pex.config as pexConfig
 import lsst.pipe.base as pipeBase
+import lsst.pex.exceptions
 from lsst.utils.timer import timeMethod
 from . import exceptions
 from .setMatchDistance import setMatchDistance
-from .sip import makeCreateWcsWithSip
+from .sip import makeCreateWcsWithSip, fitTanSipWcsWithRejection
 
 
 class FitTanSipWcsConfig(pexConfig.Config):
@@ -130,26 +131,29 @@ class FitTanSipWcsTask(pipeBase.Task):
         debug = lsstDebug.Info(__name__)
 
         wcs = self.initialWcs(matches, initWcs)
-        rejected = np.zeros(len(matches), dtype=bool)
-        for rej in range(self.config.numRejIter):
-            sipObject = self._fitWcs([mm for i, mm in enumerate(matches) if not rejected[i]], wcs)
-            wcs = sipObject.getNewWcs()
-            rejected = self.rejectMatches(matches, wcs, rejected)
-            if rejected.sum() == len(rejected):
-                raise exceptions.AstrometryFitFailure(f"All matches rejected in fitter iteration {rej+1}")
-            self.log.debug(
-                "Iteration %d of astrometry fitting: rejected %d outliers, out of %d total matches.",
-                rej, rejected.sum(), len(rejected)
-            )
-            if debug.plot:
-                print("Plotting fit after rejection iteration %d/%d" % (rej + 1, self.config.numRejIter))
-                self.plotFit(matches, wcs, rejected)
-        # Final fit after rejection
-        sipObject = self._fitWcs([mm for i, mm in enumerate(matches) if not rejected[i]], wcs)
-        wcs = sipObject.getNewWcs()
-        if debug.plot:
-            print("Plotting final fit")
-            self.plotFit(matches, wcs, rejected)
+        if debug.plot or self._overridesRejection():
+            # The per-iteration WCSs and rejections are only available (to
+            # plot, or to pass to an overridden rejectMatches or _fitWcs)
+            # when iterating in Python.
+            wcs, scatterOnSky = self._fitWithRejectionInPython(matches, wcs, debug)
+        else:
+            try:
+                fitResult = fitTanSipWcsWithRejection(
+                    matches, wcs,
+                    order=self.config.order,
+                    numIter=self.config.numIter,
+                    numRejIter=self.config.numRejIter,
+                    rejSigma=self.config.rejSigma,
+                )
+            except lsst.pex.exceptions.RuntimeError as e:
+                raise exceptions.AstrometryFitFailure(str(e)) from e
+            wcs = fitResult.wcs
+            scatterOnSky = fitResult.scatterOnSky[-1]
+            for rej, nRejected in enumerate(fitResult.nRejected):
+                self.log.debug(
+                    "Iteration %d of astrometry fitting: rejected %d outliers, out of %d total matches.",
+                    rej, nRejected, len(matches)
+                )
 
         if refCat is not None:
             self.log.debug("Updating centroids in refCat")
@@ -168,8 +172,6 @@ class FitTanSipWcsTask(pipeBase.Task):
         self.log.debug("Updating distance in match list")
         setMatchDistance(matches)
 
-        scatterOnSky = sipObject.getScatterOnSky()
-
         if scatterOnSky.asArcseconds() > self.config.maxScatterArcsec:
             raise exceptions.AstrometryFitFailure(
                 "Fit failed: median scatter on sky = %0.3f arcsec > %0.3f config.maxScatterArcsec" %
@@ -260,6 +262,59 @@ class FitTanSipWcsTask(pipeBase.Task):
         good = np.logical_not(rejected)
         return (dx > self.config.rejSigma*dx[good].std()) | (dy > self.config.rejSigma*dy[good].std())
 
+    def _overridesRejection(self):
+        """Return whether a subclass overrides rejectMatches or _fitWcs, which
+        fitTanSipWcsWithRejection cannot call
+        """
+        cls = type(self)
+        return (cls.rejectMatches is not FitTanSipWcsTask.rejectMatches
+                or cls._fitWcs is not FitTanSipWcsTask._fitWcs)
+
+    def _fitWithRejectionInPython(self, matches, wcs, debug):
+        """Fit and reject outliers with _fitWcs and rejectMatches
+
+        This is equivalent to fitTanSipWcsWithRejection, but slower; it is
+        used when those methods are overridden or lsstDebug plotting is
+        enabled.
+
+        Parameters
+        ----------
+        matches : `list` of `lsst.afw.table.ReferenceMatch`
+            List of sources matched to references.
+        wcs : `lsst.afw.geom.SkyWcs`
+            Initial WCS.
+        debug : `lsstDebug.Info`
+            Debugging configuration for this module.
+
+        Returns
+        -------
+        wcs : `lsst.afw.geom.SkyWcs`
+            Fitted WCS.
+        scatterOnSky : `lsst.geom.Angle`
+            Median on-sky separation of the unrejected matches for the final fit.
+        """
+        rejected = np.zeros(len(matches), dtype=bool)
+        for rej in range(self.config.numRejIter):
+            sipObject = self._fitWcs([mm for i, mm in enumerate(matches) if not rejected[i]], wcs)
+            wcs = sipObject.getNewWcs()
+            rejected = self.rejectMatches(matches, wcs, rejected)
+            if rejected.sum() == len(rejected):
+                raise exceptions.AstrometryFitFailure(f"All matches rejected in fitter iteration {rej+1}")
+            self.log.debug(
+                "Iteration %d of astrometry fitting: rejected %d outliers, out of %d total matches.",
+                rej, rejected.sum(), len(rejected)
+            )
+            if debug.plot:
+                print("Plotting fit after rejection iteration %d/%d" % (rej + 1, self.config.numRejIter))
+                self.plotFit(matches, wcs, rejected)
+        # Final fit after rejection
+        sipObject = self._fitWcs([mm for i, mm in enumerate(matches) if not rejected[i]], wcs)
+        wcs = sipObject.getNewWcs()
+        if debug.plot:
+            print("Plotting final fit")
+            self.plotFit(matches, wcs, rejected)
+        return wcs, sipObject.getScatterOnSky()
+
     def plotFit(self, matches, wcs, rejected):
         """Plot the fit
 
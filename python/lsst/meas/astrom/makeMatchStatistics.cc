@@ -41,6 +41,9 @@ void declareMakeMatchStatistics(py::module& mod) {
             "flags"_a, "sctrl"_a = afw::math::StatisticsControl());
     mod.def("makeMatchStatisticsInRadians", &makeMatchStatisticsInRadians<MatchT>, "wcs"_a, "matchList"_a,
             "flags"_a, "sctrl"_a = afw::math::StatisticsControl());
+    mod.def("makeMatchSeparationStatistics", &makeMatchSeparationStatistics<MatchT>, "wcs"_a,
+            "matchList"_a, "quantiles"_a = std::vector<double>(),
+            "sctrl"_a = afw::math::StatisticsControl());
 }
 
 }  // namespace
@@ -48,6 +51,19 @@ void declareMakeMatchStatistics(py::module& mod) {
 void wrapMakeMatchStatistics(lsst::cpputils::python::WrapperCollection &wrappers){
     auto &mod = wrappers.module;
 
+    wrappers.wrapType(py::class_<SeparationStatistics>(mod, "SeparationStatistics"),
+                      [](auto &mod, auto &cls) {
+                          cls.def_readonly("median", &SeparationStatistics::median);
+                          cls.def_readonly("meanClip", &SeparationStatistics::meanClip);
+                          cls.def_readonly("stdevClip", &SeparationStatistics::stdevClip);
+                          cls.def_readonly("quantiles", &SeparationStatistics::quantiles);
+                      });
+    wrappers.wrapType(py::class_<MatchSeparationStatistics>(mod, "MatchSeparationStatistics"),
+                      [](auto &mod, auto &cls) {
+                          cls.def_readonly("pixels", &MatchSeparationStatistics::pixels);
+                          cls.def_readonly("radians", &MatchSeparationStatistics::radians);
+                      });
+
     declareMakeMatchStatistics<afw::table::ReferenceMatch>(mod);
     declareMakeMatchStatistics<afw::table::SourceMatch>(mod);
 }
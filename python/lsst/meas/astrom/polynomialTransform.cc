@@ -22,6 +22,7 @@
 #include "pybind11/pybind11.h"
 #include "lsst/cpputils/python.h"
 #include "pybind11/stl.h"
+#include "pybind11/eigen.h"
 
 #include <memory>
 
@@ -30,6 +31,8 @@
 #include "lsst/geom/AffineTransform.h"
 #include "lsst/meas/astrom/SipTransform.h"
 #include "lsst/meas/astrom/PolynomialTransform.h"
+#include "lsst/meas/astrom/ScaledChebyshevTransform.h"
+#include "transformWrappers.h"
 
 namespace py = pybind11;
 using namespace pybind11::literals;
@@ -48,6 +51,7 @@ void declarePolynomialTransform(lsst::cpputils::python::WrapperCollection &wrapp
                         ndarray::Array<double const, 2, 0> const &>(),
                 "xCoeffs"_a, "yCoeffs"_a);
         cls.def(py::init<PolynomialTransform const &>(), "other"_a);
+        python::declarePickle<PolynomialTransform>(cls);
 
         cls.def_static("convert",
                        (PolynomialTransform(*)(ScaledPolynomialTransform const &)) &PolynomialTransform::convert,
@@ -64,7 +68,12 @@ void declarePolynomialTransform(lsst::cpputils::python::WrapperCollection &wrapp
         cls.def("getOrder", &PolynomialTransform::getOrder);
         cls.def("getXCoeffs", &PolynomialTransform::getXCoeffs);
         cls.def("getYCoeffs", &PolynomialTransform::getYCoeffs);
-        cls.def("linearize", &PolynomialTransform::linearize);
+        cls.def("linearize",
+                (geom::AffineTransform(PolynomialTransform::*)(geom::Point2D const &) const) &
+                        PolynomialTransform::linearize,
+                "in"_a);
+        cls.def("linearize", &python::linearizeArrays<PolynomialTransform>, "x"_a, "y"_a);
+        cls.def("apply", &python::applyArrays<PolynomialTransform>, "x"_a, "y"_a);
     });
 }
 
@@ -76,6 +85,7 @@ void declareScaledPolynomialTransform(lsst::cpputils::python::WrapperCollection
                         geom::AffineTransform const &>(),
                 "poly"_a, "inputScaling"_a, "outputScalingInverse"_a);
         cls.def(py::init<ScaledPolynomialTransform const &>(), "other"_a);
+        python::declarePickle<ScaledPolynomialTransform>(cls);
 
         cls.def_static(
                 "convert",
@@ -89,6 +99,10 @@ void declareScaledPolynomialTransform(lsst::cpputils::python::WrapperCollection
                 "convert",
                 (ScaledPolynomialTransform(*)(SipReverseTransform const &)) &ScaledPolynomialTransform::convert,
                 "other"_a);
+        cls.def_static("convert",
+                       (ScaledPolynomialTransform(*)(ScaledChebyshevTransform const &)) &
+                               ScaledPolynomialTransform::convert,
+                       "other"_a);
 
         cls.def("__call__", &ScaledPolynomialTransform::operator(), "in"_a);
 
@@ -97,7 +111,34 @@ void declareScaledPolynomialTransform(lsst::cpputils::python::WrapperCollection
                 py::return_value_policy::reference_internal);
         cls.def("getOutputScalingInverse", &ScaledPolynomialTransform::getOutputScalingInverse,
                 py::return_value_policy::reference_internal);
-        cls.def("linearize", &ScaledPolynomialTransform::linearize);
+        cls.def("linearize",
+                (geom::AffineTransform(ScaledPolynomialTransform::*)(geom::Point2D const &) const) &
+                        ScaledPolynomialTransform::linearize,
+                "in"_a);
+        cls.def("linearize", &python::linearizeArrays<ScaledPolynomialTransform>, "x"_a, "y"_a);
+        cls.def("apply", &python::applyArrays<ScaledPolynomialTransform>, "x"_a, "y"_a);
+    });
+}
+
+void declareScaledChebyshevTransform(lsst::cpputils::python::WrapperCollection &wrappers) {
+    using PyClass = py::class_<ScaledChebyshevTransform, std::shared_ptr<ScaledChebyshevTransform>>;
+
+    wrappers.wrapType(PyClass(wrappers.module, "ScaledChebyshevTransform"), [](auto &mod, auto &cls) {
+        cls.def(py::init<ndarray::Array<double const, 2, 0> const &, ndarray::Array<double const, 2, 0> const &,
+                        geom::AffineTransform const &, geom::AffineTransform const &>(),
+                "xCoeffs"_a, "yCoeffs"_a, "inputScaling"_a, "outputScalingInverse"_a);
+        cls.def(py::init<ScaledChebyshevTransform const &>(), "other"_a);
+
+        cls.def("__call__", &ScaledChebyshevTransform::operator(), "in"_a);
+
+        cls.def("getOrder", &ScaledChebyshevTransform::getOrder);
+        cls.def("getXCoeffs", &ScaledChebyshevTransform::getXCoeffs, py::return_value_policy::copy);
+        cls.def("getYCoeffs", &ScaledChebyshevTransform::getYCoeffs, py::return_value_policy::copy);
+        cls.def("getInputScaling", &ScaledChebyshevTransform::getInputScaling,
+                py::return_value_policy::reference_internal);
+        cls.def("getOutputScalingInverse", &ScaledChebyshevTransform::getOutputScalingInverse,
+                py::return_value_policy::reference_internal);
+        cls.def("linearize", &ScaledChebyshevTransform::linearize, "in"_a);
     });
 }
 
@@ -106,6 +147,7 @@ void declareScaledPolynomialTransform(lsst::cpputils::python::WrapperCollection
 void wrapPolynomialTransform(lsst::cpputils::python::WrapperCollection &wrappers){
     declarePolynomialTransform(wrappers);
     declareScaledPolynomialTransform(wrappers);
+    declareScaledChebyshevTransform(wrappers);
 
     wrappers.module.def("compose",
             (PolynomialTransform(*)(geom::AffineTransform const &, PolynomialTransform const &)) & compose,
@@ -113,6 +155,14 @@ void wrapPolynomialTransform(lsst::cpputils::python::WrapperCollection &wrappers
     wrappers.module.def("compose",
             (PolynomialTransform(*)(PolynomialTransform const &, geom::AffineTransform const &)) & compose,
             "t1"_a, "t2"_a);
+    wrappers.module.def("compose",
+            (ScaledPolynomialTransform(*)(geom::AffineTransform const &, ScaledPolynomialTransform const &)) &
+                    compose,
+            "t1"_a, "t2"_a);
+    wrappers.module.def("compose",
+            (ScaledPolynomialTransform(*)(ScaledPolynomialTransform const &, geom::AffineTransform const &)) &
+                    compose,
+            "t1"_a, "t2"_a);
 }
 
 }  // namespace astrom
@@ -52,8 +52,10 @@ void declareScaledPolynomialTransformFitter(lsst::cpputils::python::WrapperColle
     using PyClass = py::class_<ScaledPolynomialTransformFitter>;
 
     wrappers.wrapType(PyClass(wrappers.module, "ScaledPolynomialTransformFitter"), [](auto &mod, auto &cls) {
-        cls.def_static("fromMatches", &ScaledPolynomialTransformFitter::fromMatches);
-        cls.def_static("fromGrid", &ScaledPolynomialTransformFitter::fromGrid);
+        cls.def_static("fromMatches", &ScaledPolynomialTransformFitter::fromMatches, "maxOrder"_a,
+                       "matches"_a, "initialWcs"_a, "intrinsicScatter"_a, "chebyshev"_a = false);
+        cls.def_static("fromGrid", &ScaledPolynomialTransformFitter::fromGrid, "maxOrder"_a, "bbox"_a,
+                       "nGridX"_a, "nGridY"_a, "toInvert"_a, "chebyshev"_a = false);
         cls.def("fit", &ScaledPolynomialTransformFitter::fit, "order"_a = -1);
         cls.def("updateModel", &ScaledPolynomialTransformFitter::updateModel);
         cls.def("updateIntrinsicScatter", &ScaledPolynomialTransformFitter::updateIntrinsicScatter);
@@ -67,6 +69,9 @@ void declareScaledPolynomialTransformFitter(lsst::cpputils::python::WrapperColle
                 py::return_value_policy::copy);
         cls.def("getOutputScaling", &ScaledPolynomialTransformFitter::getOutputScaling,
                 py::return_value_policy::copy);
+        cls.def("isChebyshev", &ScaledPolynomialTransformFitter::isChebyshev);
+        cls.def("getChebyshevTransform", &ScaledPolynomialTransformFitter::getChebyshevTransform,
+                py::return_value_policy::copy);
     });
 }
 
@@ -24,6 +24,8 @@ import lsst.afw.geom  # for Box2I
 
 from .._measAstromLib import (CreateWcsWithSipReferenceMatch,
                               CreateWcsWithSipSourceMatch, LeastSqFitter1dPoly,
-                              LeastSqFitter2dPoly, MatchSrcToCatalogue, makeCreateWcsWithSip)
+                              LeastSqFitter2dPoly, LeastSqSolver, MatchSrcToCatalogue,
+                              FitTanSipWcsResult, makeCreateWcsWithSip, fitTanSipWcsWithRejection,
+                              ApproximateWcsResult, approximateWcsWithSip)
 from .genDistortedImage import *
 from .sourceMatchStatistics import *
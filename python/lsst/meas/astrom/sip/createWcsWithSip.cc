@@ -49,8 +49,16 @@ void declareCreateWcsWithSip(lsst::cpputils::python::WrapperCollection &wrappers
 
     wrappers.wrapType(PyCreateWcsWithSip(wrappers.module, name.c_str()), [](auto &mod, auto &cls) {
         cls.def(py::init<std::vector<MatchT> const &, afw::geom::SkyWcs const &, int const, geom::Box2I const &,
-                        int const>(),
-                "matches"_a, "linearWcs"_a, "order"_a, "bbox"_a = geom::Box2I(), "ngrid"_a = 0);
+                        int const, LeastSqSolver const, double const>(),
+                "matches"_a, "linearWcs"_a, "order"_a, "bbox"_a = geom::Box2I(), "ngrid"_a = 0,
+                "solver"_a = LeastSqSolver::AUTO, "reverseTolerance"_a = 0.0);
+        cls.def(py::init<ndarray::Array<double const, 1, 0> const &, ndarray::Array<double const, 1, 0> const &,
+                         ndarray::Array<double const, 1, 0> const &, ndarray::Array<double const, 1, 0> const &,
+                         afw::geom::SkyWcs const &, int const, geom::Box2I const &, int const,
+                         LeastSqSolver const, double const, ndarray::Array<double const, 1, 0> const &>(),
+                "ra"_a, "dec"_a, "x"_a, "y"_a, "linearWcs"_a, "order"_a, "bbox"_a = geom::Box2I(),
+                "ngrid"_a = 0, "solver"_a = LeastSqSolver::AUTO, "reverseTolerance"_a = 0.0,
+                "errors"_a = ndarray::Array<double const, 1, 0>());
 
         cls.def("getNewWcs", &CreateWcsWithSip<MatchT>::getNewWcs);
         cls.def("getScatterInPixels", &CreateWcsWithSip<MatchT>::getScatterInPixels);
@@ -60,21 +68,78 @@ void declareCreateWcsWithSip(lsst::cpputils::python::WrapperCollection &wrappers
         cls.def("getOrder", &CreateWcsWithSip<MatchT>::getOrder);
         cls.def("getNPoints", &CreateWcsWithSip<MatchT>::getNPoints);
         cls.def("getNGrid", &CreateWcsWithSip<MatchT>::getNGrid);
+        cls.def("getSolver", &CreateWcsWithSip<MatchT>::getSolver);
+        cls.def("getReverseTolerance", &CreateWcsWithSip<MatchT>::getReverseTolerance);
+        cls.def("getNReverseSamples", &CreateWcsWithSip<MatchT>::getNReverseSamples);
         cls.def("getSipA", &CreateWcsWithSip<MatchT>::getSipA, py::return_value_policy::copy);
         cls.def("getSipB", &CreateWcsWithSip<MatchT>::getSipB, py::return_value_policy::copy);
         cls.def("getSipAp", &CreateWcsWithSip<MatchT>::getSipAp, py::return_value_policy::copy);
         cls.def("getSipBp", &CreateWcsWithSip<MatchT>::getSipBp, py::return_value_policy::copy);
 
         mod.def("makeCreateWcsWithSip", &makeCreateWcsWithSip<MatchT>, "matches"_a, "linearWcs"_a, "order"_a,
-                "bbox"_a = geom::Box2I(), "ngrid"_a = 0);
+                "bbox"_a = geom::Box2I(), "ngrid"_a = 0, "solver"_a = LeastSqSolver::AUTO,
+                "reverseTolerance"_a = 0.0);
+        mod.def("fitTanSipWcsWithRejection", &fitTanSipWcsWithRejection<MatchT>, "matches"_a, "initWcs"_a,
+                "order"_a, "numIter"_a, "numRejIter"_a, "rejSigma"_a, "bbox"_a = geom::Box2I(),
+                "solver"_a = LeastSqSolver::AUTO);
     });
 }
 
+void declareFitTanSipWcsResult(lsst::cpputils::python::WrapperCollection &wrappers) {
+    using PyFitTanSipWcsResult = py::class_<FitTanSipWcsResult, std::shared_ptr<FitTanSipWcsResult>>;
+
+    wrappers.wrapType(PyFitTanSipWcsResult(wrappers.module, "FitTanSipWcsResult"), [](auto &mod, auto &cls) {
+        cls.def_readonly("wcs", &FitTanSipWcsResult::wcs);
+        cls.def_readonly("rejected", &FitTanSipWcsResult::rejected);
+        cls.def_readonly("scatterOnSky", &FitTanSipWcsResult::scatterOnSky);
+        cls.def_readonly("nRejected", &FitTanSipWcsResult::nRejected);
+    });
+}
+
+void declareArrayFunctions(lsst::cpputils::python::WrapperCollection &wrappers) {
+    using Array = ndarray::Array<double const, 1, 0>;
+    wrappers.wrap([](auto &mod) {
+        mod.def("makeCreateWcsWithSip",
+                py::overload_cast<Array const &, Array const &, Array const &, Array const &,
+                                  afw::geom::SkyWcs const &, int const, geom::Box2I const &, int const,
+                                  LeastSqSolver const, double const, Array const &>(&makeCreateWcsWithSip),
+                "ra"_a, "dec"_a, "x"_a, "y"_a, "linearWcs"_a, "order"_a, "bbox"_a = geom::Box2I(),
+                "ngrid"_a = 0, "solver"_a = LeastSqSolver::AUTO, "reverseTolerance"_a = 0.0,
+                "errors"_a = Array());
+        mod.def("fitTanSipWcsWithRejection",
+                py::overload_cast<Array const &, Array const &, Array const &, Array const &,
+                                  afw::geom::SkyWcs const &, int const, int const, int const, double const,
+                                  geom::Box2I const &, LeastSqSolver const, Array const &>(
+                        &fitTanSipWcsWithRejection),
+                "ra"_a, "dec"_a, "x"_a, "y"_a, "initWcs"_a, "order"_a, "numIter"_a, "numRejIter"_a,
+                "rejSigma"_a, "bbox"_a = geom::Box2I(), "solver"_a = LeastSqSolver::AUTO,
+                "errors"_a = Array());
+    });
+}
+
+void declareApproximateWcs(lsst::cpputils::python::WrapperCollection &wrappers) {
+    using PyApproximateWcsResult = py::class_<ApproximateWcsResult, std::shared_ptr<ApproximateWcsResult>>;
+
+    wrappers.wrapType(PyApproximateWcsResult(wrappers.module, "ApproximateWcsResult"),
+                      [](auto &mod, auto &cls) {
+                          cls.def_readonly("wcs", &ApproximateWcsResult::wcs);
+                          cls.def_readonly("maxSkyDiff", &ApproximateWcsResult::maxSkyDiff);
+                          cls.def_readonly("maxPixelDiff", &ApproximateWcsResult::maxPixelDiff);
+
+                          mod.def("approximateWcsWithSip", &approximateWcsWithSip, "wcs"_a, "bbox"_a,
+                                  "order"_a = 3, "nx"_a = 20, "ny"_a = 20, "iterations"_a = 3,
+                                  "useTanWcs"_a = false, "nxVerify"_a = 5, "nyVerify"_a = 5);
+                      });
+}
+
 }  // namespace
 
 void wrapCreateWcsWithSip(lsst::cpputils::python::WrapperCollection &wrappers){
+    declareFitTanSipWcsResult(wrappers);
     declareCreateWcsWithSip<afw::table::ReferenceMatch>(wrappers, "CreateWcsWithSipReferenceMatch");
     declareCreateWcsWithSip<afw::table::SourceMatch>(wrappers, "CreateWcsWithSipSourceMatch");
+    declareArrayFunctions(wrappers);
+    declareApproximateWcs(wrappers);
 }
 
 }  // namespace sip
@@ -45,22 +45,38 @@ void declareLeastSqFitter1d(lsst::cpputils::python::WrapperCollection &wrappers,
 
     wrappers.wrapType(PyLeastSqFitter1d(wrappers.module,name.c_str()), [](auto &mod, auto &cls) {
         cls.def(py::init<std::vector<double> const &, std::vector<double> const &, std::vector<double> const &,
-                        int>(),
-                "x"_a, "y"_a, "s"_a, "order"_a);
+                        int, LeastSqSolver>(),
+                "x"_a, "y"_a, "s"_a, "order"_a, "solver"_a = LeastSqSolver::SVD);
 
         cls.def("getParams", &LeastSqFitter1d<FittingFunc>::getParams);
+        cls.def("getParamsFor", &LeastSqFitter1d<FittingFunc>::getParamsFor, "y"_a);
         cls.def("getErrors", &LeastSqFitter1d<FittingFunc>::getErrors);
+        cls.def("getSolver", &LeastSqFitter1d<FittingFunc>::getSolver);
         cls.def("getBestFitFunction", &LeastSqFitter1d<FittingFunc>::getBestFitFunction);
-        cls.def("valueAt", &LeastSqFitter1d<FittingFunc>::valueAt, "x"_a);
+        cls.def("valueAt", py::overload_cast<double>(&LeastSqFitter1d<FittingFunc>::valueAt), "x"_a);
+        cls.def("valueAt",
+                py::overload_cast<ndarray::Array<double const, 1, 0> const &>(
+                        &LeastSqFitter1d<FittingFunc>::valueAt, py::const_),
+                "x"_a);
         cls.def("residuals", &LeastSqFitter1d<FittingFunc>::residuals);
         cls.def("getChiSq", &LeastSqFitter1d<FittingFunc>::getChiSq);
         cls.def("getReducedChiSq", &LeastSqFitter1d<FittingFunc>::getReducedChiSq);
     });
 }
 
+void declareLeastSqSolver(lsst::cpputils::python::WrapperCollection &wrappers) {
+    wrappers.wrapType(py::enum_<LeastSqSolver>(wrappers.module, "LeastSqSolver"), [](auto &mod, auto &enm) {
+        enm.value("AUTO", LeastSqSolver::AUTO);
+        enm.value("COL_PIV_QR", LeastSqSolver::COL_PIV_QR);
+        enm.value("NORMAL_LDLT", LeastSqSolver::NORMAL_LDLT);
+        enm.value("SVD", LeastSqSolver::SVD);
+    });
+}
+
 }  // namespace
 
 void wrapLeastSqFitter1d(lsst::cpputils::python::WrapperCollection &wrappers){
+    declareLeastSqSolver(wrappers);
     declareLeastSqFitter1d<afw::math::PolynomialFunction1<double>>(wrappers, "LeastSqFitter1dPoly");
 }
 
@@ -45,12 +45,20 @@ void declareLeastSqFitter2d(lsst::cpputils::python::WrapperCollection &wrappers,
 
     wrappers.wrapType(PyLeastSqFitter2d(wrappers.module, name.c_str()), [](auto &mod, auto &cls) {
         cls.def(py::init<std::vector<double> const &, std::vector<double> const &, std::vector<double> const &,
-                        std::vector<double> const &, int>(),
-                "x"_a, "y"_a, "z"_a, "s"_a, "order"_a);
+                        std::vector<double> const &, int, LeastSqSolver>(),
+                "x"_a, "y"_a, "z"_a, "s"_a, "order"_a, "solver"_a = LeastSqSolver::SVD);
 
         cls.def("getParams", &LeastSqFitter2d<FittingFunc>::getParams);
+        cls.def("getParamsFor", &LeastSqFitter2d<FittingFunc>::getParamsFor, "z"_a);
         cls.def("getErrors", &LeastSqFitter2d<FittingFunc>::getErrors);
-        cls.def("valueAt", &LeastSqFitter2d<FittingFunc>::valueAt, "x"_a, "y"_a);
+        cls.def("getSolver", &LeastSqFitter2d<FittingFunc>::getSolver);
+        cls.def("valueAt", py::overload_cast<double, double>(&LeastSqFitter2d<FittingFunc>::valueAt), "x"_a,
+                "y"_a);
+        cls.def("valueAt",
+                py::overload_cast<ndarray::Array<double const, 1, 0> const &,
+                                  ndarray::Array<double const, 1, 0> const &>(
+                        &LeastSqFitter2d<FittingFunc>::valueAt, py::const_),
+                "x"_a, "y"_a);
         cls.def("residuals", &LeastSqFitter2d<FittingFunc>::residuals);
         cls.def("getChiSq", &LeastSqFitter2d<FittingFunc>::getChiSq);
         cls.def("getReducedChiSq", &LeastSqFitter2d<FittingFunc>::getReducedChiSq);
@@ -23,10 +23,13 @@
 #include "lsst/cpputils/python.h"
 #include "pybind11/stl.h"
 
+#include "ndarray/pybind11.h"
+
 #include "lsst/geom/Point.h"
 #include "lsst/geom/LinearTransform.h"
 #include "lsst/afw/geom/SkyWcs.h"
 #include "lsst/meas/astrom/SipTransform.h"
+#include "transformWrappers.h"
 
 namespace py = pybind11;
 using namespace pybind11::literals;
@@ -54,6 +57,7 @@ void declareSipForwardTransform(lsst::cpputils::python::WrapperCollection &wrapp
         cls.def(py::init<geom::Point2D const &, geom::LinearTransform const &, PolynomialTransform const &>(),
                 "pixelOrigin"_a, "cdMatrix"_a, "forwardSipPoly"_a);
         cls.def(py::init<SipForwardTransform const &>(), "other"_a);
+        python::declarePickle<SipForwardTransform>(cls);
 
         cls.def_static("convert",
                        (SipForwardTransform(*)(PolynomialTransform const &, geom::Point2D const &,
@@ -68,11 +72,41 @@ void declareSipForwardTransform(lsst::cpputils::python::WrapperCollection &wrapp
         cls.def_static("convert",
                        (SipForwardTransform(*)(ScaledPolynomialTransform const &)) &SipForwardTransform::convert,
                        "scaled"_a);
+        cls.def_static("convert",
+                       (SipForwardTransform(*)(ScaledChebyshevTransform const &, geom::Point2D const &,
+                                               geom::LinearTransform const &)) &
+                               SipForwardTransform::convert,
+                       "chebyshev"_a, "pixelOrigin"_a, "cdMatrix"_a);
 
         cls.def("__call__", &SipForwardTransform::operator(), "in"_a);
         cls.def("transformPixels", &SipForwardTransform::transformPixels, "s"_a);
 
-        cls.def("linearize", &SipForwardTransform::linearize);
+        cls.def("linearize",
+                (geom::AffineTransform(SipForwardTransform::*)(geom::Point2D const &) const) &
+                        SipForwardTransform::linearize,
+                "in"_a);
+        cls.def("linearize", &python::linearizeArrays<SipForwardTransform>, "x"_a, "y"_a);
+        cls.def("apply", &python::applyArrays<SipForwardTransform>, "x"_a, "y"_a);
+
+        cls.def(
+                "applyInverse",
+                [](SipForwardTransform const &self, ndarray::Array<double const, 1, 0> const &x,
+                   ndarray::Array<double const, 1, 0> const &y, double tolerance, int maxIter) {
+                    ndarray::Array<double, 2, 2> out = ndarray::allocate(x.getSize<0>(), 2);
+                    self.applyInverse(x, y, out, tolerance, maxIter);
+                    return out;
+                },
+                "x"_a, "y"_a, "tolerance"_a = 1E-10, "maxIter"_a = 20);
+        cls.def(
+                "applyInverse",
+                [](SipForwardTransform const &self, ndarray::Array<double const, 1, 0> const &x,
+                   ndarray::Array<double const, 1, 0> const &y, SipReverseTransform const &seed,
+                   double tolerance, int maxIter) {
+                    ndarray::Array<double, 2, 2> out = ndarray::allocate(x.getSize<0>(), 2);
+                    self.applyInverse(x, y, out, seed, tolerance, maxIter);
+                    return out;
+                },
+                "x"_a, "y"_a, "seed"_a, "tolerance"_a = 1E-10, "maxIter"_a = 20);
     });
 }
 
@@ -84,6 +118,7 @@ void declareSipReverseTransform(lsst::cpputils::python::WrapperCollection &wrapp
         cls.def(py::init<geom::Point2D const &, geom::LinearTransform const &, PolynomialTransform const &>(),
                 "pixelOrigin"_a, "cdMatrix"_a, "reverseSipPoly"_a);
         cls.def(py::init<SipReverseTransform const &>(), "other"_a);
+        python::declarePickle<SipReverseTransform>(cls);
 
         cls.def_static("convert",
                        (SipReverseTransform(*)(PolynomialTransform const &, geom::Point2D const &,
@@ -98,11 +133,21 @@ void declareSipReverseTransform(lsst::cpputils::python::WrapperCollection &wrapp
         cls.def_static("convert",
                        (SipReverseTransform(*)(ScaledPolynomialTransform const &)) &SipReverseTransform::convert,
                        "scaled"_a);
+        cls.def_static("convert",
+                       (SipReverseTransform(*)(ScaledChebyshevTransform const &, geom::Point2D const &,
+                                               geom::LinearTransform const &)) &
+                               SipReverseTransform::convert,
+                       "chebyshev"_a, "pixelOrigin"_a, "cdMatrix"_a);
 
         cls.def("__call__", &SipReverseTransform::operator(), "in"_a);
         cls.def("transformPixels", &SipReverseTransform::transformPixels, "s"_a);
 
-        cls.def("linearize", &SipReverseTransform::linearize);
+        cls.def("linearize",
+                (geom::AffineTransform(SipReverseTransform::*)(geom::Point2D const &) const) &
+                        SipReverseTransform::linearize,
+                "in"_a);
+        cls.def("linearize", &python::linearizeArrays<SipReverseTransform>, "x"_a, "y"_a);
+        cls.def("apply", &python::applyArrays<SipReverseTransform>, "x"_a, "y"_a);
     });
 }
 
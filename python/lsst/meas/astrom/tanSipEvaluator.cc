@@ -0,0 +1,125 @@
+/*
+ * LSST Data Management System
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ * See the COPYRIGHT file
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+#include "pybind11/pybind11.h"
+#include "lsst/cpputils/python.h"
+#include "pybind11/stl.h"
+
+#include <memory>
+
+#include "ndarray/pybind11.h"
+
+#include "lsst/geom/Angle.h"
+#include "lsst/geom/Point.h"
+#include "lsst/geom/SpherePoint.h"
+#include "lsst/afw/geom/SkyWcs.h"
+#include "lsst/meas/astrom/TanSipEvaluator.h"
+
+namespace py = pybind11;
+using namespace pybind11::literals;
+
+namespace lsst {
+namespace meas {
+namespace astrom {
+namespace {
+
+void declareTanSipEvaluator(lsst::cpputils::python::WrapperCollection &wrappers) {
+    using PyTanSipEvaluator = py::class_<TanSipEvaluator, std::shared_ptr<TanSipEvaluator>>;
+
+    wrappers.wrapType(PyTanSipEvaluator(wrappers.module, "TanSipEvaluator"), [](auto &mod, auto &cls) {
+        cls.def(py::init<SipForwardTransform const &, SipReverseTransform const &,
+                         geom::SpherePoint const &, bool>(),
+                "sipForward"_a, "sipReverse"_a, "skyOrigin"_a, "exactInverse"_a = false);
+        cls.def(py::init<SipForwardTransform const &, geom::SpherePoint const &>(), "sipForward"_a,
+                "skyOrigin"_a);
+        cls.def(py::init<afw::geom::SkyWcs const &, bool>(), "wcs"_a, "exactInverse"_a = false);
+        cls.def(py::init<TanSipEvaluator const &>(), "other"_a);
+
+        cls.def("getSipForward", &TanSipEvaluator::getSipForward, py::return_value_policy::copy);
+        cls.def("getSipReverse", &TanSipEvaluator::getSipReverse, py::return_value_policy::copy);
+        cls.def("getSkyOrigin", &TanSipEvaluator::getSkyOrigin, py::return_value_policy::copy);
+        cls.def("isExactInverse", &TanSipEvaluator::isExactInverse);
+
+        cls.def("pixelToSky",
+                (geom::SpherePoint(TanSipEvaluator::*)(geom::Point2D const &) const) &
+                        TanSipEvaluator::pixelToSky,
+                "pixel"_a);
+        cls.def("pixelToSky",
+                (std::vector<geom::SpherePoint>(TanSipEvaluator::*)(std::vector<geom::Point2D> const &)
+                         const) &
+                        TanSipEvaluator::pixelToSky,
+                "pixels"_a);
+        cls.def("skyToPixel",
+                (geom::Point2D(TanSipEvaluator::*)(geom::SpherePoint const &) const) &
+                        TanSipEvaluator::skyToPixel,
+                "coord"_a);
+        cls.def("skyToPixel",
+                (std::vector<geom::Point2D>(TanSipEvaluator::*)(std::vector<geom::SpherePoint> const &)
+                         const) &
+                        TanSipEvaluator::skyToPixel,
+                "coords"_a);
+
+        // Array interfaces follow the conventions of SkyWcs.pixelToSkyArray
+        // and SkyWcs.skyToPixelArray.
+        cls.def(
+                "pixelToSkyArray",
+                [](TanSipEvaluator const &self, ndarray::Array<double const, 1, 0> const &x,
+                   ndarray::Array<double const, 1, 0> const &y, bool degrees) {
+                    ndarray::Array<double, 1, 1> ra = ndarray::allocate(x.getSize<0>());
+                    ndarray::Array<double, 1, 1> dec = ndarray::allocate(x.getSize<0>());
+                    self.pixelToSky(x, y, ra, dec);
+                    if (degrees) {
+                        ra.deep() *= geom::radToDeg(1.0);
+                        dec.deep() *= geom::radToDeg(1.0);
+                    }
+                    return py::make_tuple(ra, dec);
+                },
+                "x"_a, "y"_a, "degrees"_a = false);
+        cls.def(
+                "skyToPixelArray",
+                [](TanSipEvaluator const &self, ndarray::Array<double const, 1, 0> const &ra,
+                   ndarray::Array<double const, 1, 0> const &dec, bool degrees) {
+                    ndarray::Array<double, 1, 1> x = ndarray::allocate(ra.getSize<0>());
+                    ndarray::Array<double, 1, 1> y = ndarray::allocate(ra.getSize<0>());
+                    if (degrees) {
+                        ndarray::Array<double, 1, 1> raRad = ndarray::copy(ra);
+                        ndarray::Array<double, 1, 1> decRad = ndarray::copy(dec);
+                        raRad.deep() *= geom::degToRad(1.0);
+                        decRad.deep() *= geom::degToRad(1.0);
+                        self.skyToPixel(raRad, decRad, x, y);
+                    } else {
+                        self.skyToPixel(ra, dec, x, y);
+                    }
+                    return py::make_tuple(x, y);
+                },
+                "ra"_a, "dec"_a, "degrees"_a = false);
+    });
+}
+
+}  // namespace
+
+void wrapTanSipEvaluator(lsst::cpputils::python::WrapperCollection &wrappers) {
+    declareTanSipEvaluator(wrappers);
+}
+
+}  // namespace astrom
+}  // namespace meas
+}  // namespace lsst
@@ -0,0 +1,76 @@
+// -*- LSST-C++ -*-
+
+/*
+ * This file is part of meas_astrom.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef LSST_MEAS_ASTROM_PYTHON_transformWrappers_h_INCLUDED
+#define LSST_MEAS_ASTROM_PYTHON_transformWrappers_h_INCLUDED
+
+#include "pybind11/pybind11.h"
+
+#include "ndarray/pybind11.h"
+
+#include "lsst/meas/astrom/detail/binaryIo.h"
+
+namespace lsst {
+namespace meas {
+namespace astrom {
+namespace python {
+
+// Helpers shared by the pybind11 wrappers of the polynomial and SIP transforms.
+
+// Support pickling via the compact binary format of writeBinary/readBinary.
+template <typename Transform, typename PyClass>
+void declarePickle(PyClass &cls) {
+    cls.def(pybind11::pickle(
+            [](Transform const &self) { return pybind11::bytes(detail::writeBinaryToString(self)); },
+            [](pybind11::bytes const &state) { return detail::readBinaryFromString<Transform>(state); }));
+}
+
+// Wrap the batch linearize overload so it returns (values, jacobian) arrays
+// instead of filling output arguments.
+template <typename Transform>
+pybind11::tuple linearizeArrays(Transform const &self, ndarray::Array<double const, 1, 0> const &x,
+                                ndarray::Array<double const, 1, 0> const &y) {
+    ndarray::Array<double, 2, 2> out = ndarray::allocate(x.getSize<0>(), 2);
+    ndarray::Array<double, 3, 3> jacobian = ndarray::allocate(x.getSize<0>(), 2, 2);
+    self.linearize(x, y, out, jacobian);
+    return pybind11::make_tuple(out, jacobian);
+}
+
+// Wrap the batch apply method so it returns the transformed points as an
+// (N, 2) array instead of filling an output argument.
+template <typename Transform>
+ndarray::Array<double, 2, 2> applyArrays(Transform const &self, ndarray::Array<double const, 1, 0> const &x,
+                                         ndarray::Array<double const, 1, 0> const &y) {
+    ndarray::Array<double, 2, 2> out = ndarray::allocate(x.getSize<0>(), 2);
+    self.apply(x, y, out);
+    return out;
+}
+
+}  // namespace python
+}  // namespace astrom
+}  // namespace meas
+}  // namespace lsst
+
+#endif  // !LSST_MEAS_ASTROM_PYTHON_transformWrappers_h_INCLUDED
@@ -22,11 +22,17 @@
  * see <http://www.lsstcorp.org/LegalNotices/>.
  */
 
+#include <algorithm>
+#include <utility>
+
 #include "lsst/geom/Extent.h"
 #include "lsst/geom/Point.h"
 #include "lsst/geom/AffineTransform.h"
 #include "lsst/meas/astrom/PolynomialTransform.h"
 #include "lsst/meas/astrom/SipTransform.h"
+#include "lsst/meas/astrom/ScaledChebyshevTransform.h"
+#include "lsst/meas/astrom/detail/binaryIo.h"
+#include "lsst/meas/astrom/detail/composedPolynomial.h"
 #include "lsst/meas/astrom/detail/polynomialUtils.h"
 
 namespace lsst {
@@ -34,28 +40,26 @@ namespace meas {
 namespace astrom {
 
 PolynomialTransform PolynomialTransform::convert(ScaledPolynomialTransform const& scaled) {
-    return compose(scaled.getOutputScalingInverse(), compose(scaled.getPoly(), scaled.getInputScaling()));
+    return detail::ComposedPolynomial(scaled.getOutputScalingInverse(), scaled.getPoly(),
+                                      scaled.getInputScaling())
+            .materialize();
 }
 
 PolynomialTransform PolynomialTransform::convert(SipForwardTransform const& other) {
-    PolynomialTransform poly = other.getPoly();
-    // Adding 1 here accounts for the extra terms outside the sum in the SIP
-    // transform definition (see SipForwardTransform docs) - note that you can
-    // fold those terms into the sum by adding 1 from the A_10 and B_01 terms.
-    poly._xCoeffs(1, 0) += 1;
-    poly._yCoeffs(0, 1) += 1;
-    return compose(other.getCdMatrix(),
-                   compose(poly, geom::AffineTransform(geom::Point2D() - other.getPixelOrigin())));
+    // The identity term accounts for the extra terms outside the sum in the
+    // SIP transform definition (see SipForwardTransform docs) - note that you
+    // can fold those terms into the sum by adding 1 to the A_10 and B_01 terms.
+    return detail::ComposedPolynomial(geom::AffineTransform(other.getCdMatrix()), other.getPoly(),
+                                      geom::AffineTransform(geom::Point2D() - other.getPixelOrigin()), true)
+            .materialize();
 }
 
 PolynomialTransform PolynomialTransform::convert(SipReverseTransform const& other) {
-    PolynomialTransform poly = other.getPoly();
     // Account for the terms outside the sum in the SIP definition (see comment
     // earlier in the file for more explanation).
-    poly._xCoeffs(1, 0) += 1;
-    poly._yCoeffs(0, 1) += 1;
-    return compose(geom::AffineTransform(geom::Extent2D(other.getPixelOrigin())),
-                   compose(poly, other._cdInverse));
+    return detail::ComposedPolynomial(geom::AffineTransform(geom::Extent2D(other.getPixelOrigin())),
+                                      other.getPoly(), geom::AffineTransform(other._cdInverse), true)
+            .materialize();
 }
 
 PolynomialTransform::PolynomialTransform(int order) : _xCoeffs(), _yCoeffs(), _u(), _v() {
@@ -100,7 +104,8 @@ PolynomialTransform::PolynomialTransform(PolynomialTransform const& other)
           _u(other._u.size()),
           _v(other._v.size()) {}
 
-PolynomialTransform::PolynomialTransform(PolynomialTransform&& other) : _xCoeffs(), _yCoeffs(), _u(), _v() {
+PolynomialTransform::PolynomialTransform(PolynomialTransform&& other) noexcept
+        : _xCoeffs(), _yCoeffs(), _u(), _v() {
     this->swap(other);
 }
 
@@ -112,20 +117,29 @@ PolynomialTransform& PolynomialTransform::operator=(PolynomialTransform const& o
     return *this;
 }
 
-PolynomialTransform& PolynomialTransform::operator=(PolynomialTransform&& other) {
+PolynomialTransform& PolynomialTransform::operator=(PolynomialTransform&& other) noexcept {
     if (&other != this) {
         other.swap(*this);
     }
     return *this;
 }
 
-void PolynomialTransform::swap(PolynomialTransform& other) {
+void PolynomialTransform::swap(PolynomialTransform& other) noexcept {
     _xCoeffs.swap(other._xCoeffs);
     _yCoeffs.swap(other._yCoeffs);
     _u.swap(other._u);
     _v.swap(other._v);
 }
 
+void PolynomialTransform::_resize(int order) {
+    if (getOrder() != order) {
+        _xCoeffs = ndarray::allocate(order + 1, order + 1);
+        _yCoeffs = ndarray::allocate(order + 1, order + 1);
+        _u = Eigen::VectorXd(order + 1);
+        _v = Eigen::VectorXd(order + 1);
+    }
+}
+
 geom::AffineTransform PolynomialTransform::linearize(geom::Point2D const& in) const {
     double xu = 0.0, xv = 0.0, yu = 0.0, yv = 0.0, x = 0.0, y = 0.0;
     int const order = getOrder();
@@ -154,6 +168,49 @@ geom::AffineTransform PolynomialTransform::linearize(geom::Point2D const& in) co
     return geom::AffineTransform(linear, origin - linear(in));
 }
 
+void PolynomialTransform::linearize(ndarray::Array<double const, 1, 0> const& x,
+                                    ndarray::Array<double const, 1, 0> const& y,
+                                    ndarray::Array<double, 2, 2> const& out,
+                                    ndarray::Array<double, 3, 3> const& jacobian) const {
+    std::size_t const n = detail::checkBatchShapes(x, y, out, jacobian);
+    int const order = getOrder();
+    // Partial sums over powers of v for each power of u, e.g.
+    // sx[p] = sum_q A(p,q) v^q and dsx[p] = sum_q q A(p,q) v^(q-1);
+    // the value and both derivatives then follow from a single pass over p.
+    Eigen::VectorXd sx(order + 1), sy(order + 1), dsx(order + 1), dsy(order + 1);
+    for (std::size_t i = 0; i < n; ++i) {
+        detail::computePowers(_u, x[i]);
+        detail::computePowers(_v, y[i]);
+        for (int p = 0; p <= order; ++p) {
+            sx[p] = _xCoeffs(p, 0);
+            sy[p] = _yCoeffs(p, 0);
+            dsx[p] = 0.0;
+            dsy[p] = 0.0;
+            for (int q = 1; q <= order; ++q) {
+                sx[p] += _xCoeffs(p, q) * _v[q];
+                sy[p] += _yCoeffs(p, q) * _v[q];
+                dsx[p] += _xCoeffs(p, q) * q * _v[q - 1];
+                dsy[p] += _yCoeffs(p, q) * q * _v[q - 1];
+            }
+        }
+        double xu = 0.0, xv = dsx[0], yu = 0.0, yv = dsy[0], xOut = sx[0], yOut = sy[0];
+        for (int p = 1; p <= order; ++p) {
+            xu += sx[p] * p * _u[p - 1];
+            yu += sy[p] * p * _u[p - 1];
+            xv += dsx[p] * _u[p];
+            yv += dsy[p] * _u[p];
+            xOut += sx[p] * _u[p];
+            yOut += sy[p] * _u[p];
+        }
+        out[i][0] = xOut;
+        out[i][1] = yOut;
+        jacobian[i][0][0] = xu;
+        jacobian[i][0][1] = xv;
+        jacobian[i][1][0] = yu;
+        jacobian[i][1][1] = yv;
+    }
+}
+
 geom::Point2D PolynomialTransform::operator()(geom::Point2D const& in) const {
     int const order = getOrder();
     detail::computePowers(_u, in.getX());
@@ -169,6 +226,26 @@ geom::Point2D PolynomialTransform::operator()(geom::Point2D const& in) const {
     return geom::Point2D(x, y);
 }
 
+void PolynomialTransform::apply(ndarray::Array<double const, 1, 0> const& x,
+                                ndarray::Array<double const, 1, 0> const& y,
+                                ndarray::Array<double, 2, 2> const& out) const {
+    detail::ComposedPolynomial(geom::AffineTransform(), *this, geom::AffineTransform()).apply(x, y, out);
+}
+
+void PolynomialTransform::writeBinary(std::ostream& os) const {
+    detail::BinaryWriter writer(os);
+    writer.writeHeader(detail::BinaryTypeTag::POLYNOMIAL);
+    writer.writePolynomial(_xCoeffs, _yCoeffs);
+}
+
+PolynomialTransform PolynomialTransform::readBinary(std::istream& is) {
+    detail::BinaryReader reader(is);
+    reader.readHeader(detail::BinaryTypeTag::POLYNOMIAL);
+    ndarray::Array<double, 2, 2> xCoeffs, yCoeffs;
+    reader.readPolynomial(xCoeffs, yCoeffs);
+    return PolynomialTransform(xCoeffs, yCoeffs);
+}
+
 ScaledPolynomialTransform ScaledPolynomialTransform::convert(PolynomialTransform const& poly) {
     return ScaledPolynomialTransform(poly, geom::AffineTransform(), geom::AffineTransform());
 }
@@ -192,12 +269,27 @@ ScaledPolynomialTransform ScaledPolynomialTransform::convert(SipReverseTransform
     return result;
 }
 
+ScaledPolynomialTransform ScaledPolynomialTransform::convert(ScaledChebyshevTransform const& chebyshev) {
+    int const order = chebyshev.getOrder();
+    Eigen::MatrixXd const m = detail::makeChebyshevToMonomial(order);
+    PolynomialTransform poly(order);
+    ndarray::asEigenMatrix(poly._xCoeffs) = m.adjoint() * chebyshev.getXCoeffs() * m;
+    ndarray::asEigenMatrix(poly._yCoeffs) = m.adjoint() * chebyshev.getYCoeffs() * m;
+    return ScaledPolynomialTransform(std::move(poly), chebyshev.getInputScaling(),
+                                     chebyshev.getOutputScalingInverse());
+}
+
 ScaledPolynomialTransform::ScaledPolynomialTransform(PolynomialTransform const& poly,
                                                      geom::AffineTransform const& inputScaling,
                                                      geom::AffineTransform const& outputScalingInverse)
         : _poly(poly), _inputScaling(inputScaling), _outputScalingInverse(outputScalingInverse) {}
 
-void ScaledPolynomialTransform::swap(ScaledPolynomialTransform& other) {
+ScaledPolynomialTransform::ScaledPolynomialTransform(PolynomialTransform&& poly,
+                                                     geom::AffineTransform const& inputScaling,
+                                                     geom::AffineTransform const& outputScalingInverse)
+        : _poly(std::move(poly)), _inputScaling(inputScaling), _outputScalingInverse(outputScalingInverse) {}
+
+void ScaledPolynomialTransform::swap(ScaledPolynomialTransform& other) noexcept {
     _poly.swap(other._poly);
     std::swap(_inputScaling, other._inputScaling);
     std::swap(_outputScalingInverse, other._outputScalingInverse);
@@ -207,43 +299,132 @@ geom::AffineTransform ScaledPolynomialTransform::linearize(geom::Point2D const&
     return _outputScalingInverse * _poly.linearize(_inputScaling(in)) * _inputScaling;
 }
 
+void ScaledPolynomialTransform::linearize(ndarray::Array<double const, 1, 0> const& x,
+                                          ndarray::Array<double const, 1, 0> const& y,
+                                          ndarray::Array<double, 2, 2> const& out,
+                                          ndarray::Array<double, 3, 3> const& jacobian) const {
+    std::size_t const n = detail::checkBatchShapes(x, y, out, jacobian);
+    ndarray::Array<double, 1, 1> xScaled = ndarray::allocate(n);
+    ndarray::Array<double, 1, 1> yScaled = ndarray::allocate(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        geom::Point2D scaled = _inputScaling(geom::Point2D(x[i], y[i]));
+        xScaled[i] = scaled.getX();
+        yScaled[i] = scaled.getY();
+    }
+    _poly.linearize(xScaled, yScaled, out, jacobian);
+    Eigen::Matrix2d const inS = _inputScaling.getLinear().getMatrix();
+    Eigen::Matrix2d const outS = _outputScalingInverse.getLinear().getMatrix();
+    for (std::size_t i = 0; i < n; ++i) {
+        geom::Point2D result = _outputScalingInverse(geom::Point2D(out[i][0], out[i][1]));
+        out[i][0] = result.getX();
+        out[i][1] = result.getY();
+        Eigen::Map<Eigen::Matrix<double, 2, 2, Eigen::RowMajor>> jac(jacobian[i].getData());
+        jac = outS * jac * inS;
+    }
+}
+
 geom::Point2D ScaledPolynomialTransform::operator()(geom::Point2D const& in) const {
     return _outputScalingInverse(_poly(_inputScaling(in)));
 }
 
-PolynomialTransform compose(geom::AffineTransform const& t1, PolynomialTransform const& t2) {
-    typedef geom::AffineTransform AT;
-    PolynomialTransform result(t2.getOrder());
+void ScaledPolynomialTransform::apply(ndarray::Array<double const, 1, 0> const& x,
+                                      ndarray::Array<double const, 1, 0> const& y,
+                                      ndarray::Array<double, 2, 2> const& out) const {
+    detail::ComposedPolynomial(_outputScalingInverse, _poly, _inputScaling).apply(x, y, out);
+}
+
+void ScaledPolynomialTransform::writeBinary(std::ostream& os) const {
+    detail::BinaryWriter writer(os);
+    writer.writeHeader(detail::BinaryTypeTag::SCALED_POLYNOMIAL);
+    writer.writeAffine(_inputScaling);
+    writer.writeAffine(_outputScalingInverse);
+    writer.writePolynomial(_poly.getXCoeffs(), _poly.getYCoeffs());
+}
+
+ScaledPolynomialTransform ScaledPolynomialTransform::readBinary(std::istream& is) {
+    detail::BinaryReader reader(is);
+    reader.readHeader(detail::BinaryTypeTag::SCALED_POLYNOMIAL);
+    geom::AffineTransform inputScaling = reader.readAffine();
+    geom::AffineTransform outputScalingInverse = reader.readAffine();
+    ndarray::Array<double, 2, 2> xCoeffs, yCoeffs;
+    reader.readPolynomial(xCoeffs, yCoeffs);
+    return ScaledPolynomialTransform(PolynomialTransform(xCoeffs, yCoeffs), inputScaling,
+                                     outputScalingInverse);
+}
+
+ScaledPolynomialTransform compose(geom::AffineTransform const& t1, ScaledPolynomialTransform const& t2) {
+    return ScaledPolynomialTransform(t2.getPoly(), t2.getInputScaling(), t1 * t2.getOutputScalingInverse());
+}
 
-    result._xCoeffs.deep() = t2._xCoeffs * t1[AT::XX] + t2._yCoeffs * t1[AT::XY];
-    result._yCoeffs.deep() = t2._xCoeffs * t1[AT::YX] + t2._yCoeffs * t1[AT::YY];
+ScaledPolynomialTransform compose(ScaledPolynomialTransform const& t1, geom::AffineTransform const& t2) {
+    return ScaledPolynomialTransform(t1.getPoly(), t1.getInputScaling() * t2, t1.getOutputScalingInverse());
+}
+
+void compose(geom::AffineTransform const& t1, PolynomialTransform const& t2, PolynomialTransform& result) {
+    typedef geom::AffineTransform AT;
+    result._resize(t2.getOrder());
+    int const order = t2.getOrder();
+    // Each output coefficient depends only on the input coefficients at the
+    // same position, so this is safe even when result and t2 are the same.
+    // Like the copy-based version this replaces, the whole square array is
+    // transformed, including any nonzero elements with p + q > order.
+    for (int p = 0; p <= order; ++p) {
+        for (int q = 0; q <= order; ++q) {
+            double const x = t2._xCoeffs(p, q);
+            double const y = t2._yCoeffs(p, q);
+            result._xCoeffs(p, q) = t1[AT::XX] * x + t1[AT::XY] * y;
+            result._yCoeffs(p, q) = t1[AT::YX] * x + t1[AT::YY] * y;
+        }
+    }
     result._xCoeffs(0, 0) += t1[AT::X];
     result._yCoeffs(0, 0) += t1[AT::Y];
+}
+
+PolynomialTransform compose(geom::AffineTransform const& t1, PolynomialTransform const& t2) {
+    PolynomialTransform result(t2.getOrder());
+    compose(t1, t2, result);
     return result;
 }
 
-PolynomialTransform compose(PolynomialTransform const& t1, geom::AffineTransform const& t2) {
+PolynomialTransform compose(geom::AffineTransform const& t1, PolynomialTransform&& t2) {
+    PolynomialTransform result(std::move(t2));
+    compose(t1, result, result);
+    return result;
+}
+
+void compose(PolynomialTransform const& t1, geom::AffineTransform const& t2, PolynomialTransform& result) {
     typedef geom::AffineTransform AT;
-    int const order = t1.getOrder();
-    if (order < 1) {
-        PolynomialTransform t1a(1);
-        t1a._xCoeffs(0, 0) = t1._xCoeffs(0, 0);
-        t1a._yCoeffs(0, 0) = t1._yCoeffs(0, 0);
-        return compose(t1a, t2);
+    if (&result == &t1) {
+        PolynomialTransform tmp(t1);
+        compose(tmp, t2, result);
+        return;
     }
+    int const inOrder = t1.getOrder();
+    int const order = std::max(inOrder, 1);
+    result._resize(order);
+    result._xCoeffs.deep() = 0.0;
+    result._yCoeffs.deep() = 0.0;
     detail::BinomialMatrix binomial(order);
-    // For each of these, (e.g.) a[n] == pow(a, n)
-    auto const t2u = detail::computePowers(t2[AT::X], order);
-    auto const t2v = detail::computePowers(t2[AT::Y], order);
-    auto const t2uu = detail::computePowers(t2[AT::XX], order);
-    auto const t2uv = detail::computePowers(t2[AT::XY], order);
-    auto const t2vu = detail::computePowers(t2[AT::YX], order);
-    auto const t2vv = detail::computePowers(t2[AT::YY], order);
-    PolynomialTransform result(order);
-    for (int p = 0; p <= order; ++p) {
+    // Column c of powers holds the powers of one affine coefficient, e.g.
+    // powers(n, 0) == pow(t2[AT::X], n).
+    Eigen::Matrix<double, Eigen::Dynamic, 6> powers(order + 1, 6);
+    AT::Parameters const params[6] = {AT::X, AT::Y, AT::XX, AT::XY, AT::YX, AT::YY};
+    for (int c = 0; c < 6; ++c) {
+        powers(0, c) = 1.0;
+        for (int n = 1; n <= order; ++n) {
+            powers(n, c) = powers(n - 1, c) * t2[params[c]];
+        }
+    }
+    auto const t2u = powers.col(0);
+    auto const t2v = powers.col(1);
+    auto const t2uu = powers.col(2);
+    auto const t2uv = powers.col(3);
+    auto const t2vu = powers.col(4);
+    auto const t2vv = powers.col(5);
+    for (int p = 0; p <= inOrder; ++p) {
         for (int m = 0; m <= p; ++m) {
             for (int j = 0; j <= m; ++j) {
-                for (int q = 0; p + q <= order; ++q) {
+                for (int q = 0; p + q <= inOrder; ++q) {
                     for (int n = 0; n <= q; ++n) {
                         for (int k = 0; k <= n; ++k) {
                             double z = binomial(p, m) * t2u[p - m] * binomial(m, j) * t2uu[j] * t2uv[m - j] *
@@ -256,6 +437,11 @@ PolynomialTransform compose(PolynomialTransform const& t1, geom::AffineTransform
             }              // j
         }                  // m
     }                      // p
+}
+
+PolynomialTransform compose(PolynomialTransform const& t1, geom::AffineTransform const& t2) {
+    PolynomialTransform result(std::max(t1.getOrder(), 1));
+    compose(t1, t2, result);
     return result;
 }
 
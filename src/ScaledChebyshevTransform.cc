@@ -0,0 +1,115 @@
+// -*- LSST-C++ -*-
+
+/*
+ * This file is part of meas_astrom.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "boost/format.hpp"
+
+#include "lsst/pex/exceptions.h"
+#include "lsst/geom/LinearTransform.h"
+#include "lsst/meas/astrom/ScaledChebyshevTransform.h"
+#include "lsst/meas/astrom/detail/polynomialUtils.h"
+
+namespace lsst {
+namespace meas {
+namespace astrom {
+
+namespace {
+
+// Evaluate sum_k a[k] T_k(x) with Clenshaw's recurrence.
+template <typename Vector>
+double clenshaw(Vector const& a, double x) {
+    double b1 = 0.0;
+    double b2 = 0.0;
+    for (int k = a.size() - 1; k >= 1; --k) {
+        double b0 = a[k] + 2.0 * x * b1 - b2;
+        b2 = b1;
+        b1 = b0;
+    }
+    return a[0] + x * b1 - b2;
+}
+
+}  // namespace
+
+ScaledChebyshevTransform::ScaledChebyshevTransform(ndarray::Array<double const, 2, 0> const& xCoeffs,
+                                                   ndarray::Array<double const, 2, 0> const& yCoeffs,
+                                                   geom::AffineTransform const& inputScaling,
+                                                   geom::AffineTransform const& outputScalingInverse)
+        : _xCoeffs(ndarray::asEigenMatrix(xCoeffs)),
+          _yCoeffs(ndarray::asEigenMatrix(yCoeffs)),
+          _inputScaling(inputScaling),
+          _outputScalingInverse(outputScalingInverse) {
+    if (xCoeffs.getShape() != yCoeffs.getShape()) {
+        throw LSST_EXCEPT(
+                pex::exceptions::LengthError,
+                (boost::format("X and Y coefficient matrices must have the same shape: "
+                               " (%d,%d) != (%d,%d)") %
+                 xCoeffs.getSize<0>() % xCoeffs.getSize<1>() % yCoeffs.getSize<0>() % yCoeffs.getSize<1>())
+                        .str());
+    }
+    if (_xCoeffs.rows() != _xCoeffs.cols() || _xCoeffs.rows() == 0) {
+        throw LSST_EXCEPT(pex::exceptions::LengthError,
+                          (boost::format("Coefficient matrices must be square and nonempty: "
+                                         " (%d,%d) ") %
+                           _xCoeffs.rows() % _xCoeffs.cols())
+                                  .str());
+    }
+}
+
+ScaledChebyshevTransform::ScaledChebyshevTransform(int order, geom::AffineTransform const& inputScaling,
+                                                   geom::AffineTransform const& outputScalingInverse)
+        : _xCoeffs(Eigen::MatrixXd::Zero(order + 1, order + 1)),
+          _yCoeffs(Eigen::MatrixXd::Zero(order + 1, order + 1)),
+          _inputScaling(inputScaling),
+          _outputScalingInverse(outputScalingInverse) {}
+
+geom::AffineTransform ScaledChebyshevTransform::linearize(geom::Point2D const& in) const {
+    int const order = getOrder();
+    geom::Point2D scaled = _inputScaling(in);
+    Eigen::VectorXd tx(order + 1), dtx(order + 1), ty(order + 1), dty(order + 1);
+    detail::computeChebyshev(tx, dtx, scaled.getX());
+    detail::computeChebyshev(ty, dty, scaled.getY());
+    geom::LinearTransform linear;
+    linear.getMatrix()(0, 0) = dtx.dot(_xCoeffs * ty);
+    linear.getMatrix()(0, 1) = tx.dot(_xCoeffs * dty);
+    linear.getMatrix()(1, 0) = dtx.dot(_yCoeffs * ty);
+    linear.getMatrix()(1, 1) = tx.dot(_yCoeffs * dty);
+    geom::Point2D origin(tx.dot(_xCoeffs * ty), tx.dot(_yCoeffs * ty));
+    return _outputScalingInverse * geom::AffineTransform(linear, origin - linear(scaled)) * _inputScaling;
+}
+
+geom::Point2D ScaledChebyshevTransform::operator()(geom::Point2D const& in) const {
+    int const order = getOrder();
+    geom::Point2D scaled = _inputScaling(in);
+    // Sum over T_q(y) for each p first, then over T_p(x).
+    Eigen::VectorXd gx(order + 1), gy(order + 1);
+    for (int p = 0; p <= order; ++p) {
+        gx[p] = clenshaw(_xCoeffs.row(p), scaled.getY());
+        gy[p] = clenshaw(_yCoeffs.row(p), scaled.getY());
+    }
+    return _outputScalingInverse(geom::Point2D(clenshaw(gx, scaled.getX()), clenshaw(gy, scaled.getX())));
+}
+
+}  // namespace astrom
+}  // namespace meas
+}  // namespace lsst
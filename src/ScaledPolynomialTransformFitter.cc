@@ -126,7 +126,7 @@ geom::AffineTransform computeScaling(afw::table::BaseCatalog const &data, afw::t
 
 ScaledPolynomialTransformFitter ScaledPolynomialTransformFitter::fromMatches(
         int maxOrder, afw::table::ReferenceMatchVector const &matches, afw::geom::SkyWcs const &initialWcs,
-        double intrinsicScatter) {
+        double intrinsicScatter, bool chebyshev) {
     Keys const &keys = Keys::forMatches();
     afw::table::BaseCatalog catalog(keys.schema);
     catalog.reserve(matches.size());
@@ -144,12 +144,12 @@ ScaledPolynomialTransformFitter ScaledPolynomialTransformFitter::fromMatches(
     }
     return ScaledPolynomialTransformFitter(catalog, keys, maxOrder, intrinsicScatter,
                                            computeScaling(catalog, keys.input),
-                                           computeScaling(catalog, keys.output));
+                                           computeScaling(catalog, keys.output), chebyshev);
 }
 
 ScaledPolynomialTransformFitter ScaledPolynomialTransformFitter::fromGrid(
         int maxOrder, geom::Box2D const &bbox, int nGridX, int nGridY,
-        ScaledPolynomialTransform const &toInvert) {
+        ScaledPolynomialTransform const &toInvert, bool chebyshev) {
     Keys const &keys = Keys::forGrid();
     afw::table::BaseCatalog catalog(keys.schema);
     catalog.reserve(nGridX * nGridY);
@@ -164,27 +164,36 @@ ScaledPolynomialTransformFitter ScaledPolynomialTransformFitter::fromGrid(
         }
     }
     return ScaledPolynomialTransformFitter(catalog, keys, maxOrder, 0.0, computeScaling(catalog, keys.input),
-                                           computeScaling(catalog, keys.output));
+                                           computeScaling(catalog, keys.output), chebyshev);
 }
 
 ScaledPolynomialTransformFitter::ScaledPolynomialTransformFitter(afw::table::BaseCatalog const &data,
                                                                  Keys const &keys, int maxOrder,
                                                                  double intrinsicScatter,
                                                                  geom::AffineTransform const &inputScaling,
-                                                                 geom::AffineTransform const &outputScaling)
+                                                                 geom::AffineTransform const &outputScaling,
+                                                                 bool chebyshev)
         : _keys(keys),
           _intrinsicScatter(intrinsicScatter),
           _data(data),
           _outputScaling(outputScaling),
           _transform(PolynomialTransform(maxOrder), inputScaling, outputScaling.inverted()),
+          _isChebyshev(chebyshev),
+          _chebyshev(maxOrder, inputScaling, outputScaling.inverted()),
           _vandermonde(data.size(), detail::computePackedSize(maxOrder)) {
     // Create a matrix that evaluates the max-order polynomials of all the (scaled) input positions;
     // we'll extract subsets of this later when fitting to a subset of the matches and a lower order.
     for (std::size_t i = 0; i < data.size(); ++i) {
         geom::Point2D input = getInputScaling()(_data[i].get(_keys.input));
-        // x[k] == pow(x, k), y[k] == pow(y, k)
-        detail::computePowers(_transform._poly._u, input.getX());
-        detail::computePowers(_transform._poly._v, input.getY());
+        if (_isChebyshev) {
+            // x[k] == T_k(x), y[k] == T_k(y)
+            detail::computeChebyshev(_transform._poly._u, input.getX());
+            detail::computeChebyshev(_transform._poly._v, input.getY());
+        } else {
+            // x[k] == pow(x, k), y[k] == pow(y, k)
+            detail::computePowers(_transform._poly._u, input.getX());
+            detail::computePowers(_transform._poly._v, input.getY());
+        }
         // We pack coefficients in the following order:
         // (0,0), (0,1), (1,0), (0,2), (1,1), (2,0)
         // Note that this lets us choose the just first N(N+1)/2 columns to
@@ -276,9 +285,26 @@ void ScaledPolynomialTransformFitter::fit(int order) {
     Eigen::VectorXd g(2 * packedSize);
     g.head(packedSize) = m.adjoint() * (fxx.matrix().asDiagonal() * vx + fxy.matrix().asDiagonal() * vy);
     g.tail(packedSize) = m.adjoint() * (fxy.matrix().asDiagonal() * vx + fyy.matrix().asDiagonal() * vy);
-    // Solve the normal equations.
-    auto lstsq = afw::math::LeastSquares::fromNormalEquations(h, g);
+    // Solve the normal equations.  The Chebyshev basis keeps them well-conditioned,
+    // so we can use a Cholesky factorization instead of the default eigensystem.
+    auto factorization = _isChebyshev ? afw::math::LeastSquares::NORMAL_CHOLESKY
+                                      : afw::math::LeastSquares::NORMAL_EIGENSYSTEM;
+    auto lstsq = afw::math::LeastSquares::fromNormalEquations(h, g, factorization);
     auto solution = lstsq.getSolution();
+    if (_isChebyshev) {
+        // Unpack into the Chebyshev coefficients, then convert the full
+        // series to monomials for getTransform().
+        _chebyshev._xCoeffs.setZero();
+        _chebyshev._yCoeffs.setZero();
+        for (int n = 0, j = 0; n <= order; ++n) {
+            for (int p = 0, q = n; p <= n; ++p, --q, ++j) {
+                _chebyshev._xCoeffs(p, q) = solution[j];
+                _chebyshev._yCoeffs(p, q) = solution[j + packedSize];
+            }
+        }
+        _transform = ScaledPolynomialTransform::convert(_chebyshev);
+        return;
+    }
     // Unpack the solution vector back into the polynomial coefficient matrices.
     for (int n = 0, j = 0; n <= order; ++n) {
         for (int p = 0, q = n; p <= n; ++p, --q, ++j) {
@@ -289,11 +315,25 @@ void ScaledPolynomialTransformFitter::fit(int order) {
 }
 
 void ScaledPolynomialTransformFitter::updateModel() {
+    if (_isChebyshev) {
+        for (auto &record : _data) {
+            record.set(_keys.model, _chebyshev(record.get(_keys.input)));
+        }
+        return;
+    }
     for (auto &record : _data) {
         record.set(_keys.model, _transform(record.get(_keys.input)));
     }
 }
 
+ScaledChebyshevTransform const &ScaledPolynomialTransformFitter::getChebyshevTransform() const {
+    if (!_isChebyshev) {
+        throw LSST_EXCEPT(pex::exceptions::LogicError,
+                          "Fitter was not initialized with chebyshev=true.");
+    }
+    return _chebyshev;
+}
+
 double ScaledPolynomialTransformFitter::updateIntrinsicScatter() {
     if (!_keys.rejected.isValid()) {
         throw LSST_EXCEPT(pex::exceptions::LogicError,
@@ -22,7 +22,14 @@
  * see <http://www.lsstcorp.org/LegalNotices/>.
  */
 
+#include <limits>
+#include <numeric>
 #include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Eigen/LU"
 
 #include "lsst/geom/Point.h"
 #include "lsst/geom/Angle.h"
@@ -30,8 +37,13 @@
 #include "lsst/geom/AffineTransform.h"
 #include "lsst/geom/LinearTransform.h"
 #include "lsst/afw/geom/SkyWcs.h"
+#include "lsst/afw/geom/wcsUtils.h"
 #include "lsst/afw/geom/transformFactory.h"
 #include "lsst/meas/astrom/SipTransform.h"
+#include "lsst/meas/astrom/TanSipEvaluator.h"
+#include "lsst/meas/astrom/detail/polynomialUtils.h"
+#include "lsst/meas/astrom/detail/binaryIo.h"
+#include "lsst/meas/astrom/detail/composedPolynomial.h"
 
 namespace lsst {
 namespace meas {
@@ -46,6 +58,8 @@ void SipTransformBase::transformPixelsInPlace(geom::AffineTransform const& s) {
     auto sInv = s.inverted();
     _pixelOrigin = s.getLinear()(_pixelOrigin - sInv.getTranslation());
     _cdMatrix = _cdMatrix * sInv.getLinear();
+    // The inner composition allocates the only new coefficient arrays; the
+    // outer one reuses them, and they are then moved into place.
     _poly = compose(s.getLinear(), compose(getPoly(), sInv.getLinear()));
 }
 
@@ -59,7 +73,7 @@ SipForwardTransform SipForwardTransform::convert(PolynomialTransform const& poly
     // terms into the sum by adding 1 from the A_10 and B_01 terms.
     forwardSipPoly._xCoeffs(1, 0) -= 1;
     forwardSipPoly._yCoeffs(0, 1) -= 1;
-    return SipForwardTransform(pixelOrigin, cdMatrix, forwardSipPoly);
+    return SipForwardTransform(pixelOrigin, cdMatrix, std::move(forwardSipPoly));
 }
 
 SipForwardTransform SipForwardTransform::convert(ScaledPolynomialTransform const& scaled,
@@ -73,7 +87,7 @@ SipForwardTransform SipForwardTransform::convert(ScaledPolynomialTransform const
     // earlier in the file for more explanation).
     forwardSipPoly._xCoeffs(1, 0) -= 1;
     forwardSipPoly._yCoeffs(0, 1) -= 1;
-    return SipForwardTransform(pixelOrigin, cdMatrix, forwardSipPoly);
+    return SipForwardTransform(pixelOrigin, cdMatrix, std::move(forwardSipPoly));
 }
 
 SipForwardTransform SipForwardTransform::convert(ScaledPolynomialTransform const& scaled) {
@@ -82,22 +96,146 @@ SipForwardTransform SipForwardTransform::convert(ScaledPolynomialTransform const
     return convert(scaled, pixelOrigin, cdMatrix);
 }
 
+SipForwardTransform SipForwardTransform::convert(ScaledChebyshevTransform const& chebyshev,
+                                                 geom::Point2D const& pixelOrigin,
+                                                 geom::LinearTransform const& cdMatrix) {
+    return convert(ScaledPolynomialTransform::convert(chebyshev), pixelOrigin, cdMatrix);
+}
+
 geom::AffineTransform SipForwardTransform::linearize(geom::Point2D const& in) const {
     geom::AffineTransform tail(-geom::Extent2D(getPixelOrigin()));
     return geom::AffineTransform(_cdMatrix) * (geom::AffineTransform() + _poly.linearize(tail(in))) * tail;
 }
 
+void SipForwardTransform::linearize(ndarray::Array<double const, 1, 0> const& x,
+                                    ndarray::Array<double const, 1, 0> const& y,
+                                    ndarray::Array<double, 2, 2> const& out,
+                                    ndarray::Array<double, 3, 3> const& jacobian) const {
+    std::size_t const n = detail::checkBatchShapes(x, y, out, jacobian);
+    ndarray::Array<double, 1, 1> du = ndarray::allocate(n);
+    ndarray::Array<double, 1, 1> dv = ndarray::allocate(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        du[i] = x[i] - _pixelOrigin.getX();
+        dv[i] = y[i] - _pixelOrigin.getY();
+    }
+    _poly.linearize(du, dv, out, jacobian);
+    Eigen::Matrix2d const cd = _cdMatrix.getMatrix();
+    for (std::size_t i = 0; i < n; ++i) {
+        Eigen::Vector2d result = cd * Eigen::Vector2d(du[i] + out[i][0], dv[i] + out[i][1]);
+        out[i][0] = result[0];
+        out[i][1] = result[1];
+        Eigen::Map<Eigen::Matrix<double, 2, 2, Eigen::RowMajor>> jac(jacobian[i].getData());
+        jac = cd * (Eigen::Matrix2d::Identity() + jac);
+    }
+}
+
 geom::Point2D SipForwardTransform::operator()(geom::Point2D const& uv) const {
     geom::Point2D duv(uv - geom::Extent2D(getPixelOrigin()));
     return getCdMatrix()(geom::Extent2D(duv) + getPoly()(duv));
 }
 
+void SipForwardTransform::apply(ndarray::Array<double const, 1, 0> const& x,
+                                ndarray::Array<double const, 1, 0> const& y,
+                                ndarray::Array<double, 2, 2> const& out) const {
+    detail::ComposedPolynomial(geom::AffineTransform(getCdMatrix()), getPoly(),
+                               geom::AffineTransform(geom::Point2D() - getPixelOrigin()), true)
+            .apply(x, y, out);
+}
+
+void SipForwardTransform::applyInverse(ndarray::Array<double const, 1, 0> const& x,
+                                       ndarray::Array<double const, 1, 0> const& y,
+                                       ndarray::Array<double, 2, 2> const& out, double tolerance,
+                                       int maxIter) const {
+    std::size_t const n = detail::checkBatchShapes(x, y, out);
+    auto const cdInverse = _cdMatrix.inverted();
+    for (std::size_t i = 0; i < n; ++i) {
+        geom::Point2D seed = _pixelOrigin + geom::Extent2D(cdInverse(geom::Point2D(x[i], y[i])));
+        out[i][0] = seed.getX();
+        out[i][1] = seed.getY();
+    }
+    _refineInverse(x, y, out, tolerance, maxIter);
+}
+
+void SipForwardTransform::applyInverse(ndarray::Array<double const, 1, 0> const& x,
+                                       ndarray::Array<double const, 1, 0> const& y,
+                                       ndarray::Array<double, 2, 2> const& out, SipReverseTransform const& seed,
+                                       double tolerance, int maxIter) const {
+    std::size_t const n = detail::checkBatchShapes(x, y, out);
+    for (std::size_t i = 0; i < n; ++i) {
+        geom::Point2D start = seed(geom::Point2D(x[i], y[i]));
+        out[i][0] = start.getX();
+        out[i][1] = start.getY();
+    }
+    _refineInverse(x, y, out, tolerance, maxIter);
+}
+
+void SipForwardTransform::_refineInverse(ndarray::Array<double const, 1, 0> const& x,
+                                         ndarray::Array<double const, 1, 0> const& y,
+                                         ndarray::Array<double, 2, 2> const& out, double tolerance,
+                                         int maxIter) const {
+    std::size_t const n = x.getSize<0>();
+    // Indices of points that have not yet converged; each iteration only
+    // evaluates the transform at these, packed into the front of the
+    // workspace arrays.
+    std::vector<std::size_t> active(n);
+    std::iota(active.begin(), active.end(), 0);
+    ndarray::Array<double, 1, 1> u = ndarray::allocate(n);
+    ndarray::Array<double, 1, 1> v = ndarray::allocate(n);
+    ndarray::Array<double, 2, 2> values = ndarray::allocate(n, 2);
+    ndarray::Array<double, 3, 3> jacobian = ndarray::allocate(n, 2, 2);
+    double const tolerance2 = tolerance * tolerance;
+    for (int iter = 0; iter < maxIter && !active.empty(); ++iter) {
+        std::size_t const m = active.size();
+        for (std::size_t k = 0; k < m; ++k) {
+            u[k] = out[active[k]][0];
+            v[k] = out[active[k]][1];
+        }
+        linearize(u[ndarray::view(0, m)], v[ndarray::view(0, m)], values[ndarray::view(0, m)()],
+                  jacobian[ndarray::view(0, m)()()]);
+        std::size_t nActive = 0;
+        for (std::size_t k = 0; k < m; ++k) {
+            std::size_t const i = active[k];
+            Eigen::Map<Eigen::Matrix<double, 2, 2, Eigen::RowMajor>> jac(jacobian[k].getData());
+            Eigen::Vector2d residual(x[i] - values[k][0], y[i] - values[k][1]);
+            Eigen::Vector2d step = jac.inverse() * residual;
+            out[i][0] += step[0];
+            out[i][1] += step[1];
+            if (step.squaredNorm() > tolerance2) {
+                active[nActive++] = i;
+            }
+        }
+        active.resize(nActive);
+    }
+    for (std::size_t i : active) {
+        out[i][0] = std::numeric_limits<double>::quiet_NaN();
+        out[i][1] = std::numeric_limits<double>::quiet_NaN();
+    }
+}
+
 SipForwardTransform SipForwardTransform::transformPixels(geom::AffineTransform const& s) const {
     SipForwardTransform result(*this);
     result.transformPixelsInPlace(s);
     return result;
 }
 
+void SipForwardTransform::writeBinary(std::ostream& os) const {
+    detail::BinaryWriter writer(os);
+    writer.writeHeader(detail::BinaryTypeTag::SIP_FORWARD);
+    writer.writePoint(getPixelOrigin());
+    writer.writeLinear(getCdMatrix());
+    writer.writePolynomial(getPoly().getXCoeffs(), getPoly().getYCoeffs());
+}
+
+SipForwardTransform SipForwardTransform::readBinary(std::istream& is) {
+    detail::BinaryReader reader(is);
+    reader.readHeader(detail::BinaryTypeTag::SIP_FORWARD);
+    geom::Point2D pixelOrigin = reader.readPoint();
+    geom::LinearTransform cdMatrix = reader.readLinear();
+    ndarray::Array<double, 2, 2> xCoeffs, yCoeffs;
+    reader.readPolynomial(xCoeffs, yCoeffs);
+    return SipForwardTransform(pixelOrigin, cdMatrix, PolynomialTransform(xCoeffs, yCoeffs));
+}
+
 SipReverseTransform SipReverseTransform::convert(PolynomialTransform const& poly,
                                                  geom::Point2D const& pixelOrigin,
                                                  geom::LinearTransform const& cdMatrix) {
@@ -107,7 +245,7 @@ SipReverseTransform SipReverseTransform::convert(PolynomialTransform const& poly
     // earlier in the file for more explanation).
     reverseSipPoly._xCoeffs(1, 0) -= 1;
     reverseSipPoly._yCoeffs(0, 1) -= 1;
-    return SipReverseTransform(pixelOrigin, cdMatrix, reverseSipPoly);
+    return SipReverseTransform(pixelOrigin, cdMatrix, std::move(reverseSipPoly));
 }
 
 SipReverseTransform SipReverseTransform::convert(ScaledPolynomialTransform const& scaled,
@@ -120,7 +258,7 @@ SipReverseTransform SipReverseTransform::convert(ScaledPolynomialTransform const
     // earlier in the file for more explanation).
     reverseSipPoly._xCoeffs(1, 0) -= 1;
     reverseSipPoly._yCoeffs(0, 1) -= 1;
-    return SipReverseTransform(pixelOrigin, cdMatrix, reverseSipPoly);
+    return SipReverseTransform(pixelOrigin, cdMatrix, std::move(reverseSipPoly));
 }
 
 SipReverseTransform SipReverseTransform::convert(ScaledPolynomialTransform const& scaled) {
@@ -128,6 +266,12 @@ SipReverseTransform SipReverseTransform::convert(ScaledPolynomialTransform const
                    scaled.getInputScaling().getLinear());
 }
 
+SipReverseTransform SipReverseTransform::convert(ScaledChebyshevTransform const& chebyshev,
+                                                 geom::Point2D const& pixelOrigin,
+                                                 geom::LinearTransform const& cdMatrix) {
+    return convert(ScaledPolynomialTransform::convert(chebyshev), pixelOrigin, cdMatrix);
+}
+
 SipReverseTransform SipReverseTransform::transformPixels(geom::AffineTransform const& s) const {
     SipReverseTransform result(*this);
     result.transformPixelsInPlace(s);
@@ -135,16 +279,64 @@ SipReverseTransform SipReverseTransform::transformPixels(geom::AffineTransform c
     return result;
 }
 
+void SipReverseTransform::writeBinary(std::ostream& os) const {
+    detail::BinaryWriter writer(os);
+    writer.writeHeader(detail::BinaryTypeTag::SIP_REVERSE);
+    writer.writePoint(getPixelOrigin());
+    writer.writeLinear(getCdMatrix());
+    writer.writePolynomial(getPoly().getXCoeffs(), getPoly().getYCoeffs());
+}
+
+SipReverseTransform SipReverseTransform::readBinary(std::istream& is) {
+    detail::BinaryReader reader(is);
+    reader.readHeader(detail::BinaryTypeTag::SIP_REVERSE);
+    geom::Point2D pixelOrigin = reader.readPoint();
+    geom::LinearTransform cdMatrix = reader.readLinear();
+    ndarray::Array<double, 2, 2> xCoeffs, yCoeffs;
+    reader.readPolynomial(xCoeffs, yCoeffs);
+    return SipReverseTransform(pixelOrigin, cdMatrix, PolynomialTransform(xCoeffs, yCoeffs));
+}
+
 geom::AffineTransform SipReverseTransform::linearize(geom::Point2D const& in) const {
     return geom::AffineTransform(geom::Extent2D(getPixelOrigin())) *
            (geom::AffineTransform() + _poly.linearize(_cdInverse(in))) * _cdInverse;
 }
 
+void SipReverseTransform::linearize(ndarray::Array<double const, 1, 0> const& x,
+                                    ndarray::Array<double const, 1, 0> const& y,
+                                    ndarray::Array<double, 2, 2> const& out,
+                                    ndarray::Array<double, 3, 3> const& jacobian) const {
+    std::size_t const n = detail::checkBatchShapes(x, y, out, jacobian);
+    ndarray::Array<double, 1, 1> uu = ndarray::allocate(n);
+    ndarray::Array<double, 1, 1> vv = ndarray::allocate(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        geom::Point2D UV = _cdInverse(geom::Point2D(x[i], y[i]));
+        uu[i] = UV.getX();
+        vv[i] = UV.getY();
+    }
+    _poly.linearize(uu, vv, out, jacobian);
+    Eigen::Matrix2d const cdInverse = _cdInverse.getMatrix();
+    for (std::size_t i = 0; i < n; ++i) {
+        out[i][0] += uu[i] + _pixelOrigin.getX();
+        out[i][1] += vv[i] + _pixelOrigin.getY();
+        Eigen::Map<Eigen::Matrix<double, 2, 2, Eigen::RowMajor>> jac(jacobian[i].getData());
+        jac = (Eigen::Matrix2d::Identity() + jac) * cdInverse;
+    }
+}
+
 geom::Point2D SipReverseTransform::operator()(geom::Point2D const& xy) const {
     geom::Point2D UV = _cdInverse(xy);
     return geom::Extent2D(UV) + geom::Extent2D(getPixelOrigin()) + getPoly()(UV);
 }
 
+void SipReverseTransform::apply(ndarray::Array<double const, 1, 0> const& x,
+                                ndarray::Array<double const, 1, 0> const& y,
+                                ndarray::Array<double, 2, 2> const& out) const {
+    detail::ComposedPolynomial(geom::AffineTransform(geom::Extent2D(getPixelOrigin())), getPoly(),
+                               geom::AffineTransform(_cdInverse), true)
+            .apply(x, y, out);
+}
+
 std::shared_ptr<afw::geom::SkyWcs> makeWcs(SipForwardTransform const& sipForward,
                                            SipReverseTransform const& sipReverse,
                                            geom::SpherePoint const& skyOrigin) {
@@ -170,8 +362,60 @@ std::shared_ptr<afw::geom::SkyWcs> makeWcs(SipForwardTransform const& sipForward
                                     sipForward.getCdMatrix().getMatrix(), sipA, sipB, sipAP, sipBP);
 }
 
+namespace {
+
+// If wcs is an ICRS TAN or TAN-SIP WCS with no extra mappings, fold the
+// pixel transform s into its CRPIX, CD matrix and SIP polynomials and return
+// the result as a new TAN-SIP WCS.  Return nullptr if it is not a TAN WCS
+// in FITS form or not ICRS, and throw InvalidParameterError if it is a TAN
+// WCS whose axes are not RA---TAN and DEC--TAN.
+std::shared_ptr<afw::geom::SkyWcs> transformTanSipWcsPixels(afw::geom::SkyWcs const& wcs,
+                                                            geom::AffineTransform const& s) {
+    if (!wcs.isFits()) {
+        return nullptr;
+    }
+    auto metadata = wcs.getFitsMetadata(true);
+    std::string const ctype1 = metadata->getAsString("CTYPE1");
+    std::string const ctype2 = metadata->getAsString("CTYPE2");
+    if (ctype1.find("-TAN") == std::string::npos || ctype2.find("-TAN") == std::string::npos) {
+        return nullptr;
+    }
+    // The result is built with makeTanSipWcs, which always has RA, Dec axes.
+    if (ctype1.compare(0, 8, "RA---TAN") != 0 || ctype2.compare(0, 8, "DEC--TAN") != 0) {
+        throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                          "TAN WCS with CTYPE1=" + ctype1 + ", CTYPE2=" + ctype2 +
+                                  " does not have RA---TAN, DEC--TAN axes");
+    }
+    if (metadata->exists("RADESYS") && metadata->getAsString("RADESYS").find("ICRS") == std::string::npos) {
+        return nullptr;
+    }
+    bool const hasForward = afw::geom::hasSipMatrix(*metadata, "A");
+    // Without AP and BP, the evaluator inverts the forward polynomial, and
+    // so does the WCS (which we also want to preserve).
+    TanSipEvaluator evaluator(wcs);
+    bool const hasReverse = hasForward && !evaluator.isExactInverse();
+    SipForwardTransform sipForward = evaluator.getSipForward().transformPixels(s);
+    if (!hasForward) {
+        return afw::geom::makeSkyWcs(sipForward.getPixelOrigin(), evaluator.getSkyOrigin(),
+                                     sipForward.getCdMatrix().getMatrix());
+    }
+    Eigen::MatrixXd sipA(ndarray::asEigenMatrix(sipForward.getPoly().getXCoeffs()));
+    Eigen::MatrixXd sipB(ndarray::asEigenMatrix(sipForward.getPoly().getYCoeffs()));
+    if (!hasReverse) {
+        return afw::geom::makeTanSipWcs(sipForward.getPixelOrigin(), evaluator.getSkyOrigin(),
+                                        sipForward.getCdMatrix().getMatrix(), sipA, sipB);
+    }
+    return makeWcs(sipForward, evaluator.getSipReverse().transformPixels(s), evaluator.getSkyOrigin());
+}
+
+}  // namespace
+
 std::shared_ptr<afw::geom::SkyWcs> transformWcsPixels(afw::geom::SkyWcs const& wcs,
                                                       geom::AffineTransform const& s) {
+    auto result = transformTanSipWcsPixels(wcs, s);
+    if (result) {
+        return result;
+    }
     auto affineTransform22 = afw::geom::makeTransform(s);
     return afw::geom::makeModifiedWcs(*affineTransform22->inverted(), wcs, true);
 }
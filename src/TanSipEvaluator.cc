@@ -0,0 +1,255 @@
+// -*- LSST-C++ -*-
+
+/*
+ * This file is part of meas_astrom.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <string>
+
+#include "boost/format.hpp"
+
+#include "ndarray/eigen.h"
+#include "lsst/geom/Angle.h"
+#include "lsst/afw/geom/wcsUtils.h"
+#include "lsst/meas/astrom/TanSipEvaluator.h"
+#include "lsst/meas/astrom/detail/polynomialUtils.h"
+
+namespace lsst {
+namespace meas {
+namespace astrom {
+
+namespace {
+
+void checkSizes(ndarray::Array<double const, 1, 0> const& a, ndarray::Array<double const, 1, 0> const& b,
+                ndarray::Array<double, 1, 0> const& c, ndarray::Array<double, 1, 0> const& d) {
+    std::size_t const n = a.getSize<0>();
+    if (b.getSize<0>() != n || c.getSize<0>() != n || d.getSize<0>() != n) {
+        throw LSST_EXCEPT(pex::exceptions::LengthError,
+                          (boost::format("Coordinate arrays must all have the same size: %d, %d, %d, %d") % n %
+                           b.getSize<0>() % c.getSize<0>() % d.getSize<0>())
+                                  .str());
+    }
+}
+
+PolynomialTransform makeSipPoly(daf::base::PropertySet const& metadata, std::string const& xName,
+                                std::string const& yName) {
+    Eigen::MatrixXd xCoeffs = afw::geom::getSipMatrixFromMetadata(metadata, xName);
+    Eigen::MatrixXd yCoeffs = afw::geom::getSipMatrixFromMetadata(metadata, yName);
+    // PolynomialTransform requires both matrices to have the same shape.
+    int const size = std::max(xCoeffs.rows(), yCoeffs.rows());
+    ndarray::Array<double, 2, 2> xArray = ndarray::allocate(size, size);
+    ndarray::Array<double, 2, 2> yArray = ndarray::allocate(size, size);
+    xArray.deep() = 0.0;
+    yArray.deep() = 0.0;
+    ndarray::asEigenMatrix(xArray).topLeftCorner(xCoeffs.rows(), xCoeffs.cols()) = xCoeffs;
+    ndarray::asEigenMatrix(yArray).topLeftCorner(yCoeffs.rows(), yCoeffs.cols()) = yCoeffs;
+    return PolynomialTransform(xArray, yArray);
+}
+
+PolynomialTransform makeZeroPoly() {
+    ndarray::Array<double, 2, 2> zeros = ndarray::allocate(1, 1);
+    zeros.deep() = 0.0;
+    return PolynomialTransform(zeros, zeros);
+}
+
+TanSipEvaluator makeEvaluator(afw::geom::SkyWcs const& wcs, bool exactInverse) {
+    // getFitsMetadata(true) throws if the WCS cannot be represented exactly
+    // as FITS, which rules out anything with extra AST mappings.
+    auto metadata = wcs.getFitsMetadata(true);
+    std::string const ctype1 = metadata->getAsString("CTYPE1");
+    std::string const ctype2 = metadata->getAsString("CTYPE2");
+    if (ctype1.compare(0, 8, "RA---TAN") != 0 || ctype2.compare(0, 8, "DEC--TAN") != 0) {
+        throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                          "WCS with CTYPE1=" + ctype1 + ", CTYPE2=" + ctype2 +
+                                  " is not an RA---TAN, DEC--TAN (optionally SIP) WCS");
+    }
+    geom::Point2D pixelOrigin(metadata->getAsDouble("CRPIX1") - 1, metadata->getAsDouble("CRPIX2") - 1);
+    geom::LinearTransform cdMatrix(afw::geom::getCdMatrixFromMetadata(*metadata));
+    bool const hasForward = afw::geom::hasSipMatrix(*metadata, "A");
+    bool const hasReverse = afw::geom::hasSipMatrix(*metadata, "AP");
+    return TanSipEvaluator(
+            SipForwardTransform(pixelOrigin, cdMatrix,
+                                hasForward ? makeSipPoly(*metadata, "A", "B") : makeZeroPoly()),
+            SipReverseTransform(pixelOrigin, cdMatrix,
+                                hasReverse ? makeSipPoly(*metadata, "AP", "BP") : makeZeroPoly()),
+            wcs.getSkyOrigin(), exactInverse || (hasForward && !hasReverse));
+}
+
+}  // namespace
+
+TanSipEvaluator::TanSipEvaluator(SipForwardTransform const& sipForward, SipReverseTransform const& sipReverse,
+                                 geom::SpherePoint const& skyOrigin, bool exactInverse)
+        : _sipForward(sipForward),
+          _sipReverse(sipReverse),
+          _skyOrigin(skyOrigin),
+          _sinDec0(std::sin(skyOrigin.getLatitude().asRadians())),
+          _cosDec0(std::cos(skyOrigin.getLatitude().asRadians())),
+          _exactInverse(exactInverse) {
+    if (!sipForward.getPixelOrigin().asEigen().isApprox(sipReverse.getPixelOrigin().asEigen())) {
+        std::ostringstream oss;
+        oss << "SIP forward and reverse transforms have inconsistent CRPIX: " << sipForward.getPixelOrigin()
+            << " != " << sipReverse.getPixelOrigin();
+        throw LSST_EXCEPT(pex::exceptions::InvalidParameterError, oss.str());
+    }
+    if (!sipForward.getCdMatrix().getMatrix().isApprox(sipReverse.getCdMatrix().getMatrix())) {
+        std::ostringstream oss;
+        oss << "SIP forward and reverse transforms have inconsistent CD matrix: " << sipForward.getCdMatrix()
+            << "\n!=\n"
+            << sipReverse.getCdMatrix();
+        throw LSST_EXCEPT(pex::exceptions::InvalidParameterError, oss.str());
+    }
+}
+
+TanSipEvaluator::TanSipEvaluator(SipForwardTransform const& sipForward, geom::SpherePoint const& skyOrigin)
+        : TanSipEvaluator(sipForward,
+                          SipReverseTransform(sipForward.getPixelOrigin(), sipForward.getCdMatrix(),
+                                              makeZeroPoly()),
+                          skyOrigin, true) {}
+
+TanSipEvaluator::TanSipEvaluator(afw::geom::SkyWcs const& wcs, bool exactInverse)
+        : TanSipEvaluator(makeEvaluator(wcs, exactInverse)) {}
+
+void TanSipEvaluator::pixelToSky(ndarray::Array<double const, 1, 0> const& x,
+                                 ndarray::Array<double const, 1, 0> const& y,
+                                 ndarray::Array<double, 1, 0> const& ra,
+                                 ndarray::Array<double, 1, 0> const& dec) const {
+    checkSizes(x, y, ra, dec);
+    Eigen::ArrayXd raOut, decOut;
+    _pixelToSky(ndarray::asEigenArray(x), ndarray::asEigenArray(y), raOut, decOut);
+    ndarray::asEigenArray(ra) = raOut;
+    ndarray::asEigenArray(dec) = decOut;
+}
+
+void TanSipEvaluator::skyToPixel(ndarray::Array<double const, 1, 0> const& ra,
+                                 ndarray::Array<double const, 1, 0> const& dec,
+                                 ndarray::Array<double, 1, 0> const& x,
+                                 ndarray::Array<double, 1, 0> const& y) const {
+    checkSizes(ra, dec, x, y);
+    Eigen::ArrayXd xOut, yOut;
+    _skyToPixel(ndarray::asEigenArray(ra), ndarray::asEigenArray(dec), xOut, yOut);
+    ndarray::asEigenArray(x) = xOut;
+    ndarray::asEigenArray(y) = yOut;
+}
+
+std::vector<geom::SpherePoint> TanSipEvaluator::pixelToSky(std::vector<geom::Point2D> const& pixels) const {
+    Eigen::ArrayXd x(pixels.size()), y(pixels.size()), ra, dec;
+    for (std::size_t i = 0; i < pixels.size(); ++i) {
+        x[i] = pixels[i].getX();
+        y[i] = pixels[i].getY();
+    }
+    _pixelToSky(x, y, ra, dec);
+    std::vector<geom::SpherePoint> result;
+    result.reserve(pixels.size());
+    for (std::size_t i = 0; i < pixels.size(); ++i) {
+        result.emplace_back(ra[i] * geom::radians, dec[i] * geom::radians);
+    }
+    return result;
+}
+
+std::vector<geom::Point2D> TanSipEvaluator::skyToPixel(std::vector<geom::SpherePoint> const& coords) const {
+    Eigen::ArrayXd ra(coords.size()), dec(coords.size()), x, y;
+    for (std::size_t i = 0; i < coords.size(); ++i) {
+        ra[i] = coords[i].getLongitude().asRadians();
+        dec[i] = coords[i].getLatitude().asRadians();
+    }
+    _skyToPixel(ra, dec, x, y);
+    std::vector<geom::Point2D> result;
+    result.reserve(coords.size());
+    for (std::size_t i = 0; i < coords.size(); ++i) {
+        result.emplace_back(x[i], y[i]);
+    }
+    return result;
+}
+
+geom::SpherePoint TanSipEvaluator::pixelToSky(geom::Point2D const& pixel) const {
+    return pixelToSky(std::vector<geom::Point2D>{pixel}).front();
+}
+
+geom::Point2D TanSipEvaluator::skyToPixel(geom::SpherePoint const& coord) const {
+    return skyToPixel(std::vector<geom::SpherePoint>{coord}).front();
+}
+
+void TanSipEvaluator::_pixelToSky(Eigen::ArrayXd const& x, Eigen::ArrayXd const& y, Eigen::ArrayXd& ra,
+                                  Eigen::ArrayXd& dec) const {
+    // Pixels to intermediate world coordinates: Z (duv + AB(duv)), in degrees.
+    Eigen::ArrayXd du = x - _sipForward.getPixelOrigin().getX();
+    Eigen::ArrayXd dv = y - _sipForward.getPixelOrigin().getY();
+    Eigen::ArrayXd pu, pv;
+    detail::evaluatePolynomials(ndarray::asEigenMatrix(_sipForward.getPoly().getXCoeffs()),
+                                ndarray::asEigenMatrix(_sipForward.getPoly().getYCoeffs()), du, dv, pu, pv);
+    du += pu;
+    dv += pv;
+    Eigen::Matrix2d const cd = _sipForward.getCdMatrix().getMatrix() * geom::degToRad(1.0);
+    Eigen::ArrayXd xi = cd(0, 0) * du + cd(0, 1) * dv;
+    Eigen::ArrayXd eta = cd(1, 0) * du + cd(1, 1) * dv;
+    // Inverse gnomonic projection about (ra0, dec0).
+    Eigen::ArrayXd denom = _cosDec0 - eta * _sinDec0;
+    double const ra0 = _skyOrigin.getLongitude().asRadians();
+    ra = xi.binaryExpr(denom, [ra0](double a, double b) {
+        double r = std::fmod(ra0 + std::atan2(a, b), 2 * geom::PI);
+        return r < 0.0 ? r + 2 * geom::PI : r;
+    });
+    dec = (eta * _cosDec0 + _sinDec0)
+                  .binaryExpr((xi.square() + denom.square()).sqrt(),
+                              [](double a, double b) { return std::atan2(a, b); });
+}
+
+void TanSipEvaluator::_skyToPixel(Eigen::ArrayXd const& ra, Eigen::ArrayXd const& dec, Eigen::ArrayXd& x,
+                                  Eigen::ArrayXd& y) const {
+    // Gnomonic projection about (ra0, dec0), then radians to degrees.
+    Eigen::ArrayXd dra = ra - _skyOrigin.getLongitude().asRadians();
+    Eigen::ArrayXd cosDec = dec.cos();
+    Eigen::ArrayXd sinDec = dec.sin();
+    Eigen::ArrayXd cosDra = dra.cos();
+    Eigen::ArrayXd cosC = _sinDec0 * sinDec + _cosDec0 * cosDec * cosDra;
+    Eigen::ArrayXd scale = (cosC > 0.0).select(geom::radToDeg(1.0) / cosC, std::nan(""));
+    Eigen::ArrayXd xi = cosDec * dra.sin() * scale;
+    Eigen::ArrayXd eta = (_cosDec0 * sinDec - _sinDec0 * cosDec * cosDra) * scale;
+    if (_exactInverse) {
+        std::size_t const n = ra.size();
+        ndarray::Array<double, 1, 1> xiArray = ndarray::allocate(n);
+        ndarray::Array<double, 1, 1> etaArray = ndarray::allocate(n);
+        ndarray::Array<double, 2, 2> out = ndarray::allocate(n, 2);
+        ndarray::asEigenArray(xiArray) = xi;
+        ndarray::asEigenArray(etaArray) = eta;
+        _sipForward.applyInverse(xiArray, etaArray, out, _sipReverse);
+        x = ndarray::asEigenArray(out[ndarray::view()(0)]);
+        y = ndarray::asEigenArray(out[ndarray::view()(1)]);
+        return;
+    }
+    // Intermediate world coordinates to pixels: crpix + UV + ABP(UV), with UV = Z^{-1} (xi, eta).
+    Eigen::Matrix2d const cdInverse = _sipReverse.getCdMatrix().getMatrix().inverse();
+    Eigen::ArrayXd uu = cdInverse(0, 0) * xi + cdInverse(0, 1) * eta;
+    Eigen::ArrayXd vv = cdInverse(1, 0) * xi + cdInverse(1, 1) * eta;
+    Eigen::ArrayXd pu, pv;
+    detail::evaluatePolynomials(ndarray::asEigenMatrix(_sipReverse.getPoly().getXCoeffs()),
+                                ndarray::asEigenMatrix(_sipReverse.getPoly().getYCoeffs()), uu, vv, pu, pv);
+    x = uu + pu + _sipReverse.getPixelOrigin().getX();
+    y = vv + pv + _sipReverse.getPixelOrigin().getY();
+}
+
+}  // namespace astrom
+}  // namespace meas
+}  // namespace lsst
@@ -0,0 +1,201 @@
+// -*- LSST-C++ -*-
+
+/*
+ * This file is part of meas_astrom.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include "boost/format.hpp"
+
+#include "lsst/pex/exceptions.h"
+#include "lsst/meas/astrom/detail/binaryIo.h"
+
+namespace lsst {
+namespace meas {
+namespace astrom {
+namespace detail {
+
+namespace {
+
+char const MAGIC[4] = {'M', 'A', 'T', 'R'};
+
+// Largest polynomial order accepted when reading, to catch corrupt input
+// before trying to allocate enormous arrays.
+constexpr std::int32_t MAX_ORDER = 1000;
+
+void encode(std::uint64_t bits, int nBytes, char* out) {
+    for (int i = 0; i < nBytes; ++i) {
+        out[i] = static_cast<char>((bits >> (8 * i)) & 0xFF);
+    }
+}
+
+std::uint64_t decode(char const* in, int nBytes) {
+    std::uint64_t bits = 0;
+    for (int i = 0; i < nBytes; ++i) {
+        bits |= static_cast<std::uint64_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+    }
+    return bits;
+}
+
+}  // namespace
+
+void BinaryWriter::writeHeader(BinaryTypeTag tag) {
+    char header[6];
+    std::memcpy(header, MAGIC, 4);
+    header[4] = static_cast<char>(VERSION);
+    header[5] = static_cast<char>(tag);
+    _os.write(header, 6);
+}
+
+void BinaryWriter::writeInt32(std::int32_t value) {
+    char buffer[4];
+    encode(static_cast<std::uint32_t>(value), 4, buffer);
+    _os.write(buffer, 4);
+}
+
+void BinaryWriter::writeDouble(double value) { writeDoubles(&value, 1); }
+
+void BinaryWriter::writeDoubles(double const* values, std::size_t n) {
+    std::vector<char> buffer(8 * n);
+    for (std::size_t i = 0; i < n; ++i) {
+        std::uint64_t bits;
+        std::memcpy(&bits, values + i, 8);
+        encode(bits, 8, buffer.data() + 8 * i);
+    }
+    _os.write(buffer.data(), buffer.size());
+}
+
+void BinaryWriter::writePolynomial(ndarray::Array<double const, 2, 2> const& xCoeffs,
+                                   ndarray::Array<double const, 2, 2> const& yCoeffs) {
+    writeInt32(xCoeffs.getSize<0>() - 1);
+    writeDoubles(xCoeffs.getData(), xCoeffs.getNumElements());
+    writeDoubles(yCoeffs.getData(), yCoeffs.getNumElements());
+}
+
+void BinaryWriter::writePoint(geom::Point2D const& point) {
+    writeDouble(point.getX());
+    writeDouble(point.getY());
+}
+
+void BinaryWriter::writeLinear(geom::LinearTransform const& linear) {
+    auto const& m = linear.getMatrix();
+    double values[4] = {m(0, 0), m(0, 1), m(1, 0), m(1, 1)};
+    writeDoubles(values, 4);
+}
+
+void BinaryWriter::writeAffine(geom::AffineTransform const& affine) {
+    writeLinear(affine.getLinear());
+    writeDouble(affine.getTranslation().getX());
+    writeDouble(affine.getTranslation().getY());
+}
+
+void BinaryReader::readBytes(char* buffer, std::size_t n) {
+    _is.read(buffer, n);
+    if (static_cast<std::size_t>(_is.gcount()) != n) {
+        throw LSST_EXCEPT(pex::exceptions::IoError, "Unexpected end of binary transform data.");
+    }
+}
+
+void BinaryReader::readHeader(BinaryTypeTag expected) {
+    char header[6];
+    readBytes(header, 6);
+    if (std::memcmp(header, MAGIC, 4) != 0) {
+        throw LSST_EXCEPT(pex::exceptions::IoError, "Data is not a binary transform.");
+    }
+    int const version = static_cast<unsigned char>(header[4]);
+    if (version < 1 || version > BinaryWriter::VERSION) {
+        throw LSST_EXCEPT(pex::exceptions::IoError,
+                          (boost::format("Unsupported binary transform format version %d (expected <= %d).") %
+                           version % static_cast<int>(BinaryWriter::VERSION))
+                                  .str());
+    }
+    int const tag = static_cast<unsigned char>(header[5]);
+    if (tag != static_cast<int>(expected)) {
+        throw LSST_EXCEPT(pex::exceptions::IoError,
+                          (boost::format("Binary transform has type tag %d, not %d.") % tag %
+                           static_cast<int>(expected))
+                                  .str());
+    }
+}
+
+std::int32_t BinaryReader::readInt32() {
+    char buffer[4];
+    readBytes(buffer, 4);
+    return static_cast<std::int32_t>(static_cast<std::uint32_t>(decode(buffer, 4)));
+}
+
+double BinaryReader::readDouble() {
+    double value;
+    readDoubles(&value, 1);
+    return value;
+}
+
+void BinaryReader::readDoubles(double* values, std::size_t n) {
+    std::vector<char> buffer(8 * n);
+    readBytes(buffer.data(), buffer.size());
+    for (std::size_t i = 0; i < n; ++i) {
+        std::uint64_t bits = decode(buffer.data() + 8 * i, 8);
+        std::memcpy(values + i, &bits, 8);
+    }
+}
+
+void BinaryReader::readPolynomial(ndarray::Array<double, 2, 2>& xCoeffs,
+                                  ndarray::Array<double, 2, 2>& yCoeffs) {
+    std::int32_t const order = readInt32();
+    if (order < 0 || order > MAX_ORDER) {
+        throw LSST_EXCEPT(pex::exceptions::IoError,
+                          (boost::format("Invalid polynomial order %d in binary transform.") % order).str());
+    }
+    xCoeffs = ndarray::allocate(order + 1, order + 1);
+    yCoeffs = ndarray::allocate(order + 1, order + 1);
+    readDoubles(xCoeffs.getData(), xCoeffs.getNumElements());
+    readDoubles(yCoeffs.getData(), yCoeffs.getNumElements());
+}
+
+geom::Point2D BinaryReader::readPoint() {
+    double values[2];
+    readDoubles(values, 2);
+    return geom::Point2D(values[0], values[1]);
+}
+
+geom::LinearTransform BinaryReader::readLinear() {
+    double values[4];
+    readDoubles(values, 4);
+    Eigen::Matrix2d m;
+    m << values[0], values[1], values[2], values[3];
+    return geom::LinearTransform(m);
+}
+
+geom::AffineTransform BinaryReader::readAffine() {
+    geom::LinearTransform linear = readLinear();
+    geom::Point2D translation = readPoint();
+    return geom::AffineTransform(linear, geom::Extent2D(translation));
+}
+
+}  // namespace detail
+}  // namespace astrom
+}  // namespace meas
+}  // namespace lsst
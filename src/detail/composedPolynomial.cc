@@ -0,0 +1,78 @@
+// -*- LSST-C++ -*-
+
+/*
+ * This file is part of meas_astrom.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "Eigen/Core"
+#include "lsst/meas/astrom/detail/composedPolynomial.h"
+#include "lsst/meas/astrom/detail/polynomialUtils.h"
+
+namespace lsst {
+namespace meas {
+namespace astrom {
+namespace detail {
+
+void ComposedPolynomial::apply(ndarray::Array<double const, 1, 0> const& x,
+                               ndarray::Array<double const, 1, 0> const& y,
+                               ndarray::Array<double, 2, 2> const& out) const {
+    typedef geom::AffineTransform AT;
+    std::size_t const n = checkBatchShapes(x, y, out);
+    Eigen::ArrayXd u(n), v(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        u[i] = _inner[AT::XX] * x[i] + _inner[AT::XY] * y[i] + _inner[AT::X];
+        v[i] = _inner[AT::YX] * x[i] + _inner[AT::YY] * y[i] + _inner[AT::Y];
+    }
+    Eigen::ArrayXd px, py;
+    evaluatePolynomials(ndarray::asEigenMatrix(_poly->getXCoeffs()),
+                        ndarray::asEigenMatrix(_poly->getYCoeffs()), u, v, px, py);
+    if (_addIdentity) {
+        px += u;
+        py += v;
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+        out[i][0] = _outer[AT::XX] * px[i] + _outer[AT::XY] * py[i] + _outer[AT::X];
+        out[i][1] = _outer[AT::YX] * px[i] + _outer[AT::YY] * py[i] + _outer[AT::Y];
+    }
+}
+
+PolynomialTransform ComposedPolynomial::materialize() const {
+    typedef geom::AffineTransform AT;
+    PolynomialTransform result = compose(_outer, compose(*_poly, _inner));
+    if (_addIdentity) {
+        // O(k I(x)) is itself affine, with the linear part of O applied to I;
+        // the composition above always has order >= 1, so it has room for it.
+        AT const extra = AT(_outer.getLinear()) * _inner;
+        result._xCoeffs(0, 0) += extra[AT::X];
+        result._yCoeffs(0, 0) += extra[AT::Y];
+        result._xCoeffs(1, 0) += extra[AT::XX];
+        result._xCoeffs(0, 1) += extra[AT::XY];
+        result._yCoeffs(1, 0) += extra[AT::YX];
+        result._yCoeffs(0, 1) += extra[AT::YY];
+    }
+    return result;
+}
+
+}  // namespace detail
+}  // namespace astrom
+}  // namespace meas
+}  // namespace lsst
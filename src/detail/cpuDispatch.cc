@@ -0,0 +1,103 @@
+// -*- LSST-C++ -*-
+
+/*
+ * This file is part of meas_astrom.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+#include "lsst/log/Log.h"
+#include "lsst/meas/astrom/detail/cpuDispatch.h"
+
+namespace {
+LOG_LOGGER _log = LOG_GET("lsst.meas.astrom");
+}
+
+namespace lsst {
+namespace meas {
+namespace astrom {
+namespace detail {
+
+SimdLevel detectSimdLevel() {
+#if LSST_MEAS_ASTROM_X86_DISPATCH
+    // __builtin_cpu_supports also checks that the OS saves the wider
+    // registers, not just that the CPU has the instructions.
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2") &&
+        __builtin_cpu_supports("fma")) {
+        return SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return SimdLevel::AVX2;
+    }
+#endif
+    return SimdLevel::SCALAR;
+}
+
+SimdLevel applySimdOverride(SimdLevel detected, char const* requested) {
+    if (requested == nullptr) {
+        return detected;
+    }
+    std::string const value(requested);
+    if (value == "scalar") {
+        return SimdLevel::SCALAR;
+    } else if (value == "avx2") {
+        return std::min(detected, SimdLevel::AVX2);
+    } else if (value != "avx512" && !value.empty()) {
+        LOGL_WARN(_log, "Ignoring unrecognized MEAS_ASTROM_SIMD value '%s'.", value.c_str());
+    }
+    return detected;
+}
+
+namespace {
+
+SimdLevel computeSimdLevel() {
+    SimdLevel const level = applySimdOverride(detectSimdLevel(), std::getenv("MEAS_ASTROM_SIMD"));
+    LOGL_DEBUG(_log, "Using %s numeric kernels.", getSimdLevelName(level));
+    return level;
+}
+
+}  // namespace
+
+SimdLevel getSimdLevel() {
+    static SimdLevel const level = computeSimdLevel();
+    return level;
+}
+
+char const* getSimdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX512:
+            return "avx512";
+        case SimdLevel::AVX2:
+            return "avx2";
+        case SimdLevel::SCALAR:
+            break;
+    }
+    return "scalar";
+}
+
+}  // namespace detail
+}  // namespace astrom
+}  // namespace meas
+}  // namespace lsst
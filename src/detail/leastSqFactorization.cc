@@ -0,0 +1,127 @@
+// -*- LSST-C++ -*-
+
+/*
+ * This file is part of meas_astrom.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "Eigen/Eigenvalues"
+
+#include "lsst/log/Log.h"
+#include "lsst/pex/exceptions/Runtime.h"
+#include "lsst/meas/astrom/detail/leastSqFactorization.h"
+
+namespace lsst {
+namespace meas {
+namespace astrom {
+namespace detail {
+namespace {
+
+LOG_LOGGER _log = LOG_GET("lsst.meas.astrom.sip");
+
+// Largest condition number of the normal matrix A^T A for which
+// LeastSqSolver::AUTO solves the normal equations directly; this loses at
+// most half of the available precision.
+double const MAX_NORMAL_CONDITION = 1E8;
+
+}  // namespace
+
+LeastSqFactorization::LeastSqFactorization(Eigen::MatrixXd const& design, sip::LeastSqSolver solver)
+        : _solver(solver) {
+    typedef sip::LeastSqSolver Solver;
+    if (solver == Solver::AUTO || solver == Solver::NORMAL_LDLT) {
+        Eigen::MatrixXd normal = Eigen::MatrixXd::Zero(design.cols(), design.cols());
+        normal.selfadjointView<Eigen::Lower>().rankUpdate(design.adjoint());
+        if (solver == Solver::AUTO) {
+            Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eig(normal, Eigen::EigenvaluesOnly);
+            // Eigenvalues are sorted in increasing order.
+            double const minEig = eig.eigenvalues()[0];
+            double const maxEig = eig.eigenvalues()[design.cols() - 1];
+            if (minEig * MAX_NORMAL_CONDITION > maxEig) {
+                solver = Solver::NORMAL_LDLT;
+            } else {
+                LOGL_DEBUG(_log, "LeastSqFactorization: normal matrix eigenvalues %g, %g; using QR", minEig,
+                           maxEig);
+            }
+        }
+        if (solver == Solver::NORMAL_LDLT) {
+            _factorization = NormalEquations{normal.selfadjointView<Eigen::Lower>().ldlt(), design};
+            return;
+        }
+        // Only an ill-conditioned AUTO gets here; use QR, or SVD if the
+        // matrix turns out to be rank-deficient.
+        Eigen::ColPivHouseholderQR<Eigen::MatrixXd> qr(design);
+        if (qr.rank() == design.cols()) {
+            _factorization = std::move(qr);
+            return;
+        }
+        LOGL_DEBUG(_log, "LeastSqFactorization: design matrix has rank %d < %d; using SVD",
+                   static_cast<int>(qr.rank()), static_cast<int>(design.cols()));
+    } else if (solver == Solver::COL_PIV_QR) {
+        _factorization = Eigen::ColPivHouseholderQR<Eigen::MatrixXd>(design);
+        return;
+    }
+    _factorization = Eigen::JacobiSVD<Eigen::MatrixXd>(design, Eigen::ComputeThinU | Eigen::ComputeThinV);
+}
+
+Eigen::MatrixXd LeastSqFactorization::solve(Eigen::MatrixXd const& rhs) const {
+    if (auto const* qr = std::get_if<Eigen::ColPivHouseholderQR<Eigen::MatrixXd>>(&_factorization)) {
+        return qr->solve(rhs);
+    }
+    if (auto const* normal = std::get_if<NormalEquations>(&_factorization)) {
+        return normal->ldlt.solve(normal->design.adjoint() * rhs);
+    }
+    if (auto const* svd = std::get_if<Eigen::JacobiSVD<Eigen::MatrixXd>>(&_factorization)) {
+        return svd->solve(rhs);
+    }
+    throw LSST_EXCEPT(pex::exceptions::LogicError, "LeastSqFactorization is empty");
+}
+
+Eigen::VectorXd LeastSqFactorization::computeVariance() const {
+    if (auto const* qr = std::get_if<Eigen::ColPivHouseholderQR<Eigen::MatrixXd>>(&_factorization)) {
+        // A P = Q R, so (A^T A)^{-1} = P (R^T R)^{-1} P^T
+        Eigen::Index const n = qr->cols();
+        Eigen::MatrixXd const rInverse =
+                qr->matrixR().topLeftCorner(n, n).triangularView<Eigen::Upper>().solve(
+                        Eigen::MatrixXd::Identity(n, n));
+        Eigen::VectorXd const permuted = rInverse.rowwise().squaredNorm();
+        Eigen::VectorXd variance(n);
+        for (Eigen::Index i = 0; i < n; ++i) {
+            variance[qr->colsPermutation().indices()[i]] = permuted[i];
+        }
+        return variance;
+    }
+    if (auto const* normal = std::get_if<NormalEquations>(&_factorization)) {
+        Eigen::Index const n = normal->design.cols();
+        return normal->ldlt.solve(Eigen::MatrixXd::Identity(n, n)).diagonal();
+    }
+    if (auto const* svd = std::get_if<Eigen::JacobiSVD<Eigen::MatrixXd>>(&_factorization)) {
+        // A = U S V^T, so (A^T A)^{-1} = V S^-2 V^T
+        return (svd->matrixV().array().square().matrix() *
+                svd->singularValues().array().inverse().square().matrix());
+    }
+    throw LSST_EXCEPT(pex::exceptions::LogicError, "LeastSqFactorization is empty");
+}
+
+}  // namespace detail
+}  // namespace astrom
+}  // namespace meas
+}  // namespace lsst
@@ -22,8 +22,13 @@
  * see <http://www.lsstcorp.org/LegalNotices/>.
  */
 
-#include <mutex>
+#include <algorithm>
+
+#include "boost/format.hpp"
+
+#include "lsst/pex/exceptions.h"
 #include "lsst/meas/astrom/detail/polynomialUtils.h"
+#include "lsst/meas/astrom/detail/cpuDispatch.h"
 
 namespace lsst {
 namespace meas {
@@ -43,27 +48,206 @@ Eigen::VectorXd computePowers(double x, int n) {
     return r;
 }
 
-void BinomialMatrix::extend(int const n) {
-    static std::mutex mutex;
-    auto& old = getMatrix();
-    int const m = old.rows() - 1;
-    if (n <= m) return;
-    Eigen::MatrixXd updated = Eigen::MatrixXd::Zero(n + 1, n + 1);
-    updated.topLeftCorner(old.rows(), old.cols()) = old;
-    for (int i = m + 1; i <= n; ++i) {
-        updated(i, 0) = 1.0;
-        updated(i, i) = 1.0;
-        for (int j = 1; j < i; ++j) {
-            updated(i, j) = updated(i - 1, j - 1) * (static_cast<double>(i) / static_cast<double>(j));
+void computeChebyshev(Eigen::VectorXd& r, double x) {
+    r[0] = 1.0;
+    if (r.size() > 1) {
+        r[1] = x;
+    }
+    for (int i = 2; i < r.size(); ++i) {
+        r[i] = 2.0 * x * r[i - 1] - r[i - 2];
+    }
+}
+
+void computeChebyshev(Eigen::VectorXd& r, Eigen::VectorXd& dr, double x) {
+    computeChebyshev(r, x);
+    dr[0] = 0.0;
+    if (dr.size() > 1) {
+        dr[1] = 1.0;
+    }
+    // Differentiate the recurrence: T'_n = 2 T_{n-1} + 2x T'_{n-1} - T'_{n-2}
+    for (int i = 2; i < dr.size(); ++i) {
+        dr[i] = 2.0 * r[i - 1] + 2.0 * x * dr[i - 1] - dr[i - 2];
+    }
+}
+
+Eigen::MatrixXd makeChebyshevToMonomial(int order) {
+    Eigen::MatrixXd m = Eigen::MatrixXd::Zero(order + 1, order + 1);
+    m(0, 0) = 1.0;
+    if (order > 0) {
+        m(1, 1) = 1.0;
+    }
+    for (int n = 2; n <= order; ++n) {
+        m(n, 0) = -m(n - 2, 0);
+        for (int k = 1; k <= n; ++k) {
+            m(n, k) = 2.0 * m(n - 1, k - 1) - m(n - 2, k);
+        }
+    }
+    return m;
+}
+
+namespace {
+
+// Kernel for evaluatePolynomials.  Coefficients are row-major (order+1)x(order+1)
+// matrices; vPowers must have room for (order+1)*n values and sx, sy for n.
+// The loops over points are innermost so they can be vectorized.
+LSST_MEAS_ASTROM_ALWAYS_INLINE void evaluatePolynomialsImpl(double const* __restrict xCoeffs,
+                                                            double const* __restrict yCoeffs, int order,
+                                                            double const* __restrict u,
+                                                            double const* __restrict v, std::size_t n,
+                                                            double* __restrict vPowers,
+                                                            double* __restrict sx, double* __restrict sy,
+                                                            double* __restrict x, double* __restrict y) {
+    // Rows are powers of v: vPowers[q*n + i] == v[i]^q.
+    for (std::size_t i = 0; i < n; ++i) {
+        vPowers[i] = 1.0;
+    }
+    for (int q = 1; q <= order; ++q) {
+        double const* __restrict prev = vPowers + (q - 1) * n;
+        double* __restrict next = vPowers + q * n;
+        for (std::size_t i = 0; i < n; ++i) {
+            next[i] = prev[i] * v[i];
         }
     }
-    std::unique_lock<std::mutex> lock(mutex);
-    old.swap(updated);
+    // Horner's scheme in u, with the inner sums over powers of v:
+    // x = sum_p u^p (sum_q A(p,q) v^q).
+    for (std::size_t i = 0; i < n; ++i) {
+        x[i] = 0.0;
+        y[i] = 0.0;
+    }
+    for (int p = order; p >= 0; --p) {
+        double const* xRow = xCoeffs + p * (order + 1);
+        double const* yRow = yCoeffs + p * (order + 1);
+        for (std::size_t i = 0; i < n; ++i) {
+            sx[i] = xRow[0];
+            sy[i] = yRow[0];
+        }
+        for (int q = 1; q <= order; ++q) {
+            double const a = xRow[q];
+            double const b = yRow[q];
+            double const* __restrict vq = vPowers + q * n;
+            for (std::size_t i = 0; i < n; ++i) {
+                sx[i] += a * vq[i];
+                sy[i] += b * vq[i];
+            }
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            x[i] = x[i] * u[i] + sx[i];
+            y[i] = y[i] * u[i] + sy[i];
+        }
+    }
+}
+
+void evaluatePolynomialsScalar(double const* xCoeffs, double const* yCoeffs, int order, double const* u,
+                               double const* v, std::size_t n, double* vPowers, double* sx, double* sy,
+                               double* x, double* y) {
+    evaluatePolynomialsImpl(xCoeffs, yCoeffs, order, u, v, n, vPowers, sx, sy, x, y);
+}
+
+#if LSST_MEAS_ASTROM_X86_DISPATCH
+LSST_MEAS_ASTROM_TARGET_AVX2 void evaluatePolynomialsAvx2(double const* xCoeffs, double const* yCoeffs,
+                                                          int order, double const* u, double const* v,
+                                                          std::size_t n, double* vPowers, double* sx,
+                                                          double* sy, double* x, double* y) {
+    evaluatePolynomialsImpl(xCoeffs, yCoeffs, order, u, v, n, vPowers, sx, sy, x, y);
+}
+
+LSST_MEAS_ASTROM_TARGET_AVX512 void evaluatePolynomialsAvx512(double const* xCoeffs, double const* yCoeffs,
+                                                              int order, double const* u, double const* v,
+                                                              std::size_t n, double* vPowers, double* sx,
+                                                              double* sy, double* x, double* y) {
+    evaluatePolynomialsImpl(xCoeffs, yCoeffs, order, u, v, n, vPowers, sx, sy, x, y);
+}
+#endif
+
+using EvaluatePolynomialsKernel = decltype(&evaluatePolynomialsScalar);
+
+EvaluatePolynomialsKernel selectEvaluatePolynomials(SimdLevel level) {
+#if LSST_MEAS_ASTROM_X86_DISPATCH
+    switch (level) {
+        case SimdLevel::AVX512:
+            return &evaluatePolynomialsAvx512;
+        case SimdLevel::AVX2:
+            return &evaluatePolynomialsAvx2;
+        case SimdLevel::SCALAR:
+            break;
+    }
+#endif
+    return &evaluatePolynomialsScalar;
+}
+
+void runEvaluatePolynomials(EvaluatePolynomialsKernel kernel,
+                            Eigen::Ref<Eigen::MatrixXd const> const& xCoeffs,
+                            Eigen::Ref<Eigen::MatrixXd const> const& yCoeffs, Eigen::ArrayXd const& u,
+                            Eigen::ArrayXd const& v, Eigen::ArrayXd& x, Eigen::ArrayXd& y) {
+    int const order = xCoeffs.rows() - 1;
+    Eigen::Index const n = u.size();
+    // The kernel wants contiguous row-major coefficients.
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> a = xCoeffs;
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> b = yCoeffs;
+    Eigen::ArrayXd vPowers((order + 1) * n);
+    Eigen::ArrayXd sx(n), sy(n);
+    x.resize(n);
+    y.resize(n);
+    kernel(a.data(), b.data(), order, u.data(), v.data(), n, vPowers.data(), sx.data(), sy.data(), x.data(),
+           y.data());
+}
+
+}  // namespace
+
+void evaluatePolynomials(Eigen::Ref<Eigen::MatrixXd const> const& xCoeffs,
+                         Eigen::Ref<Eigen::MatrixXd const> const& yCoeffs, Eigen::ArrayXd const& u,
+                         Eigen::ArrayXd const& v, Eigen::ArrayXd& x, Eigen::ArrayXd& y) {
+    static EvaluatePolynomialsKernel const kernel = selectEvaluatePolynomials(getSimdLevel());
+    runEvaluatePolynomials(kernel, xCoeffs, yCoeffs, u, v, x, y);
+}
+
+void evaluatePolynomials(Eigen::Ref<Eigen::MatrixXd const> const& xCoeffs,
+                         Eigen::Ref<Eigen::MatrixXd const> const& yCoeffs, Eigen::ArrayXd const& u,
+                         Eigen::ArrayXd const& v, Eigen::ArrayXd& x, Eigen::ArrayXd& y, SimdLevel level) {
+    runEvaluatePolynomials(selectEvaluatePolynomials(std::min(level, detectSimdLevel())), xCoeffs, yCoeffs,
+                           u, v, x, y);
+}
+
+std::size_t checkBatchShapes(ndarray::Array<double const, 1, 0> const& x,
+                             ndarray::Array<double const, 1, 0> const& y,
+                             ndarray::Array<double, 2, 2> const& out) {
+    std::size_t const n = x.getSize<0>();
+    if (y.getSize<0>() != n) {
+        throw LSST_EXCEPT(pex::exceptions::LengthError,
+                          (boost::format("X and Y coordinate arrays must have the same size: %d != %d") % n %
+                           y.getSize<0>())
+                                  .str());
+    }
+    if (out.getSize<0>() != n || out.getSize<1>() != 2) {
+        throw LSST_EXCEPT(pex::exceptions::LengthError,
+                          (boost::format("Output array has shape (%d,%d); expected (%d,2)") %
+                           out.getSize<0>() % out.getSize<1>() % n)
+                                  .str());
+    }
+    return n;
+}
+
+std::size_t checkBatchShapes(ndarray::Array<double const, 1, 0> const& x,
+                             ndarray::Array<double const, 1, 0> const& y,
+                             ndarray::Array<double, 2, 2> const& out,
+                             ndarray::Array<double, 3, 3> const& jacobian) {
+    std::size_t const n = checkBatchShapes(x, y, out);
+    if (jacobian.getSize<0>() != n || jacobian.getSize<1>() != 2 || jacobian.getSize<2>() != 2) {
+        throw LSST_EXCEPT(pex::exceptions::LengthError,
+                          (boost::format("Jacobian array has shape (%d,%d,%d); expected (%d,2,2)") %
+                           jacobian.getSize<0>() % jacobian.getSize<1>() % jacobian.getSize<2>() % n)
+                                  .str());
+    }
+    return n;
 }
 
-Eigen::MatrixXd& BinomialMatrix::getMatrix() {
-    static Eigen::MatrixXd it = Eigen::MatrixXd::Constant(2, 2, 1.0);
-    return it;
+BinomialMatrix::BinomialMatrix(int const nMax) {
+    if (nMax > MAX_N) {
+        throw LSST_EXCEPT(pex::exceptions::LengthError,
+                          (boost::format("Binomial coefficients are only available for n <= %d, not %d") %
+                           MAX_N % nMax)
+                                  .str());
+    }
 }
 
 }  // namespace detail
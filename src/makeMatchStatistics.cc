@@ -22,12 +22,148 @@
  * see <http://www.lsstcorp.org/LegalNotices/>.
  */
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <vector>
+
 #include "lsst/pex/exceptions/Runtime.h"
 #include "lsst/meas/astrom/makeMatchStatistics.h"
+#include "lsst/meas/astrom/detail/matchStatistics.h"
 
 namespace lsst {
 namespace meas {
 namespace astrom {
+namespace {
+
+/**
+ * Return the values at the given quantiles, interpolating linearly as afw::math::makeStatistics does for
+ * the median
+ *
+ * The quantiles are selected in increasing order with std::nth_element, so that each selection only
+ * partitions the values above the previous quantile. values must be finite, and is reordered.
+ */
+std::vector<double> computeQuantiles(std::vector<double>& values, std::vector<double> const& fractions) {
+    std::vector<double> result(fractions.size(), std::numeric_limits<double>::quiet_NaN());
+    if (values.empty()) {
+        return result;
+    }
+    std::vector<std::size_t> order(fractions.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(),
+              [&fractions](std::size_t a, std::size_t b) { return fractions[a] < fractions[b]; });
+
+    auto start = values.begin();
+    for (std::size_t const k : order) {
+        double const index = fractions[k] * (values.size() - 1);
+        auto const lower = values.begin() + static_cast<std::ptrdiff_t>(index);
+        std::nth_element(start, lower, values.end());
+        double value = *lower;
+        double const weight = index - std::floor(index);
+        if (weight > 0) {
+            value += weight * (*std::min_element(lower + 1, values.end()) - value);
+        }
+        result[k] = value;
+        start = lower;
+    }
+    return result;
+}
+
+/// Check that refCoords and srcPositions describe the same, nonzero number of matches
+void checkPositions(std::vector<geom::SpherePoint> const& refCoords,
+                    std::vector<geom::Point2D> const& srcPositions) {
+    if (refCoords.size() != srcPositions.size()) {
+        throw LSST_EXCEPT(pexExcept::LengthError, "refCoords has " + std::to_string(refCoords.size()) +
+                                                          " elements but srcPositions has " +
+                                                          std::to_string(srcPositions.size()));
+    }
+    if (refCoords.empty()) {
+        throw LSST_EXCEPT(pexExcept::RuntimeError, "no positions");
+    }
+}
+
+/// Split a match list into reference coordinates and source centroids
+template <typename MatchT>
+void splitMatches(std::vector<MatchT> const& matchList, std::vector<geom::SpherePoint>& refCoords,
+                  std::vector<geom::Point2D>& srcPositions) {
+    refCoords.reserve(matchList.size());
+    srcPositions.reserve(matchList.size());
+    for (auto const& match : matchList) {
+        refCoords.push_back(match.first->getCoord());
+        srcPositions.push_back(match.second->getCentroid());
+    }
+}
+
+/// Return the radial separation, in pixels, between each reference position projected with wcs
+/// and the corresponding source centroid; all the positions are transformed with a single WCS call
+std::vector<double> computePixelSeparations(afw::geom::SkyWcs const& wcs,
+                                            std::vector<geom::SpherePoint> const& refCoords,
+                                            std::vector<geom::Point2D> const& srcPositions) {
+    auto const refPositions = wcs.skyToPixel(refCoords);
+    std::vector<double> result;
+    result.reserve(refPositions.size());
+    for (std::size_t i = 0; i < refPositions.size(); ++i) {
+        result.push_back(std::hypot(srcPositions[i].getX() - refPositions[i].getX(),
+                                    srcPositions[i].getY() - refPositions[i].getY()));
+    }
+    return result;
+}
+
+/// Return the on-sky separation, in radians, between each source centroid projected with wcs
+/// and the corresponding reference position; all the positions are transformed with a single WCS call
+std::vector<double> computeSkySeparations(afw::geom::SkyWcs const& wcs,
+                                          std::vector<geom::SpherePoint> const& refCoords,
+                                          std::vector<geom::Point2D> const& srcPositions) {
+    auto const srcCoords = wcs.pixelToSky(srcPositions);
+    std::vector<double> result;
+    result.reserve(srcCoords.size());
+    for (std::size_t i = 0; i < srcCoords.size(); ++i) {
+        result.push_back(refCoords[i].separation(srcCoords[i]).asRadians());
+    }
+    return result;
+}
+
+/// Compute the statistics of values, ignoring non-finite values
+SeparationStatistics makeSeparationStatistics(std::vector<double> values,
+                                              std::vector<double> const& quantiles,
+                                              afw::math::StatisticsControl const& sctrl) {
+    values.erase(std::remove_if(values.begin(), values.end(), [](double v) { return !std::isfinite(v); }),
+                 values.end());
+    int const flags = afw::math::MEDIAN | afw::math::MEANCLIP | afw::math::STDEVCLIP;
+    afw::math::Statistics const stats = afw::math::makeStatistics(values, flags, sctrl);
+    SeparationStatistics result;
+    result.median = stats.getValue(afw::math::MEDIAN);
+    result.meanClip = stats.getValue(afw::math::MEANCLIP);
+    result.stdevClip = stats.getValue(afw::math::STDEVCLIP);
+    result.quantiles = computeQuantiles(values, quantiles);
+    return result;
+}
+
+}  // namespace
+
+namespace detail {
+
+afw::math::Statistics makeMatchStatisticsInPixels(afw::geom::SkyWcs const& wcs,
+                                                  std::vector<geom::SpherePoint> const& refCoords,
+                                                  std::vector<geom::Point2D> const& srcPositions,
+                                                  int const flags,
+                                                  afw::math::StatisticsControl const& sctrl) {
+    checkPositions(refCoords, srcPositions);
+    return afw::math::makeStatistics(computePixelSeparations(wcs, refCoords, srcPositions), flags, sctrl);
+}
+
+afw::math::Statistics makeMatchStatisticsInRadians(afw::geom::SkyWcs const& wcs,
+                                                   std::vector<geom::SpherePoint> const& refCoords,
+                                                   std::vector<geom::Point2D> const& srcPositions,
+                                                   int const flags,
+                                                   afw::math::StatisticsControl const& sctrl) {
+    checkPositions(refCoords, srcPositions);
+    return afw::math::makeStatistics(computeSkySeparations(wcs, refCoords, srcPositions), flags, sctrl);
+}
+
+}  // namespace detail
 
 template <typename MatchT>
 afw::math::Statistics makeMatchStatistics(std::vector<MatchT> const& matchList, int const flags,
@@ -51,20 +187,10 @@ afw::math::Statistics makeMatchStatisticsInPixels(afw::geom::SkyWcs const& wcs,
     if (matchList.empty()) {
         throw LSST_EXCEPT(pexExcept::RuntimeError, "matchList is empty");
     }
-    std::vector<double> val;
-    val.reserve(matchList.size());
-
-    for (auto const& match : matchList) {
-        auto refPtr = match.first;
-        auto srcPtr = match.second;
-        auto srcX = srcPtr->getX();
-        auto srcY = srcPtr->getY();
-        auto refPos = wcs.skyToPixel(refPtr->getCoord());
-        auto refX = refPos[0];
-        auto refY = refPos[1];
-        val.push_back(::hypot(srcX - refX, srcY - refY));
-    }
-    return afw::math::makeStatistics(val, flags, sctrl);
+    std::vector<geom::SpherePoint> refCoords;
+    std::vector<geom::Point2D> srcPositions;
+    splitMatches(matchList, refCoords, srcPositions);
+    return detail::makeMatchStatisticsInPixels(wcs, refCoords, srcPositions, flags, sctrl);
 }
 
 template <typename MatchT>
@@ -74,18 +200,37 @@ afw::math::Statistics makeMatchStatisticsInRadians(afw::geom::SkyWcs const& wcs,
     if (matchList.empty()) {
         throw LSST_EXCEPT(pexExcept::RuntimeError, "matchList is empty");
     }
-    std::vector<double> val;
-    val.reserve(matchList.size());
+    std::vector<geom::SpherePoint> refCoords;
+    std::vector<geom::Point2D> srcPositions;
+    splitMatches(matchList, refCoords, srcPositions);
+    return detail::makeMatchStatisticsInRadians(wcs, refCoords, srcPositions, flags, sctrl);
+}
 
-    for (auto const& match : matchList) {
-        auto refPtr = match.first;
-        auto srcPtr = match.second;
-        auto refCoord = refPtr->getCoord();
-        auto srcCoord = wcs.pixelToSky(srcPtr->getCentroid());
-        auto angSep = refCoord.separation(srcCoord);
-        val.push_back(angSep.asRadians());
+template <typename MatchT>
+MatchSeparationStatistics makeMatchSeparationStatistics(afw::geom::SkyWcs const& wcs,
+                                                        std::vector<MatchT> const& matchList,
+                                                        std::vector<double> const& quantiles,
+                                                        afw::math::StatisticsControl const& sctrl) {
+    if (matchList.empty()) {
+        throw LSST_EXCEPT(pexExcept::RuntimeError, "matchList is empty");
     }
-    return afw::math::makeStatistics(val, flags, sctrl);
+    for (double const fraction : quantiles) {
+        if (!(fraction >= 0.0 && fraction <= 1.0)) {
+            throw LSST_EXCEPT(pexExcept::InvalidParameterError,
+                              "quantile " + std::to_string(fraction) + " is not in [0, 1]");
+        }
+    }
+
+    std::vector<geom::SpherePoint> refCoords;
+    std::vector<geom::Point2D> srcPositions;
+    splitMatches(matchList, refCoords, srcPositions);
+
+    MatchSeparationStatistics result;
+    result.pixels = makeSeparationStatistics(computePixelSeparations(wcs, refCoords, srcPositions),
+                                             quantiles, sctrl);
+    result.radians = makeSeparationStatistics(computeSkySeparations(wcs, refCoords, srcPositions),
+                                              quantiles, sctrl);
+    return result;
 }
 
 #define INSTANTIATE(MATCH)                                                                                \
@@ -97,7 +242,10 @@ afw::math::Statistics makeMatchStatisticsInRadians(afw::geom::SkyWcs const& wcs,
             afw::math::StatisticsControl const& sctrl);                                                   \
     template afw::math::Statistics makeMatchStatisticsInRadians<MATCH>(                                   \
             afw::geom::SkyWcs const& wcs, std::vector<MATCH> const& matchList, int const flags,           \
-            afw::math::StatisticsControl const& sctrl);
+            afw::math::StatisticsControl const& sctrl);                                                   \
+    template MatchSeparationStatistics makeMatchSeparationStatistics<MATCH>(                              \
+            afw::geom::SkyWcs const& wcs, std::vector<MATCH> const& matchList,                            \
+            std::vector<double> const& quantiles, afw::math::StatisticsControl const& sctrl);
 
 INSTANTIATE(afw::table::ReferenceMatch);
 INSTANTIATE(afw::table::SourceMatch);
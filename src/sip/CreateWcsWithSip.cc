@@ -21,7 +21,14 @@
  * the GNU General Public License along with this program.  If not,
  * see <http://www.lsstcorp.org/LegalNotices/>.
  */
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <limits>
+#include <memory>
+#include <set>
+#include <utility>
+#include <vector>
 
 #include "Eigen/SVD"
 #include "Eigen/Cholesky"
@@ -31,10 +38,13 @@
 #include "lsst/meas/astrom/sip/CreateWcsWithSip.h"
 #include "lsst/geom/Angle.h"
 #include "lsst/geom/Box.h"
+#include "lsst/geom/SpherePoint.h"
 #include "lsst/afw/math/Statistics.h"
 #include "lsst/afw/geom/SkyWcs.h"
 #include "lsst/log/Log.h"
-#include "lsst/meas/astrom/makeMatchStatistics.h"
+#include "lsst/meas/astrom/detail/leastSqFactorization.h"
+#include "lsst/meas/astrom/detail/matchStatistics.h"
+#include "lsst/meas/astrom/detail/polynomialUtils.h"
 
 namespace {
 LOG_LOGGER _log = LOG_GET("lsst.meas.astrom.sip");
@@ -49,50 +59,122 @@ namespace {
 
 double const MAX_DISTANCE_CRPIX_TO_BBOXCTR = 1000;
 
+// Maximum number of times a cell of the reverse-fit grid may be split in
+// adaptive mode; each split halves the cell size.
+int const MAX_REVERSE_REFINEMENTS = 4;
+
 /*
- * Given an index and a SIP order, calculate p and q for the index'th term u^p v^q
- * (Cf. Eqn 2 in http://fits.gsfc.nasa.gov/registry/sip/SIP_distortion_v1_0.pdf)
+ * Given a SIP order, calculate p and q for every term u^p v^q, in the order
+ * in which the terms appear in the design matrix and solution vectors
+ * (Cf. Eqn 2 in http://fits.gsfc.nasa.gov/registry/sip/SIP_distortion_v1_0.pdf):
+ * all terms with p == 0 in order of increasing q, then those with p == 1, etc.
  */
-std::pair<int, int> indexToPQ(int const index, int const order) {
-    int p = 0, q = index;
+std::vector<std::pair<int, int>> makePQTable(int const order) {
+    std::vector<std::pair<int, int>> table;
+    table.reserve(order * (order + 1) / 2);
+    for (int p = 0; p < order; ++p) {
+        for (int q = 0; p + q < order; ++q) {
+            table.emplace_back(p, q);
+        }
+    }
+    return table;
+}
 
-    for (int decrement = order; q >= decrement && decrement > 0; --decrement) {
-        q -= decrement;
-        p++;
+/*
+ * Build the design matrix for a SIP fit: C(i, j) == axis1[i]^p axis2[i]^q,
+ * where (p, q) == pqTable[j].
+ *
+ * Powers are accumulated by repeated multiplication into column-major
+ * tables, so each column of C is a single element-wise product of two
+ * columns.
+ */
+Eigen::MatrixXd calculateCMatrix(Eigen::VectorXd const& axis1, Eigen::VectorXd const& axis2,
+                                 std::vector<std::pair<int, int>> const& pqTable, int const order) {
+    int const n = axis1.size();
+    int const nPowers = std::max(order, 1);
+    // pow1(i, k) == axis1[i]^k, and similarly for pow2
+    Eigen::ArrayXXd pow1(n, nPowers);
+    Eigen::ArrayXXd pow2(n, nPowers);
+    pow1.col(0).setOnes();
+    pow2.col(0).setOnes();
+    for (int k = 1; k < nPowers; ++k) {
+        pow1.col(k) = pow1.col(k - 1) * axis1.array();
+        pow2.col(k) = pow2.col(k - 1) * axis2.array();
+    }
+    Eigen::MatrixXd C(n, pqTable.size());
+    for (std::size_t j = 0; j < pqTable.size(); ++j) {
+        C.col(j) = (pow1.col(pqTable[j].first) * pow2.col(pqTable[j].second)).matrix();
     }
+    return C;
+}
 
-    return std::make_pair(p, q);
+/// Return the reference positions of a list of matches
+template <class MatchT>
+std::vector<geom::SpherePoint> getRefCoords(std::vector<MatchT> const& matches) {
+    std::vector<geom::SpherePoint> refCoords;
+    refCoords.reserve(matches.size());
+    for (auto const& match : matches) {
+        refCoords.push_back(match.first->getCoord());
+    }
+    return refCoords;
 }
 
-Eigen::MatrixXd calculateCMatrix(Eigen::VectorXd const& axis1, Eigen::VectorXd const& axis2,
-                                 int const order) {
-    int nTerms = 0.5 * order * (order + 1);
+/// Return one axis (0 for x, 1 for y) of the source centroids of a list of matches
+template <class MatchT>
+Eigen::ArrayXd getSrcCentroids(std::vector<MatchT> const& matches, int const axis) {
+    Eigen::ArrayXd result(matches.size());
+    for (std::size_t i = 0; i < matches.size(); ++i) {
+        result[i] = matches[i].second->getCentroid()[axis];
+    }
+    return result;
+}
 
-    int const n = axis1.size();
-    Eigen::MatrixXd C = Eigen::MatrixXd::Zero(n, nTerms);
-    for (int i = 0; i < n; ++i) {
-        for (int j = 0; j < nTerms; ++j) {
-            std::pair<int, int> pq = indexToPQ(j, order);
-            int p = pq.first, q = pq.second;
-
-            assert(p + q < order);
-            C(i, j) = ::pow(axis1[i], p) * ::pow(axis2[i], q);
-        }
+/// Convert arrays of ICRS ra, dec in radians to SpherePoints
+std::vector<geom::SpherePoint> makeSpherePoints(ndarray::Array<double const, 1, 0> const& ra,
+                                                ndarray::Array<double const, 1, 0> const& dec) {
+    if (ra.getSize<0>() != dec.getSize<0>()) {
+        throw LSST_EXCEPT(pex::exceptions::LengthError,
+                          str(boost::format("ra and dec have different sizes: %d != %d") % ra.getSize<0>() %
+                              dec.getSize<0>()));
+    }
+    std::vector<geom::SpherePoint> result;
+    result.reserve(ra.getSize<0>());
+    for (std::size_t i = 0; i < ra.getSize<0>(); ++i) {
+        result.emplace_back(ra[i] * geom::radians, dec[i] * geom::radians);
     }
+    return result;
+}
 
-    return C;
+/// Copy an ndarray to an Eigen array
+Eigen::ArrayXd toEigenArray(ndarray::Array<double const, 1, 0> const& array) {
+    Eigen::ArrayXd result(array.getSize<0>());
+    for (std::size_t i = 0; i < array.getSize<0>(); ++i) {
+        result[i] = array[i];
+    }
+    return result;
 }
 
-/// Given a vector b and a matrix A, solve b - Ax = 0
-/// b is an m x 1 vector, A is an n x m matrix, and x, the output is a
-///\param b An m x 1 vector, where m is the number of parameters in the fit
-///\param A An n x m vecotr, where n is the number of equations in the solution
-///
-///\returns x, an m x 1 vector of best fit params
-Eigen::VectorXd leastSquaresSolve(Eigen::VectorXd b, Eigen::MatrixXd A) {
-    assert(A.rows() == b.rows());
-    Eigen::VectorXd par = A.jacobiSvd(Eigen::ComputeThinU | Eigen::ComputeThinV).solve(b);
-    return par;
+/// Convert centroid uncertainties to weights for the forward fit; empty if errors is empty
+Eigen::ArrayXd makeWeights(ndarray::Array<double const, 1, 0> const& errors) {
+    Eigen::ArrayXd weights = toEigenArray(errors);
+    for (Eigen::Index i = 0; i < weights.size(); ++i) {
+        if (!(weights[i] > 0 && std::isfinite(weights[i]))) {
+            throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                              str(boost::format("errors[%d] = %g is not positive and finite") %
+                                  static_cast<int>(i) % weights[i]));
+        }
+    }
+    return weights.inverse();
+}
+
+/// Return the source centroids as points
+std::vector<geom::Point2D> makePoints(Eigen::ArrayXd const& x, Eigen::ArrayXd const& y) {
+    std::vector<geom::Point2D> result;
+    result.reserve(x.size());
+    for (Eigen::Index i = 0; i < x.size(); ++i) {
+        result.emplace_back(x[i], y[i]);
+    }
+    return result;
 }
 
 }  // anonymous namespace
@@ -101,13 +183,39 @@ Eigen::VectorXd leastSquaresSolve(Eigen::VectorXd b, Eigen::MatrixXd A) {
 template <class MatchT>
 CreateWcsWithSip<MatchT>::CreateWcsWithSip(std::vector<MatchT> const& matches,
                                            afw::geom::SkyWcs const& linearWcs, int const order,
-                                           geom::Box2I const& bbox, int const ngrid)
-        : _matches(matches),
+                                           geom::Box2I const& bbox, int const ngrid,
+                                           LeastSqSolver const solver, double const reverseTolerance)
+        : CreateWcsWithSip(getRefCoords(matches), getSrcCentroids(matches, 0), getSrcCentroids(matches, 1),
+                           Eigen::ArrayXd(), linearWcs, order, bbox, ngrid, solver, reverseTolerance) {}
+
+template <class MatchT>
+CreateWcsWithSip<MatchT>::CreateWcsWithSip(
+        ndarray::Array<double const, 1, 0> const& ra, ndarray::Array<double const, 1, 0> const& dec,
+        ndarray::Array<double const, 1, 0> const& x, ndarray::Array<double const, 1, 0> const& y,
+        afw::geom::SkyWcs const& linearWcs, int const order, geom::Box2I const& bbox, int const ngrid,
+        LeastSqSolver const solver, double const reverseTolerance,
+        ndarray::Array<double const, 1, 0> const& errors)
+        : CreateWcsWithSip(makeSpherePoints(ra, dec), toEigenArray(x), toEigenArray(y), makeWeights(errors),
+                           linearWcs, order, bbox, ngrid, solver, reverseTolerance) {}
+
+template <class MatchT>
+CreateWcsWithSip<MatchT>::CreateWcsWithSip(std::vector<geom::SpherePoint>&& refCoords, Eigen::ArrayXd&& srcX,
+                                           Eigen::ArrayXd&& srcY, Eigen::ArrayXd&& weights,
+                                           afw::geom::SkyWcs const& linearWcs, int const order,
+                                           geom::Box2I const& bbox, int const ngrid,
+                                           LeastSqSolver const solver, double const reverseTolerance)
+        : _refCoords(std::move(refCoords)),
+          _srcX(std::move(srcX)),
+          _srcY(std::move(srcY)),
+          _weights(std::move(weights)),
           _bbox(bbox),
           _ngrid(ngrid),
           _linearWcs(std::make_shared<afw::geom::SkyWcs>(linearWcs)),
           _sipOrder(order + 1),
           _reverseSipOrder(order + 2),  // Higher order for reverse transform
+          _solver(solver),
+          _reverseTolerance(reverseTolerance),
+          _nReverseSamples(0),
           _sipA(Eigen::MatrixXd::Zero(_sipOrder, _sipOrder)),
           _sipB(Eigen::MatrixXd::Zero(_sipOrder, _sipOrder)),
           _sipAp(Eigen::MatrixXd::Zero(_reverseSipOrder, _reverseSipOrder)),
@@ -127,12 +235,21 @@ CreateWcsWithSip<MatchT>::CreateWcsWithSip(std::vector<MatchT> const& matches,
                               _reverseSipOrder));
     }
 
-    if (_matches.size() < std::size_t(_sipOrder)) {
+    std::size_t const nPoints = _refCoords.size();
+    if (std::size_t(_srcX.size()) != nPoints || std::size_t(_srcY.size()) != nPoints ||
+        (_weights.size() != 0 && std::size_t(_weights.size()) != nPoints)) {
+        throw LSST_EXCEPT(pex::exceptions::LengthError,
+                          str(boost::format("Inconsistent sizes: %d reference positions, %d x and %d y "
+                                            "centroids, %d errors") %
+                              nPoints % _srcX.size() % _srcY.size() % _weights.size()));
+    }
+    if (nPoints < std::size_t(_sipOrder)) {
         throw LSST_EXCEPT(pex::exceptions::LengthError, "Number of matches less than requested sip order");
     }
 
     if (_ngrid <= 0) {
-        _ngrid = 5 * _sipOrder;  // should be plenty
+        // In adaptive mode, start from the coarsest grid that constrains the reverse polynomial.
+        _ngrid = (_reverseTolerance > 0) ? _reverseSipOrder + 1 : 5 * _sipOrder;  // should be plenty
     }
 
     /*
@@ -142,13 +259,11 @@ CreateWcsWithSip<MatchT>::CreateWcsWithSip(std::vector<MatchT> const& matches,
      * If no BBox is provided, guess one from the input points (extrapolated a bit to allow for fact
      * that a finite number of points won't reach to the edge of the image)
      */
-    if (_bbox.isEmpty() && !_matches.empty()) {
-        for (typename std::vector<MatchT>::const_iterator ptr = _matches.begin(); ptr != _matches.end();
-             ++ptr) {
-            afw::table::SourceRecord const& src = *ptr->second;
-            _bbox.include(geom::PointI(src.getX(), src.getY()));
+    if (_bbox.isEmpty() && nPoints > 0) {
+        for (std::size_t i = 0; i < nPoints; ++i) {
+            _bbox.include(geom::PointI(_srcX[i], _srcY[i]));
         }
-        float const borderFrac = 1 / ::sqrt(_matches.size());  // fractional border to add to exact BBox
+        float const borderFrac = 1 / ::sqrt(nPoints);  // fractional border to add to exact BBox
         geom::Extent2I border(borderFrac * _bbox.getWidth(), borderFrac * _bbox.getHeight());
 
         _bbox.grow(border);
@@ -188,24 +303,19 @@ void CreateWcsWithSip<MatchT>::_calculateForwardMatrices() {
     geom::Point2D crpix = _linearWcs->getPixelOrigin();
 
     // Calculate u, v and intermediate world coordinates
-    int const nPoints = _matches.size();
-    Eigen::VectorXd u(nPoints), v(nPoints), iwc1(nPoints), iwc2(nPoints);
+    int const nPoints = _refCoords.size();
+    Eigen::VectorXd iwc1(nPoints), iwc2(nPoints);
 
-    int i = 0;
+    // iwc: intermediate world coordinate positions of catalogue objects
     auto linearIwcToSky = getIntermediateWorldCoordsToSky(*_linearWcs);
-    for (typename std::vector<MatchT>::const_iterator ptr = _matches.begin(); ptr != _matches.end();
-         ++ptr, ++i) {
-        afw::table::ReferenceMatch const& match = *ptr;
-
-        // iwc: intermediate world coordinate positions of catalogue objects
-        auto c = match.first->getCoord();
-        geom::Point2D p = linearIwcToSky->applyInverse(c);
-        iwc1[i] = p[0];
-        iwc2[i] = p[1];
-        // u and v are intermediate pixel coordinates of observed (distorted) positions
-        u[i] = match.second->getX() - crpix[0];
-        v[i] = match.second->getY() - crpix[1];
+    std::vector<geom::Point2D> const iwcPoints = linearIwcToSky->applyInverse(_refCoords);
+    for (int i = 0; i < nPoints; ++i) {
+        iwc1[i] = iwcPoints[i][0];
+        iwc2[i] = iwcPoints[i][1];
     }
+    // u and v are intermediate pixel coordinates of observed (distorted) positions
+    Eigen::VectorXd u = (_srcX - crpix[0]).matrix();
+    Eigen::VectorXd v = (_srcY - crpix[1]).matrix();
     // Scale u and v down to [-1,,+1] in order to avoid too large numbers in the polynomials
     double uMax = u.cwiseAbs().maxCoeff();
     double vMax = v.cwiseAbs().maxCoeff();
@@ -215,19 +325,27 @@ void CreateWcsWithSip<MatchT>::_calculateForwardMatrices() {
 
     // Forward transform
     int ord = _sipOrder;
-    Eigen::MatrixXd forwardC = calculateCMatrix(u, v, ord);
-    Eigen::VectorXd mu = leastSquaresSolve(iwc1, forwardC);
-    Eigen::VectorXd nu = leastSquaresSolve(iwc2, forwardC);
+    auto const pqTable = makePQTable(ord);
+    Eigen::MatrixXd forwardC = calculateCMatrix(u, v, pqTable, ord);
+    Eigen::MatrixXd iwc(iwc1.size(), 2);
+    iwc << iwc1, iwc2;
+    if (_weights.size() != 0) {
+        forwardC = _weights.matrix().asDiagonal() * forwardC;
+        iwc = _weights.matrix().asDiagonal() * iwc;
+    }
+    Eigen::MatrixXd const munu = detail::LeastSqFactorization(forwardC, _solver).solve(iwc);
+    Eigen::VectorXd mu = munu.col(0);
+    Eigen::VectorXd nu = munu.col(1);
 
     // Use mu and nu to refine CD
 
-    // Given the implementation of indexToPQ(), the refined values
+    // Given the implementation of makePQTable(), the refined values
     // of the elements of the CD matrices are in elements 1 and "_sipOrder" of mu and nu
-    // If the implementation of indexToPQ() changes, these assertions
+    // If the implementation of makePQTable() changes, these assertions
     // will catch that change.
-    assert((indexToPQ(0, ord) == std::pair<int, int>(0, 0)));
-    assert((indexToPQ(1, ord) == std::pair<int, int>(0, 1)));
-    assert((indexToPQ(ord, ord) == std::pair<int, int>(1, 0)));
+    assert((pqTable[0] == std::pair<int, int>(0, 0)));
+    assert((pqTable[1] == std::pair<int, int>(0, 1)));
+    assert((pqTable[ord] == std::pair<int, int>(1, 0)));
 
     // Scale back CD matrix
     Eigen::Matrix2d CD;
@@ -257,8 +375,7 @@ void CreateWcsWithSip<MatchT>::_calculateForwardMatrices() {
     // (Bpq)    (CD21 CD22)      (nu[i])
 
     for (int i = 1; i < mu.rows(); ++i) {
-        std::pair<int, int> pq = indexToPQ(i, ord);
-        int p = pq.first, q = pq.second;
+        int p = pqTable[i].first, q = pqTable[i].second;
 
         if (p + q > 1 && p + q < ord) {
             Eigen::Vector2d munu(2, 1);
@@ -276,9 +393,6 @@ template <class MatchT>
 void CreateWcsWithSip<MatchT>::_calculateReverseMatrices() {
     int const ngrid2 = _ngrid * _ngrid;
 
-    Eigen::VectorXd U(ngrid2), V(ngrid2);
-    Eigen::VectorXd delta1(ngrid2), delta2(ngrid2);
-
     int const x0 = _bbox.getMinX();
     double const dx = _bbox.getWidth() / (double)(_ngrid - 1);
     int const y0 = _bbox.getMinY();
@@ -290,58 +404,170 @@ void CreateWcsWithSip<MatchT>::_calculateReverseMatrices() {
     LOGL_DEBUG(_log, "_calcReverseMatrices: x0,y0 %i,%i, W,H %i,%i, ngrid %i, dx,dy %g,%g, CRPIX %g,%g", x0,
                y0, _bbox.getWidth(), _bbox.getHeight(), _ngrid, dx, dy, crpix[0], crpix[1]);
 
-    auto tanWcs = _newWcs->getTanWcs(_newWcs->getPixelOrigin());
-    auto applySipAB = afw::geom::makeWcsPairTransform(*_newWcs, *tanWcs);
-    int k = 0;
-    for (int i = 0; i < _ngrid; ++i) {
+    // u and v are intermediate pixel coordinates on a grid of positions
+    Eigen::ArrayXd u(ngrid2), v(ngrid2);
+    for (int i = 0, k = 0; i < _ngrid; ++i) {
         double const y = y0 + i * dy;
-        std::vector<geom::Point2D> beforeSipABPoints;
-        beforeSipABPoints.reserve(_ngrid);
+        for (int j = 0; j < _ngrid; ++j, ++k) {
+            u[k] = x0 + j * dx - crpix[0];
+            v[k] = y - crpix[1];
+        }
+    }
+
+    // U and V are the result of applying the "forward" (A,B) SIP coefficients.
+    // _newWcs is TAN-SIP with exactly these coefficients, so this is what
+    // going through its pixel->sky mapping and back through the pure TAN
+    // mapping would give, without the cost of evaluating those transforms.
+    Eigen::ArrayXd U, V;
+    _applySip(_sipA, _sipB, u, v, U, V);
+
+    for (int i : {0, _ngrid / 2, _ngrid - 1}) {
+        for (int j : {0, _ngrid / 2, _ngrid - 1}) {
+            int const k = i * _ngrid + j;
+            LOGL_DEBUG(_log, "  x,y (%.1f, %.1f), u,v (%.1f, %.1f), U,V (%.1f, %.1f)", u[k] + crpix[0],
+                       v[k] + crpix[1], u[k], v[k], U[k], V[k]);
+        }
+    }
+
+    _fitReverseMatrices(u, v, U, V);
+    _nReverseSamples = ngrid2;
+
+    if (_reverseTolerance <= 0) {
+        return;
+    }
+
+    /*
+     * Adaptive refinement: check the round trip through the forward and
+     * reverse polynomials at the centre of every grid cell, and split the
+     * cells where it is worse than _reverseTolerance into four, adding their
+     * centres and edge midpoints to the samples before refitting.  A refit
+     * can make the round trip worse in cells that already met the tolerance,
+     * so after each one all the cells are checked again, and the new fit is
+     * only kept if its worst error over them is smaller than that of the
+     * previous fit at the same points.
+     *
+     * Positions are kept on an integer lattice whose spacing is that of the
+     * finest possible cells, so points shared between neighbouring cells
+     * can be recognised exactly.
+     */
+    int const scale = 1 << MAX_REVERSE_REFINEMENTS;
+    double const lx = dx / scale;
+    double const ly = dy / scale;
+    std::set<std::pair<int, int>> sampled;
+    std::vector<std::array<int, 3>> cells;  // lower-left corner and size of each cell
+    for (int i = 0; i < _ngrid; ++i) {
         for (int j = 0; j < _ngrid; ++j) {
-            double const x = x0 + j * dx;
-            beforeSipABPoints.emplace_back(geom::Point2D(x, y));
+            sampled.emplace(j * scale, i * scale);
+            if (i + 1 < _ngrid && j + 1 < _ngrid) {
+                cells.push_back({j * scale, i * scale, scale});
+            }
         }
-        auto const afterSipABPoints = applySipAB->applyForward(beforeSipABPoints);
-        for (int j = 0; j < _ngrid; ++j, ++k) {
-            double const x = x0 + j * dx;
-            double u, v;
-            // u and v are intermediate pixel coordinates on a grid of positions
-            u = x - crpix[0];
-            v = y - crpix[1];
-
-            // U and V are the result of applying the "forward" (A,B) SIP coefficients
-            geom::Point2D const xy = afterSipABPoints[j];
-            U[k] = xy[0] - crpix[0];
-            V[k] = xy[1] - crpix[1];
-
-            if ((i == 0 || i == (_ngrid - 1) || i == (_ngrid / 2)) &&
-                (j == 0 || j == (_ngrid - 1) || j == (_ngrid / 2))) {
-                LOGL_DEBUG(_log, "  x,y (%.1f, %.1f), u,v (%.1f, %.1f), U,V (%.1f, %.1f)", x, y, u, v, U[k],
-                           V[k]);
+    }
+    std::vector<double> uSamples(u.data(), u.data() + u.size());
+    std::vector<double> vSamples(v.data(), v.data() + v.size());
+    // The previous fit, to fall back on if refining the sampling does not
+    // help (e.g. because the reverse polynomial order is the limitation).
+    Eigen::MatrixXd previousAp, previousBp;
+    int previousNSamples = 0;
+    for (int level = 0;; ++level) {
+        Eigen::ArrayXd cu(cells.size()), cv(cells.size());
+        for (std::size_t n = 0; n < cells.size(); ++n) {
+            cu[n] = x0 + (cells[n][0] + 0.5 * cells[n][2]) * lx - crpix[0];
+            cv[n] = y0 + (cells[n][1] + 0.5 * cells[n][2]) * ly - crpix[1];
+        }
+        Eigen::ArrayXd cU, cV;
+        _applySip(_sipA, _sipB, cu, cv, cU, cV);
+        // Round-trip error at the cell centres for the given reverse coefficients
+        auto const roundTripError = [&](Eigen::MatrixXd const& sipAp, Eigen::MatrixXd const& sipBp) {
+            Eigen::ArrayXd cuRoundTrip, cvRoundTrip;
+            _applySip(sipAp, sipBp, cU, cV, cuRoundTrip, cvRoundTrip);
+            return Eigen::ArrayXd(((cuRoundTrip - cu).square() + (cvRoundTrip - cv).square()).sqrt());
+        };
+        Eigen::ArrayXd const error = roundTripError(_sipAp, _sipBp);
+        double const maxError = error.maxCoeff();
+        LOGL_DEBUG(_log, "_calcReverseMatrices: refinement level %d, %d cells, max round-trip error %g",
+                   level, static_cast<int>(cells.size()), maxError);
+        if (level > 0 && maxError >= roundTripError(previousAp, previousBp).maxCoeff()) {
+            LOGL_DEBUG(_log, "_calcReverseMatrices: refinement did not reduce the error; stopping");
+            _sipAp = previousAp;
+            _sipBp = previousBp;
+            _nReverseSamples = previousNSamples;
+            break;
+        }
+        if (maxError <= _reverseTolerance) {
+            break;
+        }
+        if (level == MAX_REVERSE_REFINEMENTS) {
+            LOGL_DEBUG(_log, "_calcReverseMatrices: stopping at maximum refinement level");
+            break;
+        }
+        // Cells that meet the tolerance are kept as they are, to be checked
+        // again after the refit; the others (which are at most level times
+        // split, so have a size of at least 2) are split.
+        std::vector<std::array<int, 3>> refined;
+        for (std::size_t n = 0; n < cells.size(); ++n) {
+            if (error[n] <= _reverseTolerance) {
+                refined.push_back(cells[n]);
+                continue;
             }
-
-            delta1[k] = u - U[k];
-            delta2[k] = v - V[k];
+            int const ix = cells[n][0], iy = cells[n][1], size = cells[n][2], half = size / 2;
+            for (auto const& point : {std::make_pair(ix + half, iy + half), std::make_pair(ix + half, iy),
+                                      std::make_pair(ix + half, iy + size), std::make_pair(ix, iy + half),
+                                      std::make_pair(ix + size, iy + half)}) {
+                if (sampled.insert(point).second) {
+                    uSamples.push_back(x0 + point.first * lx - crpix[0]);
+                    vSamples.push_back(y0 + point.second * ly - crpix[1]);
+                }
+            }
+            refined.push_back({ix, iy, half});
+            refined.push_back({ix + half, iy, half});
+            refined.push_back({ix, iy + half, half});
+            refined.push_back({ix + half, iy + half, half});
         }
+        cells.swap(refined);
+        previousAp = _sipAp;
+        previousBp = _sipBp;
+        previousNSamples = _nReverseSamples;
+        u = Eigen::Map<Eigen::ArrayXd const>(uSamples.data(), uSamples.size());
+        v = Eigen::Map<Eigen::ArrayXd const>(vSamples.data(), vSamples.size());
+        _applySip(_sipA, _sipB, u, v, U, V);
+        _fitReverseMatrices(u, v, U, V);
+        _nReverseSamples = uSamples.size();
     }
+}
+
+template <class MatchT>
+void CreateWcsWithSip<MatchT>::_applySip(Eigen::MatrixXd const& sipA, Eigen::MatrixXd const& sipB,
+                                         Eigen::ArrayXd const& u, Eigen::ArrayXd const& v, Eigen::ArrayXd& U,
+                                         Eigen::ArrayXd& V) const {
+    detail::evaluatePolynomials(sipA, sipB, u, v, U, V);
+    U += u;
+    V += v;
+}
 
+template <class MatchT>
+void CreateWcsWithSip<MatchT>::_fitReverseMatrices(Eigen::ArrayXd const& u, Eigen::ArrayXd const& v,
+                                                   Eigen::ArrayXd const& U, Eigen::ArrayXd const& V) {
     // Scale down U and V in order to avoid too large numbers in the polynomials
-    double UMax = U.cwiseAbs().maxCoeff();
-    double VMax = V.cwiseAbs().maxCoeff();
+    double UMax = U.abs().maxCoeff();
+    double VMax = V.abs().maxCoeff();
     double norm = (UMax > VMax) ? UMax : VMax;
-    U = U / norm;
-    V = V / norm;
+    Eigen::VectorXd const scaledU = (U / norm).matrix();
+    Eigen::VectorXd const scaledV = (V / norm).matrix();
 
     // Reverse transform
     int const ord = _reverseSipOrder;
-    Eigen::MatrixXd reverseC = calculateCMatrix(U, V, ord);
-    Eigen::VectorXd tmpA = leastSquaresSolve(delta1, reverseC);
-    Eigen::VectorXd tmpB = leastSquaresSolve(delta2, reverseC);
+    auto const pqTable = makePQTable(ord);
+    Eigen::MatrixXd reverseC = calculateCMatrix(scaledU, scaledV, pqTable, ord);
+    Eigen::MatrixXd delta(u.size(), 2);
+    delta << (u - U).matrix(), (v - V).matrix();
+    Eigen::MatrixXd const tmpAB = detail::LeastSqFactorization(reverseC, _solver).solve(delta);
+    Eigen::VectorXd tmpA = tmpAB.col(0);
+    Eigen::VectorXd tmpB = tmpAB.col(1);
 
     assert(tmpA.rows() == tmpB.rows());
     for (int j = 0; j < tmpA.rows(); ++j) {
-        std::pair<int, int> pq = indexToPQ(j, ord);
-        int p = pq.first, q = pq.second;
+        int p = pqTable[j].first, q = pqTable[j].second;
         // Scale back sip coefficients
         _sipAp(p, q) = tmpA[j] / ::pow(norm, p + q);
         _sipBp(p, q) = tmpB[j] / ::pow(norm, p + q);
@@ -351,32 +577,274 @@ void CreateWcsWithSip<MatchT>::_calculateReverseMatrices() {
 template <class MatchT>
 double CreateWcsWithSip<MatchT>::getScatterInPixels() const {
     assert(_newWcs.get());
-    return makeMatchStatisticsInPixels(*_newWcs, _matches, afw::math::MEDIAN).getValue();
+    auto const stats = detail::makeMatchStatisticsInPixels(*_newWcs, _refCoords, makePoints(_srcX, _srcY),
+                                                           afw::math::MEDIAN);
+    return stats.getValue();
 }
 
 template <class MatchT>
 double CreateWcsWithSip<MatchT>::getLinearScatterInPixels() const {
     assert(_linearWcs.get());
-    return makeMatchStatisticsInPixels(*_linearWcs, _matches, afw::math::MEDIAN).getValue();
+    auto const stats = detail::makeMatchStatisticsInPixels(*_linearWcs, _refCoords, makePoints(_srcX, _srcY),
+                                                           afw::math::MEDIAN);
+    return stats.getValue();
 }
 
 template <class MatchT>
 geom::Angle CreateWcsWithSip<MatchT>::getScatterOnSky() const {
     assert(_newWcs.get());
-    return makeMatchStatisticsInRadians(*_newWcs, _matches, afw::math::MEDIAN).getValue() * geom::radians;
+    auto const stats = detail::makeMatchStatisticsInRadians(*_newWcs, _refCoords, makePoints(_srcX, _srcY),
+                                                            afw::math::MEDIAN);
+    return stats.getValue() * geom::radians;
 }
 
 template <class MatchT>
 geom::Angle CreateWcsWithSip<MatchT>::getLinearScatterOnSky() const {
     assert(_linearWcs.get());
-    return makeMatchStatisticsInRadians(*_linearWcs, _matches, afw::math::MEDIAN).getValue() * geom::radians;
+    auto const stats = detail::makeMatchStatisticsInRadians(*_linearWcs, _refCoords, makePoints(_srcX, _srcY),
+                                                            afw::math::MEDIAN);
+    return stats.getValue() * geom::radians;
+}
+
+namespace {
+
+/// Return the elements of array that are not flagged in rejected
+ndarray::Array<double const, 1, 1> selectUnrejected(ndarray::Array<double const, 1, 0> const& array,
+                                                    ndarray::Array<bool const, 1, 1> const& rejected,
+                                                    std::size_t const nUnrejected) {
+    if (array.isEmpty()) {
+        return ndarray::Array<double const, 1, 1>();
+    }
+    ndarray::Array<double, 1, 1> result = ndarray::allocate(nUnrejected);
+    for (std::size_t i = 0, j = 0; i < rejected.getSize<0>(); ++i) {
+        if (!rejected[i]) {
+            result[j++] = array[i];
+        }
+    }
+    return result;
+}
+
+/*
+ * Fit the points that are not flagged in rejected with numIter successive
+ * CreateWcsWithSip fits, starting from wcs, and append the scatter of the last
+ * fit to scatterOnSky.
+ */
+std::shared_ptr<afw::geom::SkyWcs> fitUnrejected(
+        ndarray::Array<double const, 1, 0> const& ra, ndarray::Array<double const, 1, 0> const& dec,
+        ndarray::Array<double const, 1, 0> const& x, ndarray::Array<double const, 1, 0> const& y,
+        ndarray::Array<double const, 1, 0> const& errors, ndarray::Array<bool const, 1, 1> const& rejected,
+        afw::geom::SkyWcs const& wcs, int const order, int const numIter, geom::Box2I const& bbox,
+        LeastSqSolver const solver, std::vector<geom::Angle>& scatterOnSky) {
+    std::size_t nUnrejected = 0;
+    for (bool r : rejected) {
+        nUnrejected += !r;
+    }
+    auto const uRa = selectUnrejected(ra, rejected, nUnrejected);
+    auto const uDec = selectUnrejected(dec, rejected, nUnrejected);
+    auto const uX = selectUnrejected(x, rejected, nUnrejected);
+    auto const uY = selectUnrejected(y, rejected, nUnrejected);
+    auto const uErrors = selectUnrejected(errors, rejected, nUnrejected);
+    std::unique_ptr<CreateWcsWithSip<afw::table::ReferenceMatch>> sipObject;
+    for (int i = 0; i < numIter; ++i) {
+        sipObject = std::make_unique<CreateWcsWithSip<afw::table::ReferenceMatch>>(
+                uRa, uDec, uX, uY, sipObject ? *sipObject->getNewWcs() : wcs, order, bbox, 0, solver, 0.0,
+                uErrors);
+    }
+    scatterOnSky.push_back(sipObject->getScatterOnSky());
+    return sipObject->getNewWcs();
+}
+
+}  // anonymous namespace
+
+FitTanSipWcsResult fitTanSipWcsWithRejection(
+        ndarray::Array<double const, 1, 0> const& ra, ndarray::Array<double const, 1, 0> const& dec,
+        ndarray::Array<double const, 1, 0> const& x, ndarray::Array<double const, 1, 0> const& y,
+        afw::geom::SkyWcs const& initWcs, int const order, int const numIter, int const numRejIter,
+        double const rejSigma, geom::Box2I const& bbox, LeastSqSolver const solver,
+        ndarray::Array<double const, 1, 0> const& errors) {
+    if (numIter < 1) {
+        throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                          str(boost::format("numIter = %d must be at least 1") % numIter));
+    }
+    std::vector<geom::SpherePoint> const refCoords = makeSpherePoints(ra, dec);
+    std::size_t const nMatches = refCoords.size();
+    if (x.getSize<0>() != nMatches || y.getSize<0>() != nMatches ||
+        (!errors.isEmpty() && errors.getSize<0>() != nMatches)) {
+        throw LSST_EXCEPT(pex::exceptions::LengthError,
+                          str(boost::format("Inconsistent sizes: %d reference positions, %d x and %d y "
+                                            "centroids, %d errors") %
+                              nMatches % x.getSize<0>() % y.getSize<0>() % errors.getSize<0>()));
+    }
+
+    FitTanSipWcsResult result;
+    result.rejected = ndarray::allocate(nMatches);
+    result.rejected.deep() = false;
+    result.wcs = fitUnrejected(ra, dec, x, y, errors, result.rejected, initWcs, order, numIter, bbox, solver,
+                               result.scatterOnSky);
+    Eigen::ArrayXd dx(nMatches), dy(nMatches);
+    for (int rej = 0; rej < numRejIter; ++rej) {
+        std::vector<geom::Point2D> const fitPixels = result.wcs->skyToPixel(refCoords);
+        // Residual statistics only use the matches that were not already rejected.
+        double meanX = 0.0, meanY = 0.0;
+        int nGood = 0;
+        for (std::size_t i = 0; i < nMatches; ++i) {
+            dx[i] = fitPixels[i].getX() - x[i];
+            dy[i] = fitPixels[i].getY() - y[i];
+            if (!result.rejected[i]) {
+                meanX += dx[i];
+                meanY += dy[i];
+                ++nGood;
+            }
+        }
+        meanX /= nGood;
+        meanY /= nGood;
+        double varX = 0.0, varY = 0.0;
+        for (std::size_t i = 0; i < nMatches; ++i) {
+            if (!result.rejected[i]) {
+                varX += (dx[i] - meanX) * (dx[i] - meanX);
+                varY += (dy[i] - meanY) * (dy[i] - meanY);
+            }
+        }
+        double const limitX = rejSigma * std::sqrt(varX / nGood);
+        double const limitY = rejSigma * std::sqrt(varY / nGood);
+        int nRejected = 0;
+        for (std::size_t i = 0; i < nMatches; ++i) {
+            result.rejected[i] = (dx[i] > limitX) || (dy[i] > limitY);
+            nRejected += result.rejected[i];
+        }
+        result.nRejected.push_back(nRejected);
+        if (std::size_t(nRejected) == nMatches) {
+            throw LSST_EXCEPT(pex::exceptions::RuntimeError,
+                              str(boost::format("All matches rejected in fitter iteration %d") % (rej + 1)));
+        }
+        // The fit after the last rejection iteration is the final fit.
+        result.wcs = fitUnrejected(ra, dec, x, y, errors, result.rejected, *result.wcs, order, numIter, bbox,
+                                   solver, result.scatterOnSky);
+    }
+    return result;
+}
+
+template <class MatchT>
+FitTanSipWcsResult fitTanSipWcsWithRejection(std::vector<MatchT> const& matches,
+                                             afw::geom::SkyWcs const& initWcs, int const order,
+                                             int const numIter, int const numRejIter, double const rejSigma,
+                                             geom::Box2I const& bbox, LeastSqSolver const solver) {
+    std::size_t const nMatches = matches.size();
+    ndarray::Array<double, 1, 1> ra = ndarray::allocate(nMatches);
+    ndarray::Array<double, 1, 1> dec = ndarray::allocate(nMatches);
+    ndarray::Array<double, 1, 1> x = ndarray::allocate(nMatches);
+    ndarray::Array<double, 1, 1> y = ndarray::allocate(nMatches);
+    for (std::size_t i = 0; i < nMatches; ++i) {
+        geom::SpherePoint const coord = matches[i].first->getCoord();
+        ra[i] = coord.getLongitude().asRadians();
+        dec[i] = coord.getLatitude().asRadians();
+        geom::Point2D const centroid = matches[i].second->getCentroid();
+        x[i] = centroid.getX();
+        y[i] = centroid.getY();
+    }
+    return fitTanSipWcsWithRejection(ra, dec, x, y, initWcs, order, numIter, numRejIter, rejSigma, bbox,
+                                     solver);
+}
+
+namespace {
+
+/// Return an nx x ny grid of pixel positions evenly covering bbox, with y varying fastest
+std::vector<geom::Point2D> makePixelGrid(geom::Box2D const& bbox, int const nx, int const ny) {
+    double const dx = (nx > 1) ? bbox.getWidth() / (nx - 1) : 0.0;
+    double const dy = (ny > 1) ? bbox.getHeight() / (ny - 1) : 0.0;
+    std::vector<geom::Point2D> grid;
+    grid.reserve(nx * ny);
+    for (int i = 0; i < nx; ++i) {
+        for (int j = 0; j < ny; ++j) {
+            grid.emplace_back(bbox.getMinX() + i * dx, bbox.getMinY() + j * dy);
+        }
+    }
+    return grid;
+}
+
+/// Return the larger of maxValue and value, or NaN if either is NaN
+double nanMax(double const maxValue, double const value) {
+    return (std::isnan(maxValue) || std::isnan(value)) ? std::numeric_limits<double>::quiet_NaN()
+                                                       : std::max(maxValue, value);
+}
+
+}  // anonymous namespace
+
+ApproximateWcsResult approximateWcsWithSip(afw::geom::SkyWcs const& wcs, geom::Box2I const& bbox,
+                                           int const order, int const nx, int const ny,
+                                           int const iterations, bool const useTanWcs, int const nxVerify,
+                                           int const nyVerify) {
+    if (nx < 1 || ny < 1 || nxVerify < 1 || nyVerify < 1) {
+        throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                          str(boost::format("Grid sizes nx = %d, ny = %d, nxVerify = %d, nyVerify = %d "
+                                            "must all be at least 1") %
+                              nx % ny % nxVerify % nyVerify));
+    }
+    if (iterations < 1) {
+        throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                          str(boost::format("iterations = %d must be at least 1") % iterations));
+    }
+    geom::Box2D const bboxd(bbox);
+
+    // Sample the input WCS on the fit grid
+    std::vector<geom::Point2D> const pixels = makePixelGrid(bboxd, nx, ny);
+    std::vector<geom::SpherePoint> const coords = wcs.pixelToSky(pixels);
+    ndarray::Array<double, 1, 1> ra = ndarray::allocate(pixels.size());
+    ndarray::Array<double, 1, 1> dec = ndarray::allocate(pixels.size());
+    ndarray::Array<double, 1, 1> x = ndarray::allocate(pixels.size());
+    ndarray::Array<double, 1, 1> y = ndarray::allocate(pixels.size());
+    for (std::size_t i = 0; i < pixels.size(); ++i) {
+        ra[i] = coords[i].getLongitude().asRadians();
+        dec[i] = coords[i].getLatitude().asRadians();
+        x[i] = pixels[i].getX();
+        y[i] = pixels[i].getY();
+    }
+
+    std::shared_ptr<afw::geom::SkyWcs const> fitWcs;
+    if (useTanWcs) {
+        auto const crpix = wcs.getPixelOrigin();
+        fitWcs = afw::geom::makeSkyWcs(crpix, wcs.getSkyOrigin(), wcs.getCdMatrix(crpix));
+    } else {
+        fitWcs = std::make_shared<afw::geom::SkyWcs>(wcs);
+    }
+    // The TAN-SIP fitter fits x and y separately, so we have to iterate to make it converge
+    ApproximateWcsResult result;
+    for (int i = 0; i < iterations; ++i) {
+        CreateWcsWithSip<afw::table::ReferenceMatch> sipObject(ra, dec, x, y, *fitWcs, order, bbox);
+        result.wcs = sipObject.getNewWcs();
+        fitWcs = result.wcs;
+    }
+
+    // Compare the fit with the input WCS on the verification grid
+    std::vector<geom::Point2D> const verifyPixels = makePixelGrid(bboxd, nxVerify, nyVerify);
+    std::vector<geom::SpherePoint> const verifyCoords = wcs.pixelToSky(verifyPixels);
+    std::vector<geom::SpherePoint> const fitCoords = result.wcs->pixelToSky(verifyPixels);
+    std::vector<geom::Point2D> const roundTripPixels = wcs.skyToPixel(verifyCoords);
+    std::vector<geom::Point2D> const fitPixels = result.wcs->skyToPixel(verifyCoords);
+    double maxSkyDiff = 0.0;
+    double maxPixelDiff = 0.0;
+    for (std::size_t i = 0; i < verifyPixels.size(); ++i) {
+        maxSkyDiff = nanMax(maxSkyDiff, verifyCoords[i].separation(fitCoords[i]).asRadians());
+        maxPixelDiff = nanMax(maxPixelDiff, std::hypot(roundTripPixels[i].getX() - fitPixels[i].getX(),
+                                                       roundTripPixels[i].getY() - fitPixels[i].getY()));
+    }
+    result.maxSkyDiff = maxSkyDiff * geom::radians;
+    result.maxPixelDiff = maxPixelDiff;
+    return result;
 }
 
 #define INSTANTIATE(MATCH) template class CreateWcsWithSip<MATCH>;
+#define INSTANTIATE_FIT(MATCH)                                                                              \
+    template FitTanSipWcsResult fitTanSipWcsWithRejection<MATCH>(                                           \
+            std::vector<MATCH> const&, afw::geom::SkyWcs const&, int const, int const, int const,            \
+            double const, geom::Box2I const&, LeastSqSolver const);
 
 INSTANTIATE(afw::table::ReferenceMatch);
 INSTANTIATE(afw::table::SourceMatch);
 
+INSTANTIATE_FIT(afw::table::ReferenceMatch);
+INSTANTIATE_FIT(afw::table::SourceMatch);
+
 }  // namespace sip
 }  // namespace astrom
 }  // namespace meas
@@ -22,14 +22,59 @@
  * see <http://www.lsstcorp.org/LegalNotices/>.
  */
 
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+
 #include "lsst/meas/astrom/sip/MatchSrcToCatalogue.h"
 #include "lsst/geom/Angle.h"
+#include "lsst/geom/SpherePoint.h"
 #include "lsst/afw/geom/SkyWcs.h"
+#include "lsst/afw/table/wcsUtils.h"
 
 namespace lsst {
 namespace meas {
 namespace astrom {
 namespace sip {
+namespace {
+
+/// Sources that moved by less than this fraction of the match distance since they were last looked up in
+/// the index reuse their list of candidate catalogue objects
+double const REQUERY_FRACTION = 0.5;
+
+/// Square of the distance between two points on the unit sphere separated by the given angle (radians)
+double chordSquared(double angle) {
+    double const chord = 2.0 * std::sin(0.5 * std::min(angle, geom::PI));
+    return chord * chord;
+}
+
+/// Remove all but the closest match for each record returned by getRecord, in a single pass over the
+/// matches using a hash table of the best match seen so far for each record.  The surviving matches
+/// keep their order; if two matches are equally close the later one is kept.
+template <typename GetRecord>
+void keepClosestMatches(afw::table::ReferenceMatchVector& matches, GetRecord getRecord) {
+    std::unordered_map<afw::table::BaseRecord const*, std::size_t> best;
+    best.reserve(matches.size());
+    for (std::size_t i = 0; i < matches.size(); ++i) {
+        auto const result = best.emplace(getRecord(matches[i]), i);
+        if (!result.second && matches[i].distance <= matches[result.first->second].distance) {
+            result.first->second = i;
+        }
+    }
+
+    std::size_t nKept = 0;
+    for (std::size_t i = 0; i < matches.size(); ++i) {
+        if (best.find(getRecord(matches[i]))->second == i) {
+            if (nKept != i) {
+                matches[nKept] = std::move(matches[i]);
+            }
+            ++nKept;
+        }
+    }
+    matches.erase(matches.begin() + nKept, matches.end());
+}
+
+}  // namespace
 
 /// \brief Create a list of common objects from a catalogue and an image.
 ///
@@ -48,7 +93,8 @@ namespace sip {
 ///
 MatchSrcToCatalogue::MatchSrcToCatalogue(afw::table::SimpleCatalog const& catSet,
                                          afw::table::SourceCatalog const& imgSet,
-                                         std::shared_ptr<afw::geom::SkyWcs const> wcs, geom::Angle dist) {
+                                         std::shared_ptr<afw::geom::SkyWcs const> wcs, geom::Angle dist)
+        : _refIndexValid(false) {
     setImgSrcSet(imgSet);
     setCatSrcSet(catSet);
     setDist(dist);
@@ -61,15 +107,24 @@ void MatchSrcToCatalogue::setDist(geom::Angle dist) {
         throw LSST_EXCEPT(pex::exceptions::InvalidParameterError, "Distance must be > 0");
     }
     _dist = dist;
+    _srcCandidates.clear();
 }
 
-/// Set a different Wcs solution
+/// Set a different Wcs solution. This keeps the index of the catalogue positions, and the candidate
+/// matches of the sources that do not move much.
 void MatchSrcToCatalogue::setWcs(std::shared_ptr<afw::geom::SkyWcs const> wcs) { _wcs = wcs; }
 
 /// sourceSet is a vector of pointers to Sources.
-void MatchSrcToCatalogue::setImgSrcSet(afw::table::SourceCatalog const& srcSet) { _imgSet = srcSet; }
+void MatchSrcToCatalogue::setImgSrcSet(afw::table::SourceCatalog const& srcSet) {
+    _imgSet = srcSet;
+    _srcCandidates.clear();
+}
 
-void MatchSrcToCatalogue::setCatSrcSet(afw::table::SimpleCatalog const& srcSet) { _catSet = srcSet; }
+void MatchSrcToCatalogue::setCatSrcSet(afw::table::SimpleCatalog const& srcSet) {
+    _catSet = srcSet;
+    _refIndexValid = false;
+    _srcCandidates.clear();
+}
 
 void MatchSrcToCatalogue::findMatches() {
     if (!_imgSet.getTable()->getCentroidSlot().isValid()) {
@@ -77,63 +132,121 @@ void MatchSrcToCatalogue::findMatches() {
                           "SourceTable passed to MatchSrcToCatalogue does not have its centroid slot set.");
     }
 
-    for (afw::table::SourceCatalog::const_iterator i = _imgSet.begin(); i != _imgSet.end(); ++i) {
-        i->updateCoord(*_wcs);
-    }
+    // Transform all the centroids with a single call to the Wcs, rather than one call per source
+    afw::table::updateSourceCoords(*_wcs, _imgSet);
 
-    _match = afw::table::matchRaDec(_catSet, _imgSet, _dist);
+    _matchRaDec();
 
-    _removeOneToMany();
-    _removeManyToOne();
+    _removeDuplicates();
 }
 
-/// We require that out matches be one to one, i.e any element matches no more than once for either
-/// the catalogue or the image. However, our implementation of findMatches uses afw::table::matchRaDec()
-/// which does not garauntee that. This function does the (slow) search and removal.
-void MatchSrcToCatalogue::_removeOneToMany() {
-    std::size_t size = _match.size();
-    for (std::size_t i = 0; i < size; ++i) {
-        for (std::size_t j = i + 1; j < size; ++j) {
-            // If the same Source appears twice keep the one with the smaller separation from its match
-            if (_match[i].first == _match[j].first) {
-                // Keep the one with the shorter match distance, and disgard the other
-                if (_match[i].distance < _match[j].distance) {
-                    _match.erase(_match.begin() + j);
-                    size--;
-                    j--;
-                } else {
-                    _match.erase(_match.begin() + i);
-                    size--;
-                    i--;
-                    break;
-                }
-            }
+/// Sort the positions of the catalogue objects by declination. Objects without a valid position are left
+/// out, as they can never be matched.
+void MatchSrcToCatalogue::_buildRefIndex() {
+    _refIndex.clear();
+    _refIndex.reserve(_catSet.size());
+    for (std::size_t i = 0; i < _catSet.size(); ++i) {
+        geom::SpherePoint const coord = _catSet[i].getCoord();
+        double const dec = coord.getLatitude().asRadians();
+        if (!std::isfinite(dec) || !std::isfinite(coord.getLongitude().asRadians())) {
+            continue;
+        }
+        auto const vector = coord.getVector();
+        _refIndex.push_back(RefPosition{dec, vector.x(), vector.y(), vector.z(), i});
+    }
+    std::sort(_refIndex.begin(), _refIndex.end(),
+              [](RefPosition const& a, RefPosition const& b) { return a.dec < b.dec; });
+    _refIndexValid = true;
+}
+
+/// Find the catalogue objects within radius (in radians) of the position (dec, x, y, z)
+void MatchSrcToCatalogue::_findCandidates(SrcCandidates& candidates, double dec, double x, double y, double z,
+                                          double radius) const {
+    candidates.valid = true;
+    candidates.x = x;
+    candidates.y = y;
+    candidates.z = z;
+    candidates.refs.clear();
+
+    double const limit = chordSquared(radius);
+    auto const begin = std::lower_bound(_refIndex.begin(), _refIndex.end(), dec - radius,
+                                        [](RefPosition const& a, double value) { return a.dec < value; });
+    for (auto ref = begin; ref != _refIndex.end() && ref->dec <= dec + radius; ++ref) {
+        double const dx = ref->x - x, dy = ref->y - y, dz = ref->z - z;
+        if (dx * dx + dy * dy + dz * dz < limit) {
+            candidates.refs.push_back(ref - _refIndex.begin());
         }
     }
 }
 
-/// This function is identical to
-///_removeOneToMany() except first is replaced with second for the match structures
-void MatchSrcToCatalogue::_removeManyToOne() {
-    std::size_t size = _match.size();
-    for (std::size_t i = 0; i < size; ++i) {
-        for (std::size_t j = i + 1; j < size; ++j) {
-            // If the same Source appears twice
-            if (_match[i].second == _match[j].second) {
-                // Keep the one with the shorter match distance, and disgard the other
-                if (_match[i].distance < _match[j].distance) {
-                    _match.erase(_match.begin() + j);
-                    size--;
-                    j--;
-                } else {
-                    _match.erase(_match.begin() + i);
-                    size--;
-                    i--;
-                    break;
-                }
+/// Find the closest image source within _dist of each catalogue object, as afw::table::matchRaDec() does.
+///
+/// The catalogue objects near each source are looked up in the index within an enlarged radius of
+/// _dist*(1 + REQUERY_FRACTION). Until the source moves by more than _dist*REQUERY_FRACTION from the
+/// position used for the lookup, every object within _dist of it is still in that list, so the lookup
+/// does not need to be repeated.
+void MatchSrcToCatalogue::_matchRaDec() {
+    if (!_refIndexValid) {
+        _buildRefIndex();
+        _srcCandidates.clear();
+    }
+    _srcCandidates.resize(_imgSet.size(), SrcCandidates{false, 0.0, 0.0, 0.0, {}});
+
+    double const dist = _dist.asRadians();
+    double const matchLimit = chordSquared(dist);
+    double const moveLimit = chordSquared(REQUERY_FRACTION * dist);
+    double const queryRadius = (1.0 + REQUERY_FRACTION) * dist;
+
+    std::size_t const noMatch = std::numeric_limits<std::size_t>::max();
+    std::vector<std::size_t> bestSrc(_refIndex.size(), noMatch);
+    std::vector<double> bestDistSq(_refIndex.size());
+    for (std::size_t i = 0; i < _imgSet.size(); ++i) {
+        geom::SpherePoint const coord = _imgSet[i].getCoord();
+        double const dec = coord.getLatitude().asRadians();
+        if (!std::isfinite(dec) || !std::isfinite(coord.getLongitude().asRadians())) {
+            _srcCandidates[i].valid = false;
+            continue;
+        }
+        auto const vector = coord.getVector();
+        double const x = vector.x(), y = vector.y(), z = vector.z();
+
+        SrcCandidates& candidates = _srcCandidates[i];
+        if (candidates.valid) {
+            double const dx = candidates.x - x, dy = candidates.y - y, dz = candidates.z - z;
+            candidates.valid = dx * dx + dy * dy + dz * dz <= moveLimit;
+        }
+        if (!candidates.valid) {
+            _findCandidates(candidates, dec, x, y, z, queryRadius);
+        }
+
+        for (std::size_t const j : candidates.refs) {
+            RefPosition const& ref = _refIndex[j];
+            double const dx = ref.x - x, dy = ref.y - y, dz = ref.z - z;
+            double const distSq = dx * dx + dy * dy + dz * dz;
+            if (distSq < matchLimit && (bestSrc[j] == noMatch || distSq < bestDistSq[j])) {
+                bestSrc[j] = i;
+                bestDistSq[j] = distSq;
             }
         }
     }
+
+    _match.clear();
+    for (std::size_t j = 0; j < _refIndex.size(); ++j) {
+        if (bestSrc[j] != noMatch) {
+            double const separation = 2.0 * std::asin(0.5 * std::sqrt(bestDistSq[j]));
+            _match.emplace_back(_catSet.get(_refIndex[j].index), _imgSet.get(bestSrc[j]), separation);
+        }
+    }
+}
+
+/// We require that our matches be one to one, i.e any element matches no more than once for either
+/// the catalogue or the image. However, our implementation of findMatches uses _matchRaDec(), which
+/// only keeps the closest source for each catalogue object and so does not guarantee that. This
+/// function removes the duplicates, first for catalogue objects and then for image sources, keeping
+/// the closest match in each case.
+void MatchSrcToCatalogue::_removeDuplicates() {
+    keepClosestMatches(_match, [](afw::table::ReferenceMatch const& m) { return m.first.get(); });
+    keepClosestMatches(_match, [](afw::table::ReferenceMatch const& m) { return m.second.get(); });
 }
 
 afw::table::ReferenceMatchVector MatchSrcToCatalogue::getMatches() {
@@ -0,0 +1,124 @@
+/*
+ * This file is part of meas_astrom.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE testCpuDispatch
+
+#include "boost/test/unit_test.hpp"
+
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "Eigen/Core"
+
+#include "lsst/meas/astrom/detail/cpuDispatch.h"
+#include "lsst/meas/astrom/detail/polynomialUtils.h"
+
+namespace detail = lsst::meas::astrom::detail;
+using detail::SimdLevel;
+
+namespace {
+
+struct PolynomialFixture {
+    PolynomialFixture() : xCoeffs(6, 6), yCoeffs(6, 6), u(1003), v(1003) {
+        // An odd number of points, so the vector kernels also have a remainder loop to get right
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<double> dist(-1.0, 1.0);
+        for (int p = 0; p < xCoeffs.rows(); ++p) {
+            for (int q = 0; q < xCoeffs.cols(); ++q) {
+                xCoeffs(p, q) = p + q <= 5 ? dist(rng) : 0.0;
+                yCoeffs(p, q) = p + q <= 5 ? dist(rng) : 0.0;
+            }
+        }
+        for (Eigen::Index i = 0; i < u.size(); ++i) {
+            u[i] = 2.0 * dist(rng);
+            v[i] = 2.0 * dist(rng);
+        }
+    }
+
+    void checkAgainst(Eigen::ArrayXd const& x, Eigen::ArrayXd const& y, Eigen::ArrayXd const& xRef,
+                      Eigen::ArrayXd const& yRef) const {
+        BOOST_REQUIRE_EQUAL(x.size(), xRef.size());
+        BOOST_REQUIRE_EQUAL(y.size(), yRef.size());
+        // FMA contraction may change the last bits, but no more
+        double const scale = 1.0 + xRef.abs().maxCoeff() + yRef.abs().maxCoeff();
+        BOOST_CHECK_SMALL((x - xRef).abs().maxCoeff() / scale, 1E-13);
+        BOOST_CHECK_SMALL((y - yRef).abs().maxCoeff() / scale, 1E-13);
+    }
+
+    Eigen::MatrixXd xCoeffs, yCoeffs;
+    Eigen::ArrayXd u, v;
+};
+
+}  // namespace
+
+// This must be the first test to call getSimdLevel(), because MEAS_ASTROM_SIMD is only read once.
+BOOST_FIXTURE_TEST_CASE(scalarOverride, PolynomialFixture) {
+    setenv("MEAS_ASTROM_SIMD", "scalar", 1);
+    BOOST_CHECK(detail::getSimdLevel() == SimdLevel::SCALAR);
+
+    // The default entry point now runs the scalar kernel; compare it with the best one this CPU has.
+    Eigen::ArrayXd x, y, xBest, yBest;
+    detail::evaluatePolynomials(xCoeffs, yCoeffs, u, v, x, y);
+    detail::evaluatePolynomials(xCoeffs, yCoeffs, u, v, xBest, yBest, detail::detectSimdLevel());
+    checkAgainst(xBest, yBest, x, y);
+}
+
+BOOST_FIXTURE_TEST_CASE(kernelsAgree, PolynomialFixture) {
+    // Direct evaluation of sum_{p,q} A(p,q) u^p v^q, for reference
+    Eigen::ArrayXd xRef = Eigen::ArrayXd::Zero(u.size());
+    Eigen::ArrayXd yRef = Eigen::ArrayXd::Zero(u.size());
+    for (int p = 0; p < xCoeffs.rows(); ++p) {
+        for (int q = 0; q < xCoeffs.cols(); ++q) {
+            Eigen::ArrayXd const term = u.pow(p) * v.pow(q);
+            xRef += xCoeffs(p, q) * term;
+            yRef += yCoeffs(p, q) * term;
+        }
+    }
+
+    BOOST_TEST_MESSAGE("Best instruction set: " << detail::getSimdLevelName(detail::detectSimdLevel()));
+    for (SimdLevel level : {SimdLevel::SCALAR, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        BOOST_TEST_CONTEXT(detail::getSimdLevelName(level)) {
+            Eigen::ArrayXd x, y;
+            detail::evaluatePolynomials(xCoeffs, yCoeffs, u, v, x, y, level);
+            checkAgainst(x, y, xRef, yRef);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(applySimdOverride) {
+    for (SimdLevel detected : {SimdLevel::SCALAR, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        BOOST_TEST_CONTEXT(detail::getSimdLevelName(detected)) {
+            BOOST_CHECK(detail::applySimdOverride(detected, nullptr) == detected);
+            BOOST_CHECK(detail::applySimdOverride(detected, "") == detected);
+            BOOST_CHECK(detail::applySimdOverride(detected, "scalar") == SimdLevel::SCALAR);
+            BOOST_CHECK(detail::applySimdOverride(detected, "avx2") ==
+                        std::min(detected, SimdLevel::AVX2));
+            BOOST_CHECK(detail::applySimdOverride(detected, "avx512") == detected);
+            // Unrecognized values are ignored (with a warning)
+            BOOST_CHECK(detail::applySimdOverride(detected, "sse9") == detected);
+            BOOST_CHECK(detail::applySimdOverride(detected, "SCALAR") == detected);
+        }
+    }
+}
@@ -27,6 +27,7 @@ import lsst.utils.tests
 import lsst.geom
 import lsst.afw.geom as afwGeom
 from lsst.meas.astrom import approximateWcs
+from lsst.meas.astrom.sip import approximateWcsWithSip
 
 
 class ApproximateWcsTestCase(lsst.utils.tests.TestCase):
@@ -69,6 +70,20 @@ class ApproximateWcsTestCase(lsst.utils.tests.TestCase):
         with self.assertRaises(UserWarning):
             approximateWcs(wcs=wcs, bbox=self.bbox, order=2)
 
+    def testApproximateWcsWithSip(self):
+        """Test that approximateWcsWithSip reports the errors assertWcsAlmostEqualOverBBox checks"""
+        wcs = afwGeom.makeModifiedWcs(pixelTransform=afwGeom.makeRadialTransform([0, 1.001, 0.000003]),
+                                      wcs=self.tanWcs, modifyActualPixels=False)
+        result = approximateWcsWithSip(wcs, self.bbox, order=5)
+        self.assertLess(result.maxSkyDiff, 0.001*lsst.geom.arcseconds)
+        self.assertLess(result.maxPixelDiff, 0.02)
+        self.assertWcsAlmostEqualOverBBox(wcs, result.wcs, self.bbox, maxDiffSky=result.maxSkyDiff*1.01,
+                                          maxDiffPix=result.maxPixelDiff*1.01)
+
+        # A fit that is too poor reports large errors rather than raising
+        result = approximateWcsWithSip(wcs, self.bbox, order=2, iterations=1)
+        self.assertGreater(result.maxPixelDiff, 0.02)
+
     def doTest(self, name, transform, order=3, doPlot=False):
         """Add the specified distorting transform to a TAN WCS and fit it
 
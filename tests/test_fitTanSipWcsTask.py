@@ -34,6 +34,7 @@ import unittest
 
 import numpy as np
 
+import lsst.pex.exceptions
 import lsst.pipe.base
 import lsst.utils.tests
 import lsst.geom
@@ -43,7 +44,7 @@ import lsst.afw.table as afwTable
 from lsst.meas.algorithms import convertReferenceCatalog
 from lsst.meas.base import SingleFrameMeasurementTask
 from lsst.meas.astrom import FitTanSipWcsTask, setMatchDistance
-from lsst.meas.astrom.sip import makeCreateWcsWithSip
+from lsst.meas.astrom.sip import makeCreateWcsWithSip, fitTanSipWcsWithRejection, LeastSqSolver
 
 
 class BaseTestCase:
@@ -164,6 +165,22 @@ class BaseTestCase:
         self.assertLess(maxDistErr.asArcseconds(), allowedDistErr,
                         "Computed distance in match list is off by %s arcsec" % (maxDistErr.asArcseconds(),))
 
+    def applyRadialDistortion(self):
+        """Apply a radial distortion to the centroids of the sources in self.matches
+
+        Returns
+        -------
+        pixels : `list` of `lsst.geom.Point2D`
+            The distorted centroids, in the order of self.matches.
+        """
+        radialTransform = afwGeom.makeRadialTransform([0, 1.01, 1e-8])
+        pixels = []
+        for refObj, src, d in self.matches:
+            pixel = radialTransform.applyForward(src.get(self.srcCentroidKey))
+            src.set(self.srcCentroidKey, pixel)
+            pixels.append(pixel)
+        return pixels
+
     def doTest(self, name, func, order=3, numIter=4, specifyBBox=False, doPlot=False, doPrint=False):
         """Apply func(x, y) to each source in self.sourceCat, then fit and check the resulting WCS
         """
@@ -351,6 +368,80 @@ class SideLoadTestCases:
             doPrint = order == 5
             self.doTest("testRadial", radialDistortion, order=order, doPrint=doPrint)
 
+    def testSolvers(self):
+        """Check that all least-squares solvers give equivalent fits"""
+        pixels = self.applyRadialDistortion()
+        reference = makeCreateWcsWithSip(self.matches, self.tanWcs, 4, solver=LeastSqSolver.SVD)
+        refCoords = reference.getNewWcs().pixelToSky(pixels)
+        for solver in (LeastSqSolver.AUTO, LeastSqSolver.COL_PIV_QR, LeastSqSolver.NORMAL_LDLT):
+            sipObject = makeCreateWcsWithSip(self.matches, self.tanWcs, 4, solver=solver)
+            self.assertEqual(sipObject.getSolver(), solver)
+            coords = sipObject.getNewWcs().pixelToSky(pixels)
+            for coord, refCoord in zip(coords, refCoords):
+                self.assertLess(coord.separation(refCoord).asArcseconds(), 1e-6)
+
+    def testAdaptiveReverse(self):
+        """Check that adaptive reverse-grid sampling meets its round-trip tolerance"""
+        pixels = self.applyRadialDistortion()
+        bbox = lsst.geom.Box2D()
+        for pixel in pixels:
+            bbox.include(pixel)
+        bbox = lsst.geom.Box2I(bbox, lsst.geom.Box2I.EXPAND)
+        fixed = makeCreateWcsWithSip(self.matches, self.tanWcs, 4, bbox)
+        self.assertEqual(fixed.getReverseTolerance(), 0.0)
+        adaptive = makeCreateWcsWithSip(self.matches, self.tanWcs, 4, bbox, reverseTolerance=1e-3)
+        self.assertEqual(adaptive.getReverseTolerance(), 1e-3)
+        self.assertLess(adaptive.getNReverseSamples(), fixed.getNReverseSamples())
+
+        # The round trip must meet the tolerance everywhere, not just at the sampled points
+        wcs = adaptive.getNewWcs()
+        xx, yy = np.meshgrid(np.linspace(bbox.getMinX(), bbox.getMaxX(), 101),
+                             np.linspace(bbox.getMinY(), bbox.getMaxY(), 101))
+        grid = [lsst.geom.Point2D(x, y) for x, y in zip(xx.ravel(), yy.ravel())]
+        for pixel, roundTrip in zip(grid, wcs.skyToPixel(wcs.pixelToSky(grid))):
+            self.assertPairsAlmostEqual(pixel, roundTrip, maxDiff=1e-3)
+
+    def testArrayInput(self):
+        """Check that fitting arrays of positions matches fitting the match list"""
+        pixels = self.applyRadialDistortion()
+        x = np.array([pixel.getX() for pixel in pixels])
+        y = np.array([pixel.getY() for pixel in pixels])
+        ra = np.array([refObj.getCoord().getRa().asRadians() for refObj, src, d in self.matches])
+        dec = np.array([refObj.getCoord().getDec().asRadians() for refObj, src, d in self.matches])
+
+        reference = makeCreateWcsWithSip(self.matches, self.tanWcs, 4)
+        refCoords = reference.getNewWcs().pixelToSky(pixels)
+        for errors in (np.array([]), np.full(len(x), 0.1)):
+            sipObject = makeCreateWcsWithSip(ra, dec, x, y, self.tanWcs, 4, errors=errors)
+            self.assertEqual(sipObject.getNPoints(), len(self.matches))
+            self.assertAnglesAlmostEqual(sipObject.getScatterOnSky(), reference.getScatterOnSky())
+            coords = sipObject.getNewWcs().pixelToSky(pixels)
+            for coord, refCoord in zip(coords, refCoords):
+                self.assertLess(coord.separation(refCoord).asArcseconds(), 1e-6)
+
+        result = fitTanSipWcsWithRejection(ra, dec, x, y, self.tanWcs, order=3, numIter=3, numRejIter=2,
+                                           rejSigma=3.0)
+        refResult = fitTanSipWcsWithRejection(self.matches, self.tanWcs, order=3, numIter=3, numRejIter=2,
+                                              rejSigma=3.0)
+        np.testing.assert_array_equal(result.rejected, refResult.rejected)
+
+        with self.assertRaises(lsst.pex.exceptions.LengthError):
+            makeCreateWcsWithSip(ra, dec, x[1:], y, self.tanWcs, 4)
+        with self.assertRaises(lsst.pex.exceptions.InvalidParameterError):
+            makeCreateWcsWithSip(ra, dec, x, y, self.tanWcs, 4, errors=np.zeros(len(x)))
+
+    def testRejection(self):
+        """Check that fitTanSipWcsWithRejection flags a gross outlier"""
+        refObj, src, d = self.matches[0]
+        src.set(self.srcCentroidKey, src.get(self.srcCentroidKey) - lsst.geom.Extent2D(50, 50))
+        result = fitTanSipWcsWithRejection(self.matches, self.tanWcs, order=3, numIter=3, numRejIter=2,
+                                           rejSigma=3.0)
+        self.assertEqual(len(result.rejected), len(self.matches))
+        self.assertTrue(result.rejected[0])
+        self.assertEqual(len(result.nRejected), 2)
+        self.assertEqual(len(result.scatterOnSky), 3)
+        self.assertLess(result.scatterOnSky[-1].asArcseconds(), 1e-3)
+
 # The test classes inherit from two base classes and differ in the match
 # class being used.
 
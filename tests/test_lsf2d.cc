@@ -340,6 +340,49 @@ BOOST_AUTO_TEST_CASE(fitChebyshevX2) {
     BOOST_CHECK_CLOSE(par(2, 2) + 1, 1., .001);
 }
 
+// Legendre polynomials have no built-in recurrence in the fitter, so this
+// exercises filling the design matrix through Function1
+BOOST_AUTO_TEST_CASE(fitLegendreXY) {
+    vector<double> x;
+    vector<double> y;
+    vector<double> s;
+    vector<double> z;
+
+    std::vector<double> xp;
+    xp.push_back(1);
+    xp.push_back(2);
+    xp.push_back(3);
+    math::LegendreFunction1<double> legendreX(xp);
+    std::vector<double> yp;
+    yp.push_back(0);
+    yp.push_back(0.5);
+    math::LegendreFunction1<double> legendreY(yp);
+
+    int nData = 7;
+    for (int i = 0; i < nData * nData; ++i) {
+        x.push_back(-1. + 2. * (i % nData) / (nData - 1));
+        y.push_back(-1. + 2. * (i / nData) / (nData - 1));
+        z.push_back(legendreX(x[i]) + legendreY(y[i]));
+        s.push_back(1);
+    }
+
+    int order = 3;
+    sip::LeastSqFitter2d<math::LegendreFunction1<double> > lsf(x, y, z, s, order);
+    Eigen::MatrixXd par = lsf.getParams();
+
+    BOOST_CHECK_CLOSE(par(0, 0), 1., .001);
+    BOOST_CHECK_CLOSE(par(1, 0), 2., .001);
+    BOOST_CHECK_CLOSE(par(2, 0), 3., .001);
+    BOOST_CHECK_CLOSE(par(0, 1), 0.5, .001);
+
+    BOOST_CHECK_CLOSE(par(0, 2) + 1, 1., .001);
+    BOOST_CHECK_CLOSE(par(1, 1) + 1, 1., .001);
+
+    for (int i = 0; i < nData * nData; ++i) {
+        BOOST_CHECK_CLOSE(lsf.valueAt(x[i], y[i]) + 10, z[i] + 10, .001);
+    }
+}
+
 #if !SKIP_UNCONSTRAINED_PROBLEMS
 BOOST_AUTO_TEST_CASE(fitChebyshevX3) {
     // A test case for a specific problem I've run into and don't understand (Dr. Mullally)
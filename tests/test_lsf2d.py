@@ -21,6 +21,8 @@
 #
 import unittest
 
+import numpy as np
+
 import lsst.utils.tests
 import lsst.pex.exceptions
 import lsst.meas.astrom.sip as sip
@@ -93,6 +95,48 @@ class Lsf2dTestCase(unittest.TestCase):
             print(x[i], y[i], z[i], lsf.valueAt(x[i], y[i]))
             self.assertAlmostEqual(z[i], lsf.valueAt(x[i], y[i]))
 
+    def testSolversAndMultipleZ(self):
+        """Check that all solvers agree, and that getParamsFor reuses the fit"""
+        rng = np.random.RandomState(12345)
+        x = rng.uniform(-1, 1, 30)
+        y = rng.uniform(-1, 1, 30)
+        s = rng.uniform(0.5, 1.5, 30)
+        z1 = 1 + 2*x - 3*x*y + 0.01*rng.normal(size=30)
+        z2 = y**2 - x + 0.01*rng.normal(size=30)
+
+        reference = sip.LeastSqFitter2dPoly(x, y, z1, s, 3)
+        reference2 = sip.LeastSqFitter2dPoly(x, y, z2, s, 3)
+        for solver in (sip.LeastSqSolver.AUTO, sip.LeastSqSolver.SVD, sip.LeastSqSolver.COL_PIV_QR,
+                       sip.LeastSqSolver.NORMAL_LDLT):
+            lsf = sip.LeastSqFitter2dPoly(x, y, z1, s, 3, solver=solver)
+            self.assertEqual(lsf.getSolver(), solver)
+            np.testing.assert_allclose(lsf.getParams(), reference.getParams(), atol=1e-10)
+            np.testing.assert_allclose(lsf.getErrors(), reference.getErrors(), atol=1e-10)
+            params = lsf.getParamsFor(np.column_stack([z1, z2]))
+            self.assertEqual(len(params), 2)
+            np.testing.assert_allclose(params[0], reference.getParams(), atol=1e-10)
+            np.testing.assert_allclose(params[1], reference2.getParams(), atol=1e-10)
+
+        with self.assertRaises(lsst.pex.exceptions.Exception):
+            reference.getParamsFor(np.column_stack([z1[1:], z2[1:]]))
+
+    def testArrayValueAt(self):
+        """Check the array valueAt overload and the cached diagnostics"""
+        rng = np.random.RandomState(54321)
+        x = rng.uniform(-1, 1, 30)
+        y = rng.uniform(-1, 1, 30)
+        s = rng.uniform(0.5, 1.5, 30)
+        z = 1 + 2*x - 3*x*y + 0.01*rng.normal(size=30)
+
+        lsf = sip.LeastSqFitter2dPoly(x, y, z, s, 3)
+        values = lsf.valueAt(x, y)
+        np.testing.assert_allclose(values, [lsf.valueAt(xi, yi) for xi, yi in zip(x, y)], rtol=1e-12)
+        np.testing.assert_allclose(lsf.residuals(), z - values, atol=1e-12)
+        self.assertAlmostEqual(lsf.getChiSq(), np.sum(((z - values)/s)**2), places=12)
+
+        with self.assertRaises(lsst.pex.exceptions.Exception):
+            lsf.valueAt(x, y[1:])
+
 
 class MemoryTester(lsst.utils.tests.MemoryTestCase):
     pass
@@ -26,6 +26,7 @@ import numpy as np
 
 import lsst.utils.tests
 import lsst.geom
+import lsst.pex.exceptions
 import lsst.afw.geom as afwGeom
 import lsst.afw.math as afwMath
 import lsst.afw.table as afwTable
@@ -128,6 +129,33 @@ class TestAstrometricSolver(lsst.utils.tests.TestCase):
         for item in itemList:
             self.assertAlmostEqual(distStats.getValue(item), directStats.getValue(item))
 
+    def testMakeMatchSeparationStatistics(self):
+        """Test makeMatchSeparationStatistics against the separate functions
+        """
+        np.random.seed(211)
+        offList = [lsst.geom.Extent2D(val) for val in (np.random.random_sample([self.numMatches, 2])-0.5)*10]
+        for off, match in zip(offList, self.matchList):
+            centroid = match.second.get(self.sourceCentroidKey)
+            match.second.set(self.sourceCentroidKey, centroid + off)
+        quantiles = [0.9, 0.25, 0.5, 0.0, 1.0]
+        stats = measAstrom.makeMatchSeparationStatistics(self.wcs, self.matchList, quantiles)
+
+        itemMask = afwMath.MEDIAN | afwMath.MEANCLIP | afwMath.STDEVCLIP
+        pixelStats = measAstrom.makeMatchStatisticsInPixels(self.wcs, self.matchList, itemMask)
+        radianStats = measAstrom.makeMatchStatisticsInRadians(self.wcs, self.matchList, itemMask)
+        for sepStats, directStats in ((stats.pixels, pixelStats), (stats.radians, radianStats)):
+            self.assertAlmostEqual(sepStats.median, directStats.getValue(afwMath.MEDIAN))
+            self.assertAlmostEqual(sepStats.meanClip, directStats.getValue(afwMath.MEANCLIP))
+            self.assertAlmostEqual(sepStats.stdevClip, directStats.getValue(afwMath.STDEVCLIP))
+
+        distList = [math.hypot(*val) for val in offList]
+        self.assertFloatsAlmostEqual(np.array(stats.pixels.quantiles), np.quantile(distList, quantiles),
+                                     rtol=1e-10)
+        self.assertAlmostEqual(stats.pixels.quantiles[2], stats.pixels.median)
+
+        with self.assertRaises(lsst.pex.exceptions.InvalidParameterError):
+            measAstrom.makeMatchSeparationStatistics(self.wcs, self.matchList, [1.5])
+
 
 class MemoryTester(lsst.utils.tests.MemoryTestCase):
     pass
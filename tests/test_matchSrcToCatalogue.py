@@ -0,0 +1,146 @@
+# This file is part of meas_astrom.
+#
+# Developed for the LSST Data Management System.
+# This product includes software developed by the LSST Project
+# (https://www.lsst.org).
+# See the COPYRIGHT file at the top-level directory of this distribution
+# for details of code ownership.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+import unittest
+
+import numpy as np
+
+import lsst.utils.tests
+import lsst.geom
+import lsst.afw.geom as afwGeom
+import lsst.afw.table as afwTable
+from lsst.meas.astrom.sip import MatchSrcToCatalogue
+
+
+class MatchSrcToCatalogueTestCase(lsst.utils.tests.TestCase):
+
+    def setUp(self):
+        self.wcs = afwGeom.makeSkyWcs(crpix=lsst.geom.Point2D(1000, 1000),
+                                      crval=lsst.geom.SpherePoint(215.5, 53.0, lsst.geom.degrees),
+                                      cdMatrix=afwGeom.makeCdMatrix(scale=0.2*lsst.geom.arcseconds))
+
+        sourceSchema = afwTable.SourceTable.makeMinimalSchema()
+        self.centroidKey = afwTable.Point2DKey.addFields(sourceSchema, "centroid", "centroid", "pixel")
+        sourceSchema.getAliasMap().set("slot_Centroid", "centroid")
+        self.sourceCat = afwTable.SourceCatalog(sourceSchema)
+        self.refCat = afwTable.SimpleCatalog(afwTable.SimpleTable.makeMinimalSchema())
+
+        # A jittered grid, so that distinct objects are far apart compared to the match radius
+        rng = np.random.RandomState(7)
+        xx, yy = np.meshgrid(np.linspace(100, 1900, 7), np.linspace(100, 1900, 7))
+        self.numSources = xx.size
+        for x, y in zip(xx.ravel(), yy.ravel()):
+            pixel = lsst.geom.Point2D(x + rng.uniform(-20, 20), y + rng.uniform(-20, 20))
+            src = self.sourceCat.addNew()
+            src.set(self.centroidKey, pixel)
+            ref = self.refCat.addNew()
+            ref.setCoord(self.wcs.pixelToSky(pixel))
+
+    def tearDown(self):
+        del self.wcs
+        del self.sourceCat
+        del self.refCat
+
+    def testOneToOne(self):
+        """Check that duplicate matches are resolved in favour of the closest pair
+        """
+        # A second, more distant reference object near the first source
+        extraRef = self.refCat.addNew()
+        extraRef.setCoord(self.refCat[0].getCoord().offset(0*lsst.geom.degrees, 1*lsst.geom.arcseconds))
+        # A second, more distant source near the second reference object
+        extraSrc = self.sourceCat.addNew()
+        extraSrc.set(self.centroidKey, self.sourceCat[1].get(self.centroidKey) + lsst.geom.Extent2D(3, 0))
+
+        matcher = MatchSrcToCatalogue(self.refCat, self.sourceCat, self.wcs, 2*lsst.geom.arcseconds)
+        matches = matcher.getMatches()
+
+        self.assertEqual(len(matches), self.numSources)
+        self.assertEqual(len({m.first.getId() for m in matches}), self.numSources)
+        self.assertEqual(len({m.second.getId() for m in matches}), self.numSources)
+        for match in matches:
+            self.assertNotEqual(match.first.getId(), extraRef.getId())
+            self.assertNotEqual(match.second.getId(), extraSrc.getId())
+            self.assertLess(match.distance, 1e-9)
+
+    def matchWithMatchRaDec(self, wcs, dist):
+        """Match self.sourceCat to self.refCat with afwTable.matchRaDec, keeping only the
+        closest pair for each reference object and then for each source
+
+        Returns
+        -------
+        matches : `dict` [`tuple` [`int`, `int`], `float`]
+            Separation in radians, keyed by reference object and source ID.
+        """
+        afwTable.updateSourceCoords(wcs, self.sourceCat)
+        control = afwTable.MatchControl()
+        control.findOnlyClosest = False
+        pairs = [(m.first.getId(), m.second.getId(), m.distance)
+                 for m in afwTable.matchRaDec(self.refCat, self.sourceCat, dist, control)]
+        for index in (0, 1):
+            closest = {}
+            for pair in pairs:
+                if pair[index] not in closest or pair[2] < closest[pair[index]][2]:
+                    closest[pair[index]] = pair
+            pairs = list(closest.values())
+        return {(refId, srcId): distance for refId, srcId, distance in pairs}
+
+    def testSetWcs(self):
+        """Check that re-matching after setWcs agrees with a new matcher and with matchRaDec
+        """
+        dist = 2*lsst.geom.arcseconds
+        matcher = MatchSrcToCatalogue(self.refCat, self.sourceCat, self.wcs, dist)
+        self.assertEqual(len(matcher.getMatches()), self.numSources)
+        # Shifts in pixels.  The match distance is 10 pixels, and the cached candidates of a
+        # source are recomputed once it has moved by more than half of that since they were
+        # computed.  4.9 stays just within 5 pixels of the initial match at 0 and 5.2 just
+        # crosses it; 9.9 and 10.1 are again within 5 pixels of 5.2, but straddle the match
+        # distance.
+        for shift in (0.5, 1.5, 1.2, 4.9, 5.2, 9.9, 10.1, 15.0, 1.0, 0.0):
+            wcs = afwGeom.makeSkyWcs(crpix=lsst.geom.Point2D(1000 + shift, 1000),
+                                     crval=self.wcs.getSkyOrigin(),
+                                     cdMatrix=self.wcs.getCdMatrix())
+            matcher.setWcs(wcs)
+            matches = matcher.getMatches()
+            expected = MatchSrcToCatalogue(self.refCat, self.sourceCat, wcs, dist).getMatches()
+            self.assertEqual([(m.first.getId(), m.second.getId()) for m in matches],
+                             [(m.first.getId(), m.second.getId()) for m in expected])
+            self.assertFloatsAlmostEqual(np.array([m.distance for m in matches]),
+                                         np.array([m.distance for m in expected]), rtol=1e-12)
+            self.assertEqual(len(matches), self.numSources if shift < 10 else 0)
+
+            bruteForce = self.matchWithMatchRaDec(wcs, dist)
+            self.assertEqual({(m.first.getId(), m.second.getId()) for m in matches}, set(bruteForce))
+            for m in matches:
+                self.assertFloatsAlmostEqual(m.distance, bruteForce[(m.first.getId(), m.second.getId())],
+                                             atol=1e-12, rtol=0)
+
+
+class MemoryTester(lsst.utils.tests.MemoryTestCase):
+    pass
+
+
+def setup_module(module):
+    lsst.utils.tests.init()
+
+
+if __name__ == "__main__":
+    lsst.utils.tests.init()
+    unittest.main()
@@ -0,0 +1,209 @@
+/*
+ * This file is part of meas_astrom.
+ *
+ * Developed for the LSST Data Management System.
+ * This product includes software developed by the LSST Project
+ * (https://www.lsst.org).
+ * See the COPYRIGHT file at the top-level directory of this distribution
+ * for details of code ownership.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE testPolynomialTransform
+
+#include "boost/test/unit_test.hpp"
+
+#include <cmath>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "Eigen/Core"
+#include "ndarray.h"
+
+#include "lsst/geom/AffineTransform.h"
+#include "lsst/geom/LinearTransform.h"
+#include "lsst/geom/Point.h"
+#include "lsst/meas/astrom/PolynomialTransform.h"
+#include "lsst/meas/astrom/SipTransform.h"
+
+namespace geom = lsst::geom;
+using lsst::meas::astrom::PolynomialTransform;
+using lsst::meas::astrom::ScaledPolynomialTransform;
+using lsst::meas::astrom::SipForwardTransform;
+using lsst::meas::astrom::SipReverseTransform;
+
+namespace {
+
+struct TransformFixture {
+    TransformFixture() : rng(11), dist(-1.0, 1.0), poly(makePoly(4)), affine(makeAffine()) {
+        for (int i = 0; i < 20; ++i) {
+            points.emplace_back(2.0 * dist(rng), 2.0 * dist(rng));
+        }
+    }
+
+    // Random coefficients for p + q <= order, and zeros elsewhere unless filled is true
+    PolynomialTransform makePoly(int order, bool filled = false) {
+        ndarray::Array<double, 2, 2> xCoeffs = ndarray::allocate(order + 1, order + 1);
+        ndarray::Array<double, 2, 2> yCoeffs = ndarray::allocate(order + 1, order + 1);
+        for (int p = 0; p <= order; ++p) {
+            for (int q = 0; q <= order; ++q) {
+                xCoeffs[p][q] = (filled || p + q <= order) ? dist(rng) : 0.0;
+                yCoeffs[p][q] = (filled || p + q <= order) ? dist(rng) : 0.0;
+            }
+        }
+        return PolynomialTransform(xCoeffs, yCoeffs);
+    }
+
+    geom::AffineTransform makeAffine() {
+        Eigen::Matrix2d m;
+        m << 1.0 + 0.1 * dist(rng), 0.1 * dist(rng), 0.1 * dist(rng), 1.0 + 0.1 * dist(rng);
+        return geom::AffineTransform(geom::LinearTransform(m), geom::Extent2D(dist(rng), dist(rng)));
+    }
+
+    template <typename F1, typename F2>
+    void checkSame(F1 const& result, F2 const& expected) const {
+        for (auto const& point : points) {
+            geom::Point2D const r = result(point);
+            geom::Point2D const e = expected(point);
+            BOOST_CHECK_SMALL(r.getX() - e.getX(), 1E-10 * (1.0 + std::abs(e.getX())));
+            BOOST_CHECK_SMALL(r.getY() - e.getY(), 1E-10 * (1.0 + std::abs(e.getY())));
+        }
+    }
+
+    static void checkEmpty(PolynomialTransform const& moved) {
+        BOOST_CHECK_EQUAL(moved.getOrder(), -1);
+        BOOST_CHECK_EQUAL(moved.getXCoeffs().getSize<0>(), 0);
+        BOOST_CHECK_EQUAL(moved.getYCoeffs().getSize<0>(), 0);
+    }
+
+    std::mt19937 rng;
+    std::uniform_real_distribution<double> dist;
+    PolynomialTransform poly;
+    geom::AffineTransform affine;
+    std::vector<geom::Point2D> points;
+};
+
+}  // namespace
+
+BOOST_FIXTURE_TEST_CASE(composeAffinePolyInto, TransformFixture) {
+    auto const expected = [this](geom::Point2D const& p) { return affine(poly(p)); };
+
+    // A result of a different order is resized
+    PolynomialTransform result = makePoly(2);
+    compose(affine, poly, result);
+    BOOST_CHECK_EQUAL(result.getOrder(), poly.getOrder());
+    checkSame(result, expected);
+
+    // A result of the same order keeps its arrays
+    double const* data = result.getXCoeffs().getData();
+    compose(affine, poly, result);
+    BOOST_CHECK_EQUAL(result.getXCoeffs().getData(), data);
+    checkSame(result, expected);
+
+    // result may be t2
+    PolynomialTransform aliased(poly);
+    compose(affine, aliased, aliased);
+    checkSame(aliased, expected);
+    checkSame(compose(affine, poly), expected);
+}
+
+BOOST_FIXTURE_TEST_CASE(composePolyAffineInto, TransformFixture) {
+    auto const expected = [this](geom::Point2D const& p) { return poly(affine(p)); };
+
+    PolynomialTransform result = makePoly(6);
+    compose(poly, affine, result);
+    BOOST_CHECK_EQUAL(result.getOrder(), poly.getOrder());
+    checkSame(result, expected);
+
+    double const* data = result.getXCoeffs().getData();
+    compose(poly, affine, result);
+    BOOST_CHECK_EQUAL(result.getXCoeffs().getData(), data);
+    checkSame(result, expected);
+
+    // result may be t1
+    PolynomialTransform aliased(poly);
+    compose(aliased, affine, aliased);
+    checkSame(aliased, expected);
+    checkSame(compose(poly, affine), expected);
+
+    // A constant polynomial still composes to a first-order one
+    PolynomialTransform constant = makePoly(0);
+    compose(constant, affine, result);
+    BOOST_CHECK_EQUAL(result.getOrder(), 1);
+    checkSame(result, constant);
+    compose(constant, affine, constant);
+    BOOST_CHECK_EQUAL(constant.getOrder(), 1);
+    checkSame(constant, result);
+}
+
+BOOST_FIXTURE_TEST_CASE(composeAffineKeepsAllCoeffs, TransformFixture) {
+    typedef geom::AffineTransform AT;
+    // Elements with p + q > order are transformed like the others, not dropped
+    PolynomialTransform filled = makePoly(3, true);
+    PolynomialTransform result = compose(affine, filled);
+    for (int p = 0; p <= 3; ++p) {
+        for (int q = 0; q <= 3; ++q) {
+            double const x = filled.getXCoeffs()[p][q];
+            double const y = filled.getYCoeffs()[p][q];
+            double const dx = (p == 0 && q == 0) ? affine[AT::X] : 0.0;
+            double const dy = (p == 0 && q == 0) ? affine[AT::Y] : 0.0;
+            BOOST_CHECK_CLOSE(result.getXCoeffs()[p][q], affine[AT::XX] * x + affine[AT::XY] * y + dx, 1E-10);
+            BOOST_CHECK_CLOSE(result.getYCoeffs()[p][q], affine[AT::YX] * x + affine[AT::YY] * y + dy, 1E-10);
+        }
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(composeRvalue, TransformFixture) {
+    PolynomialTransform moved(poly);
+    double const* data = moved.getXCoeffs().getData();
+    PolynomialTransform result = compose(affine, std::move(moved));
+    BOOST_CHECK_EQUAL(result.getXCoeffs().getData(), data);
+    checkSame(result, [this](geom::Point2D const& p) { return affine(poly(p)); });
+    checkEmpty(moved);
+}
+
+BOOST_FIXTURE_TEST_CASE(moveConstructors, TransformFixture) {
+    PolynomialTransform moved(poly);
+    double const* data = moved.getXCoeffs().getData();
+    PolynomialTransform target(std::move(moved));
+    BOOST_CHECK_EQUAL(target.getXCoeffs().getData(), data);
+    checkSame(target, poly);
+    checkEmpty(moved);
+    // A moved-from transform can be assigned to again
+    moved = poly;
+    checkSame(moved, poly);
+
+    geom::AffineTransform const outputScalingInverse = makeAffine();
+    ScaledPolynomialTransform const scaledCopy(poly, affine, outputScalingInverse);
+    ScaledPolynomialTransform const scaled(std::move(moved), affine, outputScalingInverse);
+    checkSame(scaled, scaledCopy);
+    checkEmpty(moved);
+    moved = poly;
+
+    geom::Point2D const origin(dist(rng), dist(rng));
+    geom::LinearTransform const cd = makeAffine().getLinear();
+    SipForwardTransform const forwardCopy(origin, cd, poly);
+    SipForwardTransform const forward(origin, cd, std::move(moved));
+    checkSame(forward, forwardCopy);
+    checkEmpty(moved);
+    moved = poly;
+
+    SipReverseTransform const reverseCopy(origin, cd, poly);
+    SipReverseTransform const reverse(origin, cd, std::move(moved));
+    checkSame(reverse, reverseCopy);
+    checkEmpty(moved);
+}
@@ -0,0 +1,176 @@
+# This file is part of meas_astrom.
+#
+# Developed for the LSST Data Management System.
+# This product includes software developed by the LSST Project
+# (https://www.lsst.org).
+# See the COPYRIGHT file at the top-level directory of this distribution
+# for details of code ownership.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+import os
+import unittest
+
+import numpy as np
+
+import lsst.utils.tests
+import lsst.daf.base
+import lsst.pex.exceptions
+import lsst.geom
+import lsst.afw.geom
+from lsst.afw.fits import readMetadata
+from lsst.afw.geom.wcsUtils import getSipMatrixFromMetadata, getCdMatrixFromMetadata
+from lsst.meas.astrom import (
+    PolynomialTransform,
+    SipForwardTransform,
+    SipReverseTransform,
+    TanSipEvaluator,
+    makeWcs,
+)
+
+
+class TanSipEvaluatorTestCase(lsst.utils.tests.TestCase):
+
+    def setUp(self):
+        np.random.seed(50)
+        filename = os.path.join(os.path.dirname(__file__),
+                                'imgCharSources-v85501867-R01-S00.sipheader')
+        metadata = readMetadata(filename)
+        metadata.set("RADESYS", "ICRS")
+        crpix = lsst.geom.Point2D(metadata.getScalar("CRPIX1") - 1, metadata.getScalar("CRPIX2") - 1)
+        self.crval = lsst.geom.SpherePoint(metadata.getScalar("CRVAL1"), metadata.getScalar("CRVAL2"),
+                                           lsst.geom.degrees)
+        cd = lsst.geom.LinearTransform(getCdMatrixFromMetadata(metadata))
+        self.sipForward = SipForwardTransform(
+            crpix, cd,
+            PolynomialTransform(getSipMatrixFromMetadata(metadata, "A"),
+                                getSipMatrixFromMetadata(metadata, "B"))
+        )
+        self.sipReverse = SipReverseTransform(
+            crpix, cd,
+            PolynomialTransform(getSipMatrixFromMetadata(metadata, "AP"),
+                                getSipMatrixFromMetadata(metadata, "BP"))
+        )
+        self.wcs = makeWcs(self.sipForward, self.sipReverse, self.crval)
+        self.pixelScale = self.wcs.getPixelScale().asRadians()
+        self.x = np.random.uniform(0, 2000, size=200)
+        self.y = np.random.uniform(0, 2000, size=200)
+
+    def checkPixelToSky(self, evaluator):
+        """Check pixelToSky against the AST-backed SkyWcs, to 1E-10 pixels.
+        """
+        ra, dec = evaluator.pixelToSkyArray(self.x, self.y)
+        for i, (x, y) in enumerate(zip(self.x, self.y)):
+            expected = self.wcs.pixelToSky(x, y)
+            coord = lsst.geom.SpherePoint(ra[i], dec[i], lsst.geom.radians)
+            self.assertLess(expected.separation(coord).asRadians(), 1E-10*self.pixelScale)
+        coords = evaluator.pixelToSky([lsst.geom.Point2D(x, y) for x, y in zip(self.x, self.y)])
+        self.assertFloatsAlmostEqual(np.array([c.getRa().asRadians() for c in coords]), ra, rtol=1E-15)
+        self.assertFloatsAlmostEqual(np.array([c.getDec().asRadians() for c in coords]), dec, rtol=1E-15)
+
+    def checkSkyToPixel(self, evaluator):
+        """Check skyToPixel against the AST gnomonic projection followed by
+        the reverse SIP transform, to 1E-10 pixels.
+        """
+        iwcToSky = lsst.afw.geom.getIntermediateWorldCoordsToSky(self.wcs)
+        ra, dec = self.wcs.pixelToSkyArray(self.x, self.y)
+        x, y = evaluator.skyToPixelArray(ra, dec)
+        for i in range(len(ra)):
+            coord = lsst.geom.SpherePoint(ra[i], dec[i], lsst.geom.radians)
+            expected = self.sipReverse(iwcToSky.applyInverse(coord))
+            self.assertFloatsAlmostEqual(np.array([x[i], y[i]]), np.array(expected), atol=1E-10, rtol=0)
+        xDeg, yDeg = evaluator.skyToPixelArray(np.degrees(ra), np.degrees(dec), degrees=True)
+        self.assertFloatsAlmostEqual(xDeg, x, atol=1E-10, rtol=0)
+        self.assertFloatsAlmostEqual(yDeg, y, atol=1E-10, rtol=0)
+
+    def testFromTransforms(self):
+        evaluator = TanSipEvaluator(self.sipForward, self.sipReverse, self.crval)
+        self.checkPixelToSky(evaluator)
+        self.checkSkyToPixel(evaluator)
+
+    def testFromWcs(self):
+        evaluator = TanSipEvaluator(self.wcs)
+        self.assertFloatsAlmostEqual(np.array(evaluator.getSipForward().getPixelOrigin()),
+                                     np.array(self.sipForward.getPixelOrigin()), rtol=1E-12)
+        self.checkPixelToSky(evaluator)
+        self.checkSkyToPixel(evaluator)
+
+    def testExactInverse(self):
+        """Test that skyToPixel inverts pixelToSky to 1E-10 pixels when
+        using the iterative inverse, with or without a reverse polynomial.
+        """
+        for evaluator in (TanSipEvaluator(self.sipForward, self.sipReverse, self.crval, exactInverse=True),
+                          TanSipEvaluator(self.sipForward, self.crval),
+                          TanSipEvaluator(self.wcs, exactInverse=True)):
+            self.assertTrue(evaluator.isExactInverse())
+            ra, dec = evaluator.pixelToSkyArray(self.x, self.y)
+            x, y = evaluator.skyToPixelArray(ra, dec)
+            self.assertFloatsAlmostEqual(x, self.x, atol=1E-10, rtol=0)
+            self.assertFloatsAlmostEqual(y, self.y, atol=1E-10, rtol=0)
+
+    def testPureTan(self):
+        """Test that a TAN WCS with no SIP terms is accepted and evaluated
+        exactly in both directions.
+        """
+        cdMatrix = lsst.afw.geom.makeCdMatrix(scale=0.2*lsst.geom.arcseconds,
+                                              orientation=30*lsst.geom.degrees)
+        wcs = lsst.afw.geom.makeSkyWcs(crpix=lsst.geom.Point2D(1000, 1000), crval=self.crval,
+                                       cdMatrix=cdMatrix)
+        evaluator = TanSipEvaluator(wcs)
+        ra, dec = evaluator.pixelToSkyArray(self.x, self.y)
+        expectedRa, expectedDec = wcs.pixelToSkyArray(self.x, self.y)
+        self.assertFloatsAlmostEqual(ra, expectedRa, atol=1E-10*self.pixelScale, rtol=0)
+        self.assertFloatsAlmostEqual(dec, expectedDec, atol=1E-10*self.pixelScale, rtol=0)
+        x, y = evaluator.skyToPixelArray(ra, dec)
+        self.assertFloatsAlmostEqual(x, self.x, atol=1E-10, rtol=0)
+        self.assertFloatsAlmostEqual(y, self.y, atol=1E-10, rtol=0)
+
+    def testInconsistentTransforms(self):
+        shifted = self.sipReverse.transformPixels(lsst.geom.AffineTransform(lsst.geom.Extent2D(1.0, 0.0)))
+        with self.assertRaises(lsst.pex.exceptions.InvalidParameterError):
+            TanSipEvaluator(self.sipForward, shifted, self.crval)
+
+    def testGalacticWcs(self):
+        metadata = lsst.daf.base.PropertyList()
+        metadata.set("CTYPE1", "GLON-TAN")
+        metadata.set("CTYPE2", "GLAT-TAN")
+        metadata.set("CRPIX1", 100.0)
+        metadata.set("CRPIX2", 200.0)
+        metadata.set("CRVAL1", 45.0)
+        metadata.set("CRVAL2", 10.0)
+        metadata.set("CD1_1", -5E-5)
+        metadata.set("CD1_2", 0.0)
+        metadata.set("CD2_1", 0.0)
+        metadata.set("CD2_2", 5E-5)
+        wcs = lsst.afw.geom.makeSkyWcs(metadata)
+        with self.assertRaises(lsst.pex.exceptions.InvalidParameterError):
+            TanSipEvaluator(wcs)
+
+    def testArraySizeMismatch(self):
+        evaluator = TanSipEvaluator(self.sipForward, self.sipReverse, self.crval)
+        with self.assertRaises(lsst.pex.exceptions.LengthError):
+            evaluator.pixelToSkyArray(self.x, self.y[:10])
+
+
+class MemoryTester(lsst.utils.tests.MemoryTestCase):
+    pass
+
+
+def setup_module(module):
+    lsst.utils.tests.init()
+
+
+if __name__ == "__main__":
+    lsst.utils.tests.init()
+    unittest.main()
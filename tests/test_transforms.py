@@ -21,11 +21,13 @@
 #
 
 import os
+import pickle
 import unittest
 
 import numpy as np
 
 import lsst.utils.tests
+import lsst.daf.base
 import lsst.pex.exceptions
 import lsst.geom
 import lsst.afw.geom
@@ -36,6 +38,7 @@ from lsst.afw.geom.testUtils import makeSipIwcToPixel, makeSipPixelToIwc
 from lsst.meas.astrom import (
     PolynomialTransform,
     ScaledPolynomialTransform,
+    ScaledChebyshevTransform,
     SipForwardTransform,
     SipReverseTransform,
     ScaledPolynomialTransformFitter,
@@ -80,6 +83,15 @@ def makeRandomScaledPolynomialTransform(order):
     )
 
 
+def makeRandomScaledChebyshevTransform(order):
+    return ScaledChebyshevTransform(
+        makeRandomCoefficientMatrix(order + 1),
+        makeRandomCoefficientMatrix(order + 1),
+        makeRandomAffineTransform(),
+        makeRandomAffineTransform()
+    )
+
+
 def makeRandomSipForwardTransform(order):
     return SipForwardTransform(
         lsst.geom.Point2D(*np.random.randn(2)),
@@ -131,6 +143,73 @@ class TransformTestMixin:
         self.assertFloatsAlmostEqual(affine[affine.XY], dtdy.getX(), rtol=1E-6)
         self.assertFloatsAlmostEqual(affine[affine.YY], dtdy.getY(), rtol=1E-6)
 
+    def testLinearizeArray(self):
+        """Test that the array overload of linearize() agrees with applying
+        the single-point overload to each point.
+        """
+        transform = self.makeRandom()
+        x = np.random.randn(20)
+        y = np.random.randn(20)
+        values, jacobian = transform.linearize(x, y)
+        self.assertEqual(values.shape, (20, 2))
+        self.assertEqual(jacobian.shape, (20, 2, 2))
+        for i in range(len(x)):
+            point = lsst.geom.Point2D(x[i], y[i])
+            affine = transform.linearize(point)
+            self.assertFloatsAlmostEqual(values[i], np.array(transform(point)), rtol=1E-13)
+            self.assertFloatsAlmostEqual(jacobian[i], affine.getLinear().getMatrix(), rtol=1E-13)
+        self.assertRaises(lsst.pex.exceptions.LengthError, transform.linearize, x, y[:10])
+
+    def testApplyArray(self):
+        """Test that the array method apply() agrees with applying the
+        transform to each point.
+        """
+        transform = self.makeRandom()
+        x = np.random.randn(20)
+        y = np.random.randn(20)
+        values = transform.apply(x, y)
+        self.assertEqual(values.shape, (20, 2))
+        for i in range(len(x)):
+            point = lsst.geom.Point2D(x[i], y[i])
+            self.assertFloatsAlmostEqual(values[i], np.array(transform(point)), rtol=1E-13)
+        self.assertRaises(lsst.pex.exceptions.LengthError, transform.apply, x, y[:10])
+
+    def testPickle(self):
+        """Test round-tripping through the binary format used for pickling.
+        """
+        transform = self.makeRandom()
+        copied = pickle.loads(pickle.dumps(transform))
+        self.assertIsInstance(copied, type(transform))
+        self.assertTransformsAlmostEqual(transform, copied, rtol=0)
+        # Many transforms in one pickle should come back in order.
+        transforms = [self.makeRandom() for i in range(5)]
+        for original, copied in zip(transforms, pickle.loads(pickle.dumps(transforms))):
+            self.assertTransformsAlmostEqual(original, copied, rtol=0)
+
+    def assertBadState(self, cls, state):
+        """Assert that restoring an instance of cls from state raises IoError.
+        """
+        restored = cls.__new__(cls)
+        with self.assertRaises(lsst.pex.exceptions.IoError):
+            restored.__setstate__(state)
+
+    def testPickleErrors(self):
+        """Test that corrupt or mismatched binary data is rejected.
+        """
+        transform = self.makeRandom()
+        cls = type(transform)
+        state = transform.__getstate__()
+        # Header is b"MATR", a version byte and a type tag byte.
+        self.assertEqual(state[:4], b"MATR")
+        self.assertBadState(cls, b"MATX" + state[4:])
+        self.assertBadState(cls, state[:4] + bytes([0]) + state[5:])
+        self.assertBadState(cls, state[:4] + bytes([state[4] + 1]) + state[5:])
+        for tag in range(256):
+            if tag != state[5]:
+                self.assertBadState(cls, state[:5] + bytes([tag]) + state[6:])
+        for size in (0, 3, 6, 9, len(state)//2, len(state) - 1):
+            self.assertBadState(cls, state[:size])
+
 
 class PolynomialTransformTestCase(lsst.utils.tests.TestCase, TransformTestMixin):
 
@@ -140,6 +219,14 @@ class PolynomialTransformTestCase(lsst.utils.tests.TestCase, TransformTestMixin)
     def makeRandom(self):
         return makeRandomPolynomialTransform(4)
 
+    def testPickleOtherType(self):
+        """Test that the binary data of another transform type is rejected.
+        """
+        for other in (makeRandomSipForwardTransform(4), makeRandomSipReverseTransform(4),
+                      makeRandomScaledPolynomialTransform(4)):
+            self.assertBadState(PolynomialTransform, other.__getstate__())
+        self.assertBadState(SipForwardTransform, makeRandomPolynomialTransform(4).__getstate__())
+
     def testArrayConstructor(self):
         """Test that construction with coefficient arrays yields an object with
         copies of those arrays, and that all dimensions must be the same.
@@ -211,6 +298,10 @@ class PolynomialTransformTestCase(lsst.utils.tests.TestCase, TransformTestMixin)
         self.assertFloatsAlmostEqual(composed3.getYCoeffs(), poly.getYCoeffs())
         self.assertFloatsAlmostEqual(composed4.getXCoeffs(), poly.getXCoeffs())
         self.assertFloatsAlmostEqual(composed4.getYCoeffs(), poly.getYCoeffs())
+        # Composing an affine transform into a polynomial on the right needs
+        # binomial coefficients, which are only tabulated up to order 20.
+        with self.assertRaises(lsst.pex.exceptions.LengthError):
+            lsst.meas.astrom.compose(makeRandomPolynomialTransform(21), affine)
 
 
 class ScaledPolynomialTransformTestCase(lsst.utils.tests.TestCase, TransformTestMixin):
@@ -252,6 +343,83 @@ class ScaledPolynomialTransformTestCase(lsst.utils.tests.TestCase, TransformTest
         converted = ScaledPolynomialTransform.convert(sipReverse)
         self.assertTransformsAlmostEqual(sipReverse, converted)
 
+    def testCompose(self):
+        """Test that composing with AffineTransforms only changes the scalings.
+        """
+        scaled = makeRandomScaledPolynomialTransform(4)
+        affine = makeRandomAffineTransform()
+        composed1 = lsst.meas.astrom.compose(scaled, affine)
+        composed2 = lsst.meas.astrom.compose(affine, scaled)
+        self.assertIsInstance(composed1, ScaledPolynomialTransform)
+        self.assertIsInstance(composed2, ScaledPolynomialTransform)
+        self.assertTransformsAlmostEqual(composed1, lambda p: scaled(affine(p)))
+        self.assertTransformsAlmostEqual(composed2, lambda p: affine(scaled(p)))
+        for composed in (composed1, composed2):
+            self.assertFloatsAlmostEqual(composed.getPoly().getXCoeffs(), scaled.getPoly().getXCoeffs(),
+                                         rtol=0)
+            self.assertFloatsAlmostEqual(composed.getPoly().getYCoeffs(), scaled.getPoly().getYCoeffs(),
+                                         rtol=0)
+
+
+class ScaledChebyshevTransformTestCase(lsst.utils.tests.TestCase):
+
+    def setUp(self):
+        np.random.seed(50)
+
+    def testEvaluate(self):
+        """Test evaluation against NumPy's Chebyshev series."""
+        xc = makeRandomCoefficientMatrix(5)
+        yc = makeRandomCoefficientMatrix(5)
+        inputScaling = makeRandomAffineTransform()
+        outputScalingInverse = makeRandomAffineTransform()
+        transform = ScaledChebyshevTransform(xc, yc, inputScaling, outputScalingInverse)
+        self.assertEqual(transform.getOrder(), 4)
+        self.assertFloatsAlmostEqual(transform.getXCoeffs(), xc, rtol=0)
+        for i in range(10):
+            point = lsst.geom.Point2D(*np.random.randn(2))
+            scaled = inputScaling(point)
+            expected = outputScalingInverse(lsst.geom.Point2D(
+                np.polynomial.chebyshev.chebval2d(scaled.getX(), scaled.getY(), xc),
+                np.polynomial.chebyshev.chebval2d(scaled.getX(), scaled.getY(), yc),
+            ))
+            self.assertFloatsAlmostEqual(np.array(transform(point)), np.array(expected), rtol=1E-12)
+
+    def testLinearize(self):
+        transform = makeRandomScaledChebyshevTransform(4)
+        point = lsst.geom.Point2D(*np.random.randn(2))
+        affine = transform.linearize(point)
+        self.assertFloatsAlmostEqual(np.array(transform(point)), np.array(affine(point)), rtol=1E-13)
+        delta = 1E-4
+        deltaX = lsst.geom.Extent2D(delta, 0.0)
+        deltaY = lsst.geom.Extent2D(0.0, delta)
+        dtdx = (transform(point + deltaX) - transform(point - deltaX)) / (2*delta)
+        dtdy = (transform(point + deltaY) - transform(point - deltaY)) / (2*delta)
+        self.assertFloatsAlmostEqual(affine[affine.XX], dtdx.getX(), rtol=1E-6)
+        self.assertFloatsAlmostEqual(affine[affine.YX], dtdx.getY(), rtol=1E-6)
+        self.assertFloatsAlmostEqual(affine[affine.XY], dtdy.getX(), rtol=1E-6)
+        self.assertFloatsAlmostEqual(affine[affine.YY], dtdy.getY(), rtol=1E-6)
+
+    def testConvert(self):
+        """Test conversion to the monomial transforms."""
+        transform = makeRandomScaledChebyshevTransform(4)
+        crpix = lsst.geom.Point2D(*np.random.randn(2))
+        cd = lsst.geom.LinearTransform(np.random.randn(2, 2))
+        for converted in (ScaledPolynomialTransform.convert(transform),
+                          SipForwardTransform.convert(transform, crpix, cd),
+                          SipReverseTransform.convert(transform, crpix, cd)):
+            for i in range(10):
+                point = lsst.geom.Point2D(*np.random.rand(2))
+                self.assertFloatsAlmostEqual(np.array(converted(point)), np.array(transform(point)),
+                                             rtol=1E-10)
+
+    def testBadShapes(self):
+        with self.assertRaises(lsst.pex.exceptions.LengthError):
+            ScaledChebyshevTransform(np.zeros((3, 3)), np.zeros((4, 4)),
+                                     lsst.geom.AffineTransform(), lsst.geom.AffineTransform())
+        with self.assertRaises(lsst.pex.exceptions.LengthError):
+            ScaledChebyshevTransform(np.zeros((3, 4)), np.zeros((3, 4)),
+                                     lsst.geom.AffineTransform(), lsst.geom.AffineTransform())
+
 
 class SipForwardTransformTestCase(lsst.utils.tests.TestCase, TransformTestMixin):
 
@@ -298,6 +466,33 @@ class SipForwardTransformTestCase(lsst.utils.tests.TestCase, TransformTestMixin)
             lambda p: sip(affine.inverted()(p))
         )
 
+    def testApplyInverse(self):
+        """Test that applyInverse inverts the forward transform to high
+        precision, with and without a reverse transform seed.
+        """
+        filename = os.path.join(os.path.dirname(__file__),
+                                'imgCharSources-v85501867-R01-S00.sipheader')
+        sipMetadata = readMetadata(filename)
+        crpix = lsst.geom.Point2D(
+            sipMetadata.getScalar("CRPIX1") - 1,
+            sipMetadata.getScalar("CRPIX2") - 1,
+        )
+        cd = lsst.geom.LinearTransform(getCdMatrixFromMetadata(sipMetadata))
+        fwd = SipForwardTransform(crpix, cd, PolynomialTransform(getSipMatrixFromMetadata(sipMetadata, "A"),
+                                                                 getSipMatrixFromMetadata(sipMetadata, "B")))
+        rev = SipReverseTransform(crpix, cd, PolynomialTransform(getSipMatrixFromMetadata(sipMetadata, "AP"),
+                                                                 getSipMatrixFromMetadata(sipMetadata, "BP")))
+        pixels = np.random.uniform(0, 2000, size=(50, 2))
+        iwc = np.array([fwd(lsst.geom.Point2D(*p)) for p in pixels])
+        self.assertFloatsAlmostEqual(fwd.applyInverse(iwc[:, 0], iwc[:, 1]), pixels, atol=1E-8, rtol=0)
+        self.assertFloatsAlmostEqual(fwd.applyInverse(iwc[:, 0], iwc[:, 1], seed=rev), pixels,
+                                     atol=1E-8, rtol=0)
+        # A single iteration from the reverse polynomial should already be
+        # much better than the reverse polynomial itself.
+        seeded = np.array([rev(lsst.geom.Point2D(*p)) for p in iwc])
+        oneStep = fwd.applyInverse(iwc[:, 0], iwc[:, 1], seed=rev, tolerance=np.inf, maxIter=1)
+        self.assertLess(np.abs(oneStep - pixels).max(), 1E-2*np.abs(seeded - pixels).max())
+
     def testMakeWcs(self):
         """Test SipForwardTransform, SipReverseTransform and makeWcs
         """
@@ -438,6 +633,58 @@ class SipForwardTransformTestCase(lsst.utils.tests.TestCase, TransformTestMixin)
         compareFinite(image0, image2r)
         compareFinite(image0, image3r)
 
+    def testTransformTanSipWcsPixels(self):
+        """Test that transforming the pixels of an ICRS TAN-SIP WCS yields
+        another TAN-SIP WCS rather than a longer mapping chain.
+        """
+        filename = os.path.join(os.path.dirname(__file__),
+                                'imgCharSources-v85501867-R01-S00.sipheader')
+        metadata = readMetadata(filename)
+        metadata.set("RADESYS", "ICRS")
+        wcs0 = lsst.afw.geom.makeSkyWcs(metadata)
+        self.assertTrue(wcs0.isFits())
+        s = makeRandomAffineTransform()
+        wcs1 = transformWcsPixels(wcs0, s)
+        self.assertTrue(wcs1.isFits())
+        self.assertIn("-SIP", wcs1.getFitsMetadata(True).getScalar("CTYPE1"))
+        bbox = lsst.geom.Box2D(lsst.geom.Point2D(0, 0), lsst.geom.Extent2D(2000, 2000))
+        for pixel in bbox.getCorners():
+            self.assertSpherePointsAlmostEqual(wcs1.pixelToSky(s(pixel)), wcs0.pixelToSky(pixel),
+                                               maxSep=1E-6*lsst.geom.arcseconds)
+            sky = wcs0.pixelToSky(pixel)
+            self.assertPairsAlmostEqual(wcs1.skyToPixel(sky), s(wcs0.skyToPixel(sky)), maxDiff=1E-6)
+        # Four quarter rotations should give back the original WCS.
+        dimensions = lsst.geom.Extent2I(2000, 2000)
+        wcs4 = wcs0
+        for i in range(4):
+            wcs4 = rotateWcsPixelsBy90(wcs4, 1, dimensions)
+            self.assertTrue(wcs4.isFits())
+        self.assertWcsAlmostEqualOverBBox(wcs4, wcs0, bbox)
+        # A pure TAN WCS stays pure TAN.
+        tanWcs = lsst.afw.geom.makeSkyWcs(lsst.geom.Point2D(100, 200), wcs0.getSkyOrigin(),
+                                          wcs0.getCdMatrix())
+        rotated = rotateWcsPixelsBy90(tanWcs, 1, dimensions)
+        self.assertEqual(rotated.getFitsMetadata(True).getScalar("CTYPE1"), "RA---TAN")
+
+    def testTransformGalacticTanWcsPixels(self):
+        """Test that a TAN WCS with galactic axes is not folded into an
+        equatorial TAN-SIP WCS.
+        """
+        metadata = lsst.daf.base.PropertyList()
+        metadata.set("CTYPE1", "GLON-TAN")
+        metadata.set("CTYPE2", "GLAT-TAN")
+        metadata.set("CRPIX1", 100.0)
+        metadata.set("CRPIX2", 200.0)
+        metadata.set("CRVAL1", 45.0)
+        metadata.set("CRVAL2", 10.0)
+        metadata.set("CD1_1", -5E-5)
+        metadata.set("CD1_2", 0.0)
+        metadata.set("CD2_1", 0.0)
+        metadata.set("CD2_2", 5E-5)
+        wcs = lsst.afw.geom.makeSkyWcs(metadata)
+        with self.assertRaises(lsst.pex.exceptions.InvalidParameterError):
+            transformWcsPixels(wcs, makeRandomAffineTransform())
+
 
 class SipReverseTransformTestCase(lsst.utils.tests.TestCase, TransformTestMixin):
 
@@ -616,6 +863,35 @@ class ScaledPolynomialTransformFitterTestCase(lsst.utils.tests.TestCase):
                                          np.array(record.get(outputKey)),
                                          rtol=1E-2)  # even at much higher order, inverse can't be perfect.
 
+    def testFromGridChebyshev(self):
+        """Test that fitting in the Chebyshev basis gives the same result as
+        fitting monomials, and that the two forms of the result agree.
+        """
+        order = 8
+        toInvert = makeRandomScaledPolynomialTransform(2)
+        bbox = lsst.geom.Box2D(lsst.geom.Point2D(432, -671), lsst.geom.Point2D(527, -463))
+        monomialFitter = ScaledPolynomialTransformFitter.fromGrid(order, bbox, 50, 50, toInvert)
+        monomialFitter.fit()
+        fitter = ScaledPolynomialTransformFitter.fromGrid(order, bbox, 50, 50, toInvert, chebyshev=True)
+        self.assertTrue(fitter.isChebyshev())
+        self.assertFalse(monomialFitter.isChebyshev())
+        with self.assertRaises(lsst.pex.exceptions.LogicError):
+            monomialFitter.getChebyshevTransform()
+        fitter.fit()
+        fitter.updateModel()
+        chebyshev = fitter.getChebyshevTransform()
+        self.assertEqual(chebyshev.getOrder(), order)
+        data = fitter.getData()
+        inputKey = lsst.afw.table.Point2DKey(data.schema["input"])
+        modelKey = lsst.afw.table.Point2DKey(data.schema["model"])
+        for record in data:
+            point = record.get(inputKey)
+            self.assertFloatsAlmostEqual(np.array(record.get(modelKey)), np.array(chebyshev(point)))
+            self.assertFloatsAlmostEqual(np.array(fitter.getTransform()(point)), np.array(chebyshev(point)),
+                                         rtol=1E-8)
+            self.assertFloatsAlmostEqual(np.array(monomialFitter.getTransform()(point)),
+                                         np.array(chebyshev(point)), rtol=1E-6)
+
 
 class MemoryTester(lsst.utils.tests.MemoryTestCase):
     pass